@@ -616,6 +616,10 @@ struct slurmdb_assoc_usage {
 
 	uint32_t tres_cnt; /* size of the tres arrays,
 			    * (DON'T PACK for state file) */
+	uint16_t tres_unlimited; /* ASSOC_TRES_UNLIM_* flags of the
+				  * association's TRES limit arrays which
+				  * hold no limit at all, set in slurmctld
+				  * (DON'T PACK) */
 	long double usage_efctv;/* effective, normalized usage
 				 * (DON'T PACK for state file) */
 	long double usage_norm;	/* normalized usage
@@ -637,6 +641,12 @@ struct slurmdb_assoc_usage {
 	long double level_fs;	/* (FAIR_TREE) Result of fairshare equation
 				 * compared to the association's siblings
 				 * (DON'T PACK for state file) */
+	slurmdb_assoc_rec_t **fs_children; /* (FAIR_TREE) NULL terminated
+					    * children sorted by level_fs at
+					    * the last calculation (DON'T PACK) */
+	bool fs_usage_changed;	/* (FAIR_TREE) usage below this association
+				 * changed since fs_children was sorted
+				 * (DON'T PACK) */
 
 	bitstr_t *valid_qos;    /* qos available for this association
 				 * derived from the qos_list.
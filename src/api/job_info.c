@@ -1907,9 +1907,17 @@ _load_cluster_job_prio(slurm_msg_t *req_msg,
 		       priority_factors_response_msg_t **factors_resp,
 		       slurmdb_cluster_rec_t *cluster)
 {
+	priority_factors_request_msg_t *factors_req = req_msg->data;
 	slurm_msg_t resp_msg;
 	int rc = SLURM_SUCCESS;
 
+	/* Clusters running an older release can not filter by account */
+	if (factors_req->accounts && cluster &&
+	    (cluster->rpc_version < SLURM_21_08_PROTOCOL_VERSION)) {
+		slurm_seterrno(ESLURM_NOT_SUPPORTED);
+		return SLURM_ERROR;
+	}
+
 	slurm_msg_t_init(&resp_msg);
 
 	if (slurm_send_recv_controller_msg(req_msg, &resp_msg, cluster) < 0)
@@ -2163,6 +2171,7 @@ static int _load_fed_job_prio(slurm_msg_t *req_msg,
  * OUT factors_resp - job priority factors
  * IN job_id_list - list of job IDs to be reported
  * IN partitions - comma delimited list of partition names to be reported
+ * IN accounts - comma delimited list of account names to be reported
  * IN uid_list - list of user IDs to be reported
  * IN show_flags -  job filtering option: 0, SHOW_LOCAL and/or SHOW_SIBLING
  * RET 0 or -1 on error
@@ -2170,8 +2179,8 @@ static int _load_fed_job_prio(slurm_msg_t *req_msg,
  */
 extern int
 slurm_load_job_prio(priority_factors_response_msg_t **factors_resp,
-		    List job_id_list, char *partitions, List uid_list,
-		    uint16_t show_flags)
+		    List job_id_list, char *partitions, char *accounts,
+		    List uid_list, uint16_t show_flags)
 {
 	slurm_msg_t req_msg;
 	priority_factors_request_msg_t factors_req;
@@ -2193,6 +2202,7 @@ slurm_load_job_prio(priority_factors_response_msg_t **factors_resp,
 	memset(&factors_req, 0, sizeof(factors_req));
 	factors_req.job_id_list = job_id_list;
 	factors_req.partitions  = partitions;
+	factors_req.accounts    = accounts;
 	factors_req.uid_list    = uid_list;
 
 	slurm_msg_t_init(&req_msg);
@@ -153,3 +153,75 @@ extern int slurm_submit_batch_het_job(List job_req_list,
 
 	return SLURM_SUCCESS;
 }
+
+/*
+ * slurm_submit_batch_jobs - issue a single RPC to submit several independent
+ *			     batch jobs for later execution
+ * NOTE: free the response using slurm_list_destroy
+ * IN job_req_list - List of batch job requests, type job_desc_msg_t
+ * OUT resp_list - List of submit_response_msg_t, one per request in the
+ *		   same order as job_req_list. A job_id of zero and non-zero
+ *		   error_code identifies a rejected request.
+ * RET SLURM_SUCCESS on success, otherwise return SLURM_ERROR with errno set.
+ *     errno is ESLURM_NOT_SUPPORTED when the controller does not handle the
+ *     RPC, in which case no job was created and the jobs can be submitted
+ *     one at a time.
+ */
+extern int slurm_submit_batch_jobs(List job_req_list, List *resp_list)
+{
+	int rc;
+	job_desc_msg_t *req;
+	slurm_msg_t req_msg;
+	slurm_msg_t resp_msg;
+	ListIterator iter;
+
+	*resp_list = NULL;
+	if (!job_req_list || (list_count(job_req_list) >= NO_VAL16))
+		slurm_seterrno_ret(EINVAL);
+
+	/* Clusters running an older release do not know this RPC */
+	if (working_cluster_rec &&
+	    (working_cluster_rec->rpc_version < SLURM_21_08_PROTOCOL_VERSION))
+		slurm_seterrno_ret(ESLURM_NOT_SUPPORTED);
+
+	slurm_msg_t_init(&req_msg);
+	slurm_msg_t_init(&resp_msg);
+
+	/*
+	 * set session id for this request
+	 */
+	iter = list_iterator_create(job_req_list);
+	while ((req = (job_desc_msg_t *) list_next(iter))) {
+		if (req->alloc_sid == NO_VAL)
+			req->alloc_sid = getsid(0);
+	}
+	list_iterator_destroy(iter);
+
+	req_msg.msg_type = REQUEST_SUBMIT_BATCH_JOB_LIST;
+	req_msg.data     = job_req_list;
+
+	rc = slurm_send_recv_controller_msg(&req_msg, &resp_msg,
+					    working_cluster_rec);
+	if (rc == SLURM_ERROR)
+		return SLURM_ERROR;
+	switch (resp_msg.msg_type) {
+	case RESPONSE_SLURM_RC:
+		rc = ((return_code_msg_t *) resp_msg.data)->return_code;
+		/*
+		 * A controller without this RPC rejects it as an invalid
+		 * message type before doing anything with the jobs
+		 */
+		if ((rc == EINVAL) || (rc == SLURM_PROTOCOL_VERSION_ERROR))
+			rc = ESLURM_NOT_SUPPORTED;
+		if (rc)
+			slurm_seterrno_ret(rc);
+		break;
+	case RESPONSE_SUBMIT_BATCH_JOB_LIST:
+		*resp_list = (List) resp_msg.data;
+		break;
+	default:
+		slurm_seterrno_ret(SLURM_UNEXPECTED_MSG_ERROR);
+	}
+
+	return SLURM_SUCCESS;
+}
@@ -138,6 +138,55 @@ tryagain:
 	return rc;
 }
 
+/*
+ * slurm_update_job_list - issue a single RPC applying one job update to
+ *	every job in req->job_id_list plus every job matching all of the
+ *	filters set in req (partition, state, user_id)
+ * IN req - job updates, job IDs and filters
+ * OUT resp - per job response to the request,
+ *	      free using slurm_free_job_array_resp()
+ * RET SLURM_SUCCESS on success, otherwise return SLURM_ERROR with errno set
+ */
+extern int slurm_update_job_list(job_update_list_msg_t *req,
+				 job_array_resp_msg_t **resp)
+{
+	int rc = SLURM_SUCCESS;
+	slurm_msg_t req_msg, resp_msg;
+
+	*resp = NULL;
+	if (!req || !req->job_desc) {
+		slurm_seterrno(EINVAL);
+		return SLURM_ERROR;
+	}
+
+	slurm_msg_t_init(&req_msg);
+	slurm_msg_t_init(&resp_msg);
+	req_msg.msg_type	= REQUEST_UPDATE_JOB_LIST;
+	req_msg.data		= req;
+
+	if (slurm_send_recv_controller_msg(&req_msg, &resp_msg,
+					   working_cluster_rec) < 0)
+		return SLURM_ERROR;
+
+	switch (resp_msg.msg_type) {
+	case RESPONSE_JOB_ARRAY_ERRORS:
+		*resp = (job_array_resp_msg_t *) resp_msg.data;
+		break;
+	case RESPONSE_SLURM_RC:
+		rc = ((return_code_msg_t *) resp_msg.data)->return_code;
+		if (rc) {
+			slurm_seterrno(rc);
+			rc = SLURM_ERROR;
+		}
+		break;
+	default:
+		slurm_seterrno(SLURM_UNEXPECTED_MSG_ERROR);
+		rc = SLURM_ERROR;
+	}
+
+	return rc;
+}
+
 /*
  * slurm_update_node - issue RPC to a node's configuration per request,
  *	only usable by user root
@@ -45,19 +45,21 @@
 #include <ctype.h>
 
 #include "src/common/uid.h"
+#include "src/common/xhash.h"
 #include "src/common/xstring.h"
 #include "src/common/slurm_priority.h"
 #include "src/common/slurmdbd_pack.h"
 #include "src/slurmdbd/read_config.h"
 
-#define ASSOC_HASH_SIZE 1000
-#define ASSOC_HASH_ID_INX(_assoc_id)	(_assoc_id % ASSOC_HASH_SIZE)
+#define ASSOC_HASH_SIZE 1000	/* initial size of the assoc hash tables */
+#define ASSOC_HASH_ID_INX(_assoc_id)	(_assoc_id % assoc_hash_size)
 
 slurmdb_assoc_rec_t *assoc_mgr_root_assoc = NULL;
 uint32_t g_qos_max_priority = 0;
 uint32_t g_assoc_max_priority = 0;
 uint32_t g_qos_count = 0;
 uint32_t g_user_assoc_count = 0;
+uint32_t g_assoc_tree_gen = 0;
 uint32_t g_tres_count = 0;
 
 List assoc_mgr_tres_list = NULL;
@@ -73,11 +75,73 @@ static int setup_children = 0;
 static pthread_rwlock_t assoc_mgr_locks[ASSOC_MGR_ENTITY_COUNT];
 static pthread_mutex_t assoc_lock_init = PTHREAD_MUTEX_INITIALIZER;
 
+static const char *assoc_mgr_entity_names[ASSOC_MGR_ENTITY_COUNT] = {
+	"assoc", "file", "qos", "res", "tres", "user", "wckey"
+};
+
+lock_trace_t assoc_mgr_lock_trace =
+	LOCK_TRACE_INITIALIZER(LOCK_TRACE_ASSOC_MGR, "assoc_mgr",
+			       assoc_mgr_entity_names, ASSOC_MGR_ENTITY_COUNT);
+
 static assoc_init_args_t init_setup;
 static slurmdb_assoc_rec_t **assoc_hash_id = NULL;
 static slurmdb_assoc_rec_t **assoc_hash = NULL;
+static uint32_t assoc_hash_size = ASSOC_HASH_SIZE;
+static uint32_t assoc_hash_cnt = 0;	/* records in the assoc hash tables */
+
+/*
+ * assoc_mgr_user_list indexed by uid. It is rebuilt on the first lookup
+ * after the user lock was write locked, and not used while it is.
+ */
+static xhash_t *user_uid_hash = NULL;
+static bool user_uid_hash_valid = false;
+static bool user_write_locked = false;
+static pthread_mutex_t user_uid_hash_mutex = PTHREAD_MUTEX_INITIALIZER;
 static int *assoc_mgr_tres_old_pos = NULL;
 
+/* Share information of all associations as of the last decay cycle */
+typedef struct {
+	List assoc_shares_list;	/* assoc_shares_object_t list */
+	uint32_t tres_cnt;
+	int ref_cnt;		/* one for shares_snapshot plus one per reader */
+} shares_snapshot_t;
+
+/* Served to sshare, NULL until built and after associations change */
+static shares_snapshot_t *shares_snapshot = NULL;
+static uint32_t shares_snapshot_gen = 0; /* bumped when associations change */
+static pthread_mutex_t shares_snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void _shares_snapshot_release(shares_snapshot_t *snapshot)
+{
+	bool free_it;
+
+	if (!snapshot)
+		return;
+
+	slurm_mutex_lock(&shares_snapshot_mutex);
+	free_it = (--snapshot->ref_cnt == 0);
+	slurm_mutex_unlock(&shares_snapshot_mutex);
+
+	if (free_it) {
+		FREE_NULL_LIST(snapshot->assoc_shares_list);
+		xfree(snapshot);
+	}
+}
+
+/* Serve sshare live until the next snapshot, associations have changed */
+static void _shares_snapshot_clear(void)
+{
+	shares_snapshot_t *snapshot;
+
+	slurm_mutex_lock(&shares_snapshot_mutex);
+	snapshot = shares_snapshot;
+	shares_snapshot = NULL;
+	shares_snapshot_gen++;
+	slurm_mutex_unlock(&shares_snapshot_mutex);
+
+	_shares_snapshot_release(snapshot);
+}
+
 static bool _running_cache(void)
 {
 	if (init_setup.running_cache &&
@@ -87,29 +151,26 @@ static bool _running_cache(void)
 	return false;
 }
 
-static int _get_str_inx(char *name)
+/* Case insensitive string hash, names are compared with xstrcasecmp() */
+static uint32_t _get_str_inx(char *name)
 {
-	int j, index = 0;
+	uint32_t index = 0;
 
 	if (!name)
 		return 0;
 
-	for (j = 1; *name; name++, j++)
-		index += (int)tolower(*name) * j;
+	for (; *name; name++)
+		index = (index * 31) + (uint32_t)tolower(*name);
 
 	return index;
 }
 
-static int _assoc_hash_index(slurmdb_assoc_rec_t *assoc)
+static uint32_t _assoc_hash_index(slurmdb_assoc_rec_t *assoc)
 {
-	int index;
+	uint32_t index;
 
 	xassert(assoc);
 
-	/* Multiply each character by its numerical position in the
-	 * name string to add a bit of entropy.
-	 */
-
 	index = assoc->uid;
 
 	/* only set on the slurmdbd */
@@ -120,25 +181,60 @@ static int _assoc_hash_index(slurmdb_assoc_rec_t *assoc)
 		index += _get_str_inx(assoc->acct);
 
 	if (assoc->partition)
-		index += _get_str_inx(assoc->partition);
+		index += _get_str_inx(assoc->partition) * 7;
 
-	index %= ASSOC_HASH_SIZE;
-	if (index < 0)
-		index += ASSOC_HASH_SIZE;
+	return index % assoc_hash_size;
+}
 
-	return index;
+/* Grow the assoc hash tables so their chains stay short */
+static void _resize_assoc_hash(void)
+{
+	slurmdb_assoc_rec_t **old_hash_id = assoc_hash_id;
+	slurmdb_assoc_rec_t *assoc, *next;
+	uint32_t i, inx, old_size = assoc_hash_size;
+
+	assoc_hash_size *= 4;
+	assoc_hash_id = xcalloc(assoc_hash_size, sizeof(slurmdb_assoc_rec_t *));
+	xfree(assoc_hash);
+	assoc_hash = xcalloc(assoc_hash_size, sizeof(slurmdb_assoc_rec_t *));
+
+	/* Every record is in exactly one chain of each table */
+	for (i = 0; i < old_size; i++) {
+		for (assoc = old_hash_id[i]; assoc; assoc = next) {
+			next = assoc->assoc_next_id;
+
+			inx = ASSOC_HASH_ID_INX(assoc->id);
+			assoc->assoc_next_id = assoc_hash_id[inx];
+			assoc_hash_id[inx] = assoc;
+
+			inx = _assoc_hash_index(assoc);
+			assoc->assoc_next = assoc_hash[inx];
+			assoc_hash[inx] = assoc;
+		}
+	}
+	xfree(old_hash_id);
+
+	debug2("%s: %u associations, hash size now %u",
+	       __func__, assoc_hash_cnt, assoc_hash_size);
+}
 
+static void _free_assoc_hash(void)
+{
+	xfree(assoc_hash_id);
+	xfree(assoc_hash);
+	assoc_hash_size = ASSOC_HASH_SIZE;
+	assoc_hash_cnt = 0;
 }
 
 static void _add_assoc_hash(slurmdb_assoc_rec_t *assoc)
 {
-	int inx = ASSOC_HASH_ID_INX(assoc->id);
+	uint32_t inx = ASSOC_HASH_ID_INX(assoc->id);
 
 	if (!assoc_hash_id)
-		assoc_hash_id = xcalloc(ASSOC_HASH_SIZE,
+		assoc_hash_id = xcalloc(assoc_hash_size,
 					sizeof(slurmdb_assoc_rec_t *));
 	if (!assoc_hash)
-		assoc_hash = xcalloc(ASSOC_HASH_SIZE,
+		assoc_hash = xcalloc(assoc_hash_size,
 				     sizeof(slurmdb_assoc_rec_t *));
 
 	assoc->assoc_next_id = assoc_hash_id[inx];
@@ -147,6 +243,9 @@ static void _add_assoc_hash(slurmdb_assoc_rec_t *assoc)
 	inx = _assoc_hash_index(assoc);
 	assoc->assoc_next = assoc_hash[inx];
 	assoc_hash[inx] = assoc;
+
+	if (++assoc_hash_cnt > assoc_hash_size)
+		_resize_assoc_hash();
 }
 
 static bool _remove_from_assoc_list(slurmdb_assoc_rec_t *assoc)
@@ -196,7 +295,7 @@ static slurmdb_assoc_rec_t *_find_assoc_rec(
 	slurmdb_assoc_rec_t *assoc)
 {
 	slurmdb_assoc_rec_t *assoc_ptr;
-	int inx;
+	uint32_t inx;
 
 	/* We can only use _find_assoc_rec_id if we are not on the slurmdbd */
 	if (assoc->id && !slurmdbd_conf)
@@ -314,6 +413,8 @@ static void _delete_assoc_hash(slurmdb_assoc_rec_t *assoc)
 		return;	/* Fix CLANG false positive error */
 	} else
 		*assoc_pptr = assoc_ptr->assoc_next;
+
+	assoc_hash_cnt--;
 }
 
 
@@ -677,6 +778,51 @@ static int _list_find_uid(void *x, void *key)
 	return 0;
 }
 
+static void _user_uid_identity(void *item, const char **key,
+			       uint32_t *key_len)
+{
+	slurmdb_user_rec_t *user = (slurmdb_user_rec_t *) item;
+
+	*key = (const char *) &user->uid;
+	*key_len = sizeof(user->uid);
+}
+
+/*
+ * Return the first user of assoc_mgr_user_list with the given uid.
+ * Call with the assoc_mgr user lock held.
+ */
+static slurmdb_user_rec_t *_find_user_uid(uint32_t uid)
+{
+	slurmdb_user_rec_t *user;
+	ListIterator itr;
+
+	if (!assoc_mgr_user_list)
+		return NULL;
+
+	/* Users may be changing under the write lock, don't index them */
+	if (user_write_locked)
+		return list_find_first(assoc_mgr_user_list, _list_find_uid,
+				       &uid);
+
+	slurm_mutex_lock(&user_uid_hash_mutex);
+	if (!user_uid_hash_valid) {
+		xhash_free(user_uid_hash);
+		user_uid_hash = xhash_init(_user_uid_identity, NULL);
+		itr = list_iterator_create(assoc_mgr_user_list);
+		while ((user = list_next(itr))) {
+			if (!xhash_get(user_uid_hash, (const char *) &user->uid,
+				       sizeof(user->uid)))
+				xhash_add(user_uid_hash, user);
+		}
+		list_iterator_destroy(itr);
+		user_uid_hash_valid = true;
+	}
+	user = xhash_get(user_uid_hash, (const char *) &uid, sizeof(uid));
+	slurm_mutex_unlock(&user_uid_hash_mutex);
+
+	return user;
+}
+
 /* locks should be put in place before calling this function USER_WRITE */
 static void _set_user_default_acct(slurmdb_assoc_rec_t *assoc)
 {
@@ -686,8 +832,7 @@ static void _set_user_default_acct(slurmdb_assoc_rec_t *assoc)
 
 	/* set up the default if this is it */
 	if ((assoc->is_def == 1) && (assoc->uid != NO_VAL)) {
-		slurmdb_user_rec_t *user = list_find_first(
-			assoc_mgr_user_list, _list_find_uid, &assoc->uid);
+		slurmdb_user_rec_t *user = _find_user_uid(assoc->uid);
 
 		if (!user)
 			return;
@@ -713,8 +858,7 @@ static void _set_user_default_wckey(slurmdb_wckey_rec_t *wckey)
 
 	/* set up the default if this is it */
 	if ((wckey->is_def == 1) && (wckey->uid != NO_VAL)) {
-		slurmdb_user_rec_t *user = list_find_first(
-			assoc_mgr_user_list, _list_find_uid, &wckey->uid);
+		slurmdb_user_rec_t *user = _find_user_uid(wckey->uid);
 
 		if (!user)
 			return;
@@ -1009,14 +1153,15 @@ static int _post_assoc_list(void)
 
 	xassert(verify_assoc_lock(ASSOC_LOCK, WRITE_LOCK));
 	xassert(verify_assoc_lock(QOS_LOCK, READ_LOCK));
+
+	_shares_snapshot_clear();
 	xassert(verify_assoc_lock(TRES_LOCK, READ_LOCK));
 	xassert(verify_assoc_lock(USER_LOCK, WRITE_LOCK));
 
 	if (!assoc_mgr_assoc_list)
 		return SLURM_ERROR;
 
-	xfree(assoc_hash_id);
-	xfree(assoc_hash);
+	_free_assoc_hash();
 
 	itr = list_iterator_create(assoc_mgr_assoc_list);
 
@@ -1047,6 +1192,7 @@ static int _post_assoc_list(void)
 			assoc_mgr_normalize_assoc_shares(assoc);
 	}
 	list_iterator_destroy(itr);
+	g_assoc_tree_gen++;
 
 	_calculate_assoc_norm_priorities(true);
 
@@ -1494,21 +1640,23 @@ static int _get_assoc_mgr_tres_list(void *db_conn, int enforce)
 
 	memset(&tres_q, 0, sizeof(slurmdb_tres_cond_t));
 
-	assoc_mgr_lock(&locks);
-
 	/* If this exists we only want/care about tracking/caching these TRES */
 	if (slurm_conf.accounting_storage_tres) {
 		tres_q.type_list = list_create(xfree_ptr);
 		slurm_addto_char_list(tres_q.type_list,
 				      slurm_conf.accounting_storage_tres);
 	}
+
+	/*
+	 * Talk to the database before locking so a slow or disconnected
+	 * slurmdbd does not stall everything waiting on the TRES locks.
+	 */
 	new_list = acct_storage_g_get_tres(
 		db_conn, uid, &tres_q);
 
 	FREE_NULL_LIST(tres_q.type_list);
 
 	if (!new_list) {
-		assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_ASSOCS) {
 			error("%s: no list was made.", __func__);
 			return SLURM_ERROR;
@@ -1517,6 +1665,8 @@ static int _get_assoc_mgr_tres_list(void *db_conn, int enforce)
 		}
 	}
 
+	assoc_mgr_lock(&locks);
+
 	changed = assoc_mgr_post_tres_list(new_list);
 
 	assoc_mgr_unlock(&locks);
@@ -1741,7 +1891,7 @@ static int _refresh_assoc_mgr_tres_list(void *db_conn, int enforce)
 static int _refresh_assoc_mgr_assoc_list(void *db_conn, int enforce)
 {
 	slurmdb_assoc_cond_t assoc_q;
-	List current_assocs = NULL;
+	List current_assocs = NULL, new_assocs = NULL;
 	uid_t uid = getuid();
 	ListIterator curr_itr = NULL;
 	slurmdb_assoc_rec_t *curr_assoc = NULL, *assoc = NULL;
@@ -1758,26 +1908,28 @@ static int _refresh_assoc_mgr_assoc_list(void *db_conn, int enforce)
 		      __func__);
 	}
 
-	assoc_mgr_lock(&locks);
-
-	current_assocs = assoc_mgr_assoc_list;
-
+	/*
+	 * Pull the new list before taking the write locks.  On a large
+	 * site this can take a long time and nothing in the cached list is
+	 * touched until we swap it in below.
+	 */
 //	START_TIMER;
-	assoc_mgr_assoc_list =
-		acct_storage_g_get_assocs(db_conn, uid, &assoc_q);
+	new_assocs = acct_storage_g_get_assocs(db_conn, uid, &assoc_q);
 //	END_TIMER2("get_assocs");
 
 	FREE_NULL_LIST(assoc_q.cluster_list);
 
-	if (!assoc_mgr_assoc_list) {
-		assoc_mgr_assoc_list = current_assocs;
-		assoc_mgr_unlock(&locks);
-
+	if (!new_assocs) {
 		error("%s: no new list given back keeping cached one.",
 		      __func__);
 		return SLURM_ERROR;
 	}
 
+	assoc_mgr_lock(&locks);
+
+	current_assocs = assoc_mgr_assoc_list;
+	assoc_mgr_assoc_list = new_assocs;
+
 	_post_assoc_list();
 
 	if (!current_assocs) {
@@ -2066,6 +2218,7 @@ extern int assoc_mgr_fini(bool save_state)
 	if (save_state)
 		dump_assoc_mgr_state();
 
+	_shares_snapshot_clear();
 	assoc_mgr_lock(&locks);
 
 	FREE_NULL_LIST(assoc_mgr_assoc_list);
@@ -2087,14 +2240,14 @@ extern int assoc_mgr_fini(bool save_state)
 	assoc_mgr_qos_list = NULL;
 	assoc_mgr_user_list = NULL;
 	assoc_mgr_wckey_list = NULL;
+	xhash_free(user_uid_hash);
 
 	assoc_mgr_root_assoc = NULL;
 
 	if (_running_cache())
 		*init_setup.running_cache = RUNNING_CACHE_STATE_NOTRUNNING;
 
-	xfree(assoc_hash_id);
-	xfree(assoc_hash);
+	_free_assoc_hash();
 
 	assoc_mgr_unlock(&locks);
 
@@ -2154,9 +2307,63 @@ bool verify_assoc_lock(assoc_mgr_lock_datatype_t datatype, lock_level_t level)
 }
 #endif
 
-extern void assoc_mgr_lock(assoc_mgr_lock_t *locks)
+/*
+ * Take one lock, timing the wait only if the lock is contended
+ * RET usec spent blocked
+ */
+static long _lock_entity(assoc_mgr_lock_datatype_t datatype,
+			 lock_level_t level, uint32_t *read_mask,
+			 uint32_t *write_mask)
+{
+	struct timeval tv = {0, 0};
+
+	if (level == READ_LOCK) {
+		*read_mask |= (1 << datatype);
+		if (!slurm_rwlock_tryrdlock(&assoc_mgr_locks[datatype]))
+			return 0;
+		slurm_delta_tv(&tv);
+		slurm_rwlock_rdlock(&assoc_mgr_locks[datatype]);
+	} else if (level == WRITE_LOCK) {
+		*write_mask |= (1 << datatype);
+		if (!slurm_rwlock_trywrlock(&assoc_mgr_locks[datatype]))
+			return 0;
+		slurm_delta_tv(&tv);
+		slurm_rwlock_wrlock(&assoc_mgr_locks[datatype]);
+	} else
+		return 0;
+
+	return slurm_delta_tv(&tv);
+}
+
+static void _lock_mask_add(assoc_mgr_lock_datatype_t datatype,
+			   lock_level_t level, uint32_t *read_mask,
+			   uint32_t *write_mask)
+{
+	if (level == READ_LOCK)
+		*read_mask |= (1 << datatype);
+	else if (level == WRITE_LOCK)
+		*write_mask |= (1 << datatype);
+}
+
+/* Build the lock_trace_acquired() masks of a set of lock levels */
+static void _lock_masks(assoc_mgr_lock_t *locks, uint32_t *read_mask,
+			uint32_t *write_mask)
+{
+	*read_mask = *write_mask = 0;
+	_lock_mask_add(ASSOC_LOCK, locks->assoc, read_mask, write_mask);
+	_lock_mask_add(FILE_LOCK, locks->file, read_mask, write_mask);
+	_lock_mask_add(QOS_LOCK, locks->qos, read_mask, write_mask);
+	_lock_mask_add(RES_LOCK, locks->res, read_mask, write_mask);
+	_lock_mask_add(TRES_LOCK, locks->tres, read_mask, write_mask);
+	_lock_mask_add(USER_LOCK, locks->user, read_mask, write_mask);
+	_lock_mask_add(WCKEY_LOCK, locks->wckey, read_mask, write_mask);
+}
+
+extern void assoc_mgr_lock_at(assoc_mgr_lock_t *locks, const char *site)
 {
 	static bool init_run = false;
+	uint32_t read_mask = 0, write_mask = 0;
+	long wait_usec = 0;
 	xassert(_store_locks(locks));
 
 	slurm_mutex_lock(&assoc_lock_init);
@@ -2167,49 +2374,42 @@ extern void assoc_mgr_lock(assoc_mgr_lock_t *locks)
 	}
 	slurm_mutex_unlock(&assoc_lock_init);
 
-	if (locks->assoc == READ_LOCK)
-		slurm_rwlock_rdlock(&assoc_mgr_locks[ASSOC_LOCK]);
-	else if (locks->assoc == WRITE_LOCK)
-		slurm_rwlock_wrlock(&assoc_mgr_locks[ASSOC_LOCK]);
-
-	if (locks->file == READ_LOCK)
-		slurm_rwlock_rdlock(&assoc_mgr_locks[FILE_LOCK]);
-	else if (locks->file == WRITE_LOCK)
-		slurm_rwlock_wrlock(&assoc_mgr_locks[FILE_LOCK]);
-
-	if (locks->qos == READ_LOCK)
-		slurm_rwlock_rdlock(&assoc_mgr_locks[QOS_LOCK]);
-	else if (locks->qos == WRITE_LOCK)
-		slurm_rwlock_wrlock(&assoc_mgr_locks[QOS_LOCK]);
-
-	if (locks->res == READ_LOCK)
-		slurm_rwlock_rdlock(&assoc_mgr_locks[RES_LOCK]);
-	else if (locks->res == WRITE_LOCK)
-		slurm_rwlock_wrlock(&assoc_mgr_locks[RES_LOCK]);
-
-	if (locks->tres == READ_LOCK)
-		slurm_rwlock_rdlock(&assoc_mgr_locks[TRES_LOCK]);
-	else if (locks->tres == WRITE_LOCK)
-		slurm_rwlock_wrlock(&assoc_mgr_locks[TRES_LOCK]);
-
-	if (locks->user == READ_LOCK)
-		slurm_rwlock_rdlock(&assoc_mgr_locks[USER_LOCK]);
-	else if (locks->user == WRITE_LOCK)
-		slurm_rwlock_wrlock(&assoc_mgr_locks[USER_LOCK]);
-
-	if (locks->wckey == READ_LOCK)
-		slurm_rwlock_rdlock(&assoc_mgr_locks[WCKEY_LOCK]);
-	else if (locks->wckey == WRITE_LOCK)
-		slurm_rwlock_wrlock(&assoc_mgr_locks[WCKEY_LOCK]);
+	wait_usec += _lock_entity(ASSOC_LOCK, locks->assoc,
+				  &read_mask, &write_mask);
+	wait_usec += _lock_entity(FILE_LOCK, locks->file,
+				  &read_mask, &write_mask);
+	wait_usec += _lock_entity(QOS_LOCK, locks->qos,
+				  &read_mask, &write_mask);
+	wait_usec += _lock_entity(RES_LOCK, locks->res,
+				  &read_mask, &write_mask);
+	wait_usec += _lock_entity(TRES_LOCK, locks->tres,
+				  &read_mask, &write_mask);
+	wait_usec += _lock_entity(USER_LOCK, locks->user,
+				  &read_mask, &write_mask);
+	if (locks->user == WRITE_LOCK) {
+		user_write_locked = true;
+		user_uid_hash_valid = false;
+	}
+	wait_usec += _lock_entity(WCKEY_LOCK, locks->wckey,
+				  &read_mask, &write_mask);
+
+	lock_trace_acquired(&assoc_mgr_lock_trace, site, wait_usec,
+			    read_mask, write_mask);
 }
 
 extern void assoc_mgr_unlock(assoc_mgr_lock_t *locks)
 {
+	uint32_t read_mask, write_mask;
 	xassert(_clear_locks(locks));
 
+	_lock_masks(locks, &read_mask, &write_mask);
+	lock_trace_release(&assoc_mgr_lock_trace, read_mask, write_mask);
+
 	if (locks->wckey)
 		slurm_rwlock_unlock(&assoc_mgr_locks[WCKEY_LOCK]);
 
+	if (locks->user == WRITE_LOCK)
+		user_write_locked = false;
 	if (locks->user)
 		slurm_rwlock_unlock(&assoc_mgr_locks[USER_LOCK]);
 
@@ -2621,16 +2821,16 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
 		return SLURM_SUCCESS;
 	}
 
-	itr = list_iterator_create(assoc_mgr_user_list);
-	while ((found_user = list_next(itr))) {
-		if (user->uid != NO_VAL) {
-			if (user->uid == found_user->uid)
+	if (user->uid != NO_VAL)
+		found_user = _find_user_uid(user->uid);
+	else if (user->name) {
+		itr = list_iterator_create(assoc_mgr_user_list);
+		while ((found_user = list_next(itr))) {
+			if (!xstrcasecmp(user->name, found_user->name))
 				break;
-		} else if (user->name
-			   && !xstrcasecmp(user->name, found_user->name))
-			break;
+		}
+		list_iterator_destroy(itr);
 	}
-	list_iterator_destroy(itr);
 
 	if (!found_user) {
 		if (!locked)
@@ -3007,7 +3207,7 @@ extern slurmdb_admin_level_t assoc_mgr_get_admin_level(void *db_conn,
 		return SLURMDB_ADMIN_NOTSET;
 	}
 
-	found_user = list_find_first(assoc_mgr_user_list, _list_find_uid, &uid);
+	found_user = _find_user_uid(uid);
 
 	if (found_user)
 		level = found_user->admin_level;
@@ -3039,8 +3239,7 @@ extern bool assoc_mgr_is_user_acct_coord(void *db_conn,
 		return false;
 	}
 
-	found_user = list_find_first(assoc_mgr_user_list, _list_find_uid,
-				     &uid);
+	found_user = _find_user_uid(uid);
 
 	if (!found_user || !found_user->coord_accts) {
 		assoc_mgr_unlock(&locks);
@@ -3062,9 +3261,10 @@ extern bool assoc_mgr_is_user_acct_coord(void *db_conn,
 	return false;
 }
 
-extern void assoc_mgr_get_shares(void *db_conn,
-				 uid_t uid, shares_request_msg_t *req_msg,
-				 shares_response_msg_t *resp_msg)
+/* Build the share information from the association list itself */
+static void _get_shares_live(void *db_conn,
+			     uid_t uid, shares_request_msg_t *req_msg,
+			     shares_response_msg_t *resp_msg)
 {
 	ListIterator itr = NULL;
 	ListIterator user_itr = NULL;
@@ -3257,6 +3457,180 @@ end_it:
 	return;
 }
 
+static assoc_shares_object_t *_copy_shares_object(
+	assoc_shares_object_t *share, uint32_t tres_cnt)
+{
+	assoc_shares_object_t *copy = xmalloc(sizeof(*copy));
+
+	memcpy(copy, share, sizeof(*copy));
+	copy->cluster = xstrdup(share->cluster);
+	copy->name = xstrdup(share->name);
+	copy->parent = xstrdup(share->parent);
+	copy->partition = xstrdup(share->partition);
+	copy->tres_run_secs = xcalloc(tres_cnt, sizeof(uint64_t));
+	memcpy(copy->tres_run_secs, share->tres_run_secs,
+	       sizeof(uint64_t) * tres_cnt);
+	copy->tres_grp_mins = xcalloc(tres_cnt, sizeof(uint64_t));
+	memcpy(copy->tres_grp_mins, share->tres_grp_mins,
+	       sizeof(uint64_t) * tres_cnt);
+	copy->usage_tres_raw = xcalloc(tres_cnt, sizeof(long double));
+	memcpy(copy->usage_tres_raw, share->usage_tres_raw,
+	       sizeof(long double) * tres_cnt);
+
+	return copy;
+}
+
+static bool _str_in_list(ListIterator itr, char *name)
+{
+	char *tmp_char;
+
+	while ((tmp_char = list_next(itr))) {
+		if (!xstrcasecmp(tmp_char, name))
+			break;
+	}
+	list_iterator_reset(itr);
+
+	return (tmp_char != NULL);
+}
+
+/*
+ * Filter the share information of a snapshot the caller holds a reference
+ * of, with the same user, account and PrivateData=usage checks as
+ * _get_shares_live()
+ */
+static void _get_shares_snapshot(shares_snapshot_t *snapshot, void *db_conn,
+				 uid_t uid, shares_request_msg_t *req_msg,
+				 shares_response_msg_t *resp_msg)
+{
+	ListIterator itr, user_itr = NULL, acct_itr = NULL, coord_itr;
+	assoc_shares_object_t *share;
+	slurmdb_coord_rec_t *coord;
+	slurmdb_user_rec_t user;
+	char *acct;
+	bool is_admin = true;
+
+	memset(&user, 0, sizeof(slurmdb_user_rec_t));
+	user.uid = uid;
+
+	if (slurm_conf.private_data & PRIVATE_DATA_USAGE) {
+		is_admin = false;
+		if ((uid == slurm_conf.slurm_user_id) || (uid == 0) ||
+		    (assoc_mgr_get_admin_level(db_conn, uid) >=
+		     SLURMDB_ADMIN_OPERATOR))
+			is_admin = true;
+		else if (assoc_mgr_fill_in_user(
+				 db_conn, &user, ACCOUNTING_ENFORCE_ASSOCS,
+				 NULL, false) == SLURM_ERROR) {
+			debug3("User %d not found", user.uid);
+			return;
+		}
+	}
+
+	if (req_msg) {
+		if (req_msg->user_list && list_count(req_msg->user_list))
+			user_itr = list_iterator_create(req_msg->user_list);
+		if (req_msg->acct_list && list_count(req_msg->acct_list))
+			acct_itr = list_iterator_create(req_msg->acct_list);
+	}
+
+	resp_msg->assoc_shares_list =
+		list_create(slurm_destroy_assoc_shares_object);
+	resp_msg->tres_cnt = snapshot->tres_cnt;
+	/* DON'T FREE, see _get_shares_live() */
+	resp_msg->tres_names = assoc_mgr_tres_name_array;
+
+	itr = list_iterator_create(snapshot->assoc_shares_list);
+	while ((share = list_next(itr))) {
+		/* User associations hang off their account */
+		acct = share->user ? share->parent : share->name;
+
+		if (user_itr && share->user && !_str_in_list(user_itr,
+							     share->name))
+			continue;
+		if (acct_itr && !_str_in_list(acct_itr, acct))
+			continue;
+
+		if (!is_admin &&
+		    (!share->user || xstrcmp(share->name, user.name))) {
+			if (!user.coord_accts || !acct)
+				continue;
+			coord_itr = list_iterator_create(user.coord_accts);
+			while ((coord = list_next(coord_itr))) {
+				if (!xstrcasecmp(coord->name, acct))
+					break;
+			}
+			list_iterator_destroy(coord_itr);
+			if (!coord)
+				continue;
+		}
+
+		list_append(resp_msg->assoc_shares_list,
+			    _copy_shares_object(share, snapshot->tres_cnt));
+	}
+	list_iterator_destroy(itr);
+
+	if (user_itr)
+		list_iterator_destroy(user_itr);
+	if (acct_itr)
+		list_iterator_destroy(acct_itr);
+}
+
+extern void assoc_mgr_get_shares(void *db_conn,
+				 uid_t uid, shares_request_msg_t *req_msg,
+				 shares_response_msg_t *resp_msg)
+{
+	shares_snapshot_t *snapshot;
+
+	xassert(resp_msg);
+
+	slurm_mutex_lock(&shares_snapshot_mutex);
+	if ((snapshot = shares_snapshot))
+		snapshot->ref_cnt++;
+	slurm_mutex_unlock(&shares_snapshot_mutex);
+
+	if (!snapshot) {
+		_get_shares_live(db_conn, uid, req_msg, resp_msg);
+		return;
+	}
+
+	_get_shares_snapshot(snapshot, db_conn, uid, req_msg, resp_msg);
+	_shares_snapshot_release(snapshot);
+}
+
+extern void assoc_mgr_build_shares_snapshot(void)
+{
+	shares_response_msg_t resp_msg;
+	shares_snapshot_t *snapshot, *old_snapshot = NULL;
+	uint32_t gen;
+
+	slurm_mutex_lock(&shares_snapshot_mutex);
+	gen = shares_snapshot_gen;
+	slurm_mutex_unlock(&shares_snapshot_mutex);
+
+	/* uid 0 sees every association */
+	memset(&resp_msg, 0, sizeof(resp_msg));
+	_get_shares_live(NULL, 0, NULL, &resp_msg);
+	if (!resp_msg.assoc_shares_list)
+		return;
+
+	snapshot = xmalloc(sizeof(shares_snapshot_t));
+	snapshot->assoc_shares_list = resp_msg.assoc_shares_list;
+	snapshot->tres_cnt = resp_msg.tres_cnt;
+	snapshot->ref_cnt = 1;
+
+	slurm_mutex_lock(&shares_snapshot_mutex);
+	/* Associations changed while it was built, it would be stale */
+	if (gen == shares_snapshot_gen) {
+		old_snapshot = shares_snapshot;
+		shares_snapshot = snapshot;
+		snapshot = NULL;
+	}
+	slurm_mutex_unlock(&shares_snapshot_mutex);
+
+	_shares_snapshot_release(old_snapshot);
+	_shares_snapshot_release(snapshot);
+}
+
 extern void assoc_mgr_info_get_pack_msg(
 	char **buffer_ptr, int *buffer_size,
 	assoc_mgr_info_request_msg_t *msg, uid_t uid,
@@ -3649,6 +4023,7 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update, bool locked)
 			assoc_mgr_unlock(&locks);
 		return SLURM_SUCCESS;
 	}
+	_shares_snapshot_clear();
 
 	while ((object = list_pop(update->objects))) {
 		bool update_jobs = false;
@@ -3799,6 +4174,8 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update, bool locked)
 					rec->max_tres_run_mins, INFINITE64, 1);
 			}
 
+			assoc_mgr_set_assoc_tres_unlimited(rec);
+
 			if (object->max_jobs != NO_VAL)
 				rec->max_jobs = object->max_jobs;
 			if (object->max_jobs_accrue != NO_VAL)
@@ -3971,6 +4348,7 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update, bool locked)
 			if (rec->priority == g_assoc_max_priority)
 				redo_priority = 2;
 
+			g_assoc_tree_gen++;
 			_delete_assoc_hash(rec);
 			_remove_from_assoc_list(rec);
 			if (init_setup.remove_assoc_notify) {
@@ -4008,6 +4386,7 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update, bool locked)
 	if (parents_changed) {
 		int reset = 1;
 		g_user_assoc_count = 0;
+		g_assoc_tree_gen++;
 		slurmdb_sort_hierarchical_assoc_list(
 			assoc_mgr_assoc_list, true);
 
@@ -4395,6 +4774,8 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 	itr = list_iterator_create(assoc_mgr_qos_list);
 	while ((object = list_pop(update->objects))) {
 		bool update_jobs = false;
+		/* changes the order jobs are preempted in */
+		bool update_preempt = false;
 		list_iterator_reset(itr);
 		while ((rec = list_next(itr))) {
 			if (object->id == rec->id) {
@@ -4647,6 +5028,7 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 
 				rec->preempt_bitstr = object->preempt_bitstr;
 				object->preempt_bitstr = NULL;
+				update_preempt = true;
 				/* char *tmp = get_qos_complete_str_bitstr( */
 /* 					assoc_mgr_qos_list, */
 /* 					rec->preempt_bitstr); */
@@ -4656,14 +5038,19 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 /* 				xfree(tmp); */
 			}
 
-			if (object->preempt_mode != NO_VAL16)
+			if (object->preempt_mode != NO_VAL16) {
 				rec->preempt_mode = object->preempt_mode;
+				update_preempt = true;
+			}
 
-			if (object->preempt_exempt_time != NO_VAL)
+			if (object->preempt_exempt_time != NO_VAL) {
 				rec->preempt_exempt_time =
 					object->preempt_exempt_time;
+				update_preempt = true;
+			}
 
 			if (object->priority != NO_VAL) {
+				update_preempt = true;
 				if (rec->priority == g_qos_max_priority)
 					redo_priority = 2;
 
@@ -4685,7 +5072,8 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 			if (!fuzzy_equal(object->limit_factor, NO_VAL))
 				rec->limit_factor = object->limit_factor;
 
-			if (update_jobs && init_setup.update_qos_notify) {
+			if ((update_jobs || update_preempt) &&
+			    init_setup.update_qos_notify) {
 				/* since there are some deadlock
 				   issues while inside our lock here
 				   we have to process a notify later
@@ -5145,7 +5533,7 @@ static char *_make_usage_tres_raw_str(long double *tres_cnt)
 static void _set_usage_tres_raw(long double *tres_cnt, char *tres_str)
 {
 	char *tmp_str = tres_str;
-	int pos, id;
+	int pos = 0, id;
 	char *endptr;
 	slurmdb_tres_rec_t tres_rec;
 
@@ -5173,11 +5561,20 @@ static void _set_usage_tres_raw(long double *tres_cnt, char *tres_str)
 			break;
 		}
 
-		tres_rec.id = id;
-		pos = assoc_mgr_find_tres_pos(&tres_rec, true);
+		/*
+		 * _make_usage_tres_raw_str() writes the ids in
+		 * assoc_mgr_tres_array order, so try the slot after the last
+		 * one before searching the array.
+		 */
+		if ((pos < 0) || (pos >= g_tres_count) ||
+		    !assoc_mgr_tres_array[pos] ||
+		    (assoc_mgr_tres_array[pos]->id != id)) {
+			tres_rec.id = id;
+			pos = assoc_mgr_find_tres_pos(&tres_rec, true);
+		}
 		if (pos != -1) {
 			/* set the index to the count */
-			tres_cnt[pos] = strtold(++tmp_str, &endptr);
+			tres_cnt[pos++] = strtold(++tmp_str, &endptr);
 		} else {
 			debug("%s: no tres of id %u found in the array",
 			      __func__, tres_rec.id);
@@ -5191,6 +5588,24 @@ static void _set_usage_tres_raw(long double *tres_cnt, char *tres_str)
 	return;
 }
 
+/*
+ * Point *tres_str at the packed usage string inside the (mmap'ed) state
+ * buffer instead of copying it out.  Only valid until the buffer is freed.
+ */
+static int _unpack_usage_tres_str(char **tres_str, buf_t *buffer)
+{
+	uint32_t len = 0;
+
+	if (unpackmem_ptr(tres_str, &len, buffer))
+		return SLURM_ERROR;
+
+	/* packstr() includes the terminating NUL, refuse anything else */
+	if (len && (*tres_str)[len - 1])
+		return SLURM_ERROR;
+
+	return SLURM_SUCCESS;
+}
+
 extern void assoc_mgr_remove_assoc_usage(slurmdb_assoc_rec_t *assoc)
 {
 	char *child;
@@ -5212,6 +5627,7 @@ extern void assoc_mgr_remove_assoc_usage(slurmdb_assoc_rec_t *assoc)
 		child_str = assoc->acct;
 	}
 	info("Resetting usage for %s %s", child, child_str);
+	g_assoc_tree_gen++;
 
 	old_usage_raw = assoc->usage->usage_raw;
 	/* clang needs this memset to avoid a warning */
@@ -5643,12 +6059,12 @@ extern int load_assoc_usage(void)
 		uint32_t grp_used_wall = 0;
 		long double usage_raw = 0;
 		slurmdb_assoc_rec_t *assoc = NULL;
-		uint32_t tmp32;
 		long double usage_tres_raw[g_tres_count];
 
 		safe_unpack32(&assoc_id, buffer);
 		safe_unpacklongdouble(&usage_raw, buffer);
-		safe_unpackstr_xmalloc(&tmp_str, &tmp32, buffer);
+		if (_unpack_usage_tres_str(&tmp_str, buffer))
+			goto unpack_error;
 		safe_unpack32(&grp_used_wall, buffer);
 
 		assoc = _find_assoc_rec_id(assoc_id);
@@ -5674,8 +6090,6 @@ extern int load_assoc_usage(void)
 					usage_tres_raw[i];
 			assoc = assoc->usage->parent_assoc_ptr;
 		}
-
-		xfree(tmp_str);
 	}
 	assoc_mgr_unlock(&locks);
 
@@ -5689,7 +6103,6 @@ unpack_error:
 
 	free_buf(buffer);
 
-	xfree(tmp_str);
 	assoc_mgr_unlock(&locks);
 	return SLURM_ERROR;
 }
@@ -5746,27 +6159,31 @@ extern int load_qos_usage(void)
 	while (remaining_buf(buffer) > 0) {
 		uint32_t qos_id = 0;
 		uint32_t grp_used_wall = 0;
-		uint32_t tmp32;
 		long double usage_raw = 0;
 		slurmdb_qos_rec_t *qos = NULL;
 
 		safe_unpack32(&qos_id, buffer);
 		safe_unpacklongdouble(&usage_raw, buffer);
-		safe_unpackstr_xmalloc(&tmp_str, &tmp32, buffer);
+		if (_unpack_usage_tres_str(&tmp_str, buffer))
+			goto unpack_error;
 		safe_unpack32(&grp_used_wall, buffer);
 
-		while ((qos = list_next(itr)))
-			if (qos->id == qos_id)
-				break;
+		/*
+		 * The file is written in assoc_mgr_qos_list order, so the
+		 * record is normally the one after the last match.
+		 */
+		if (!(qos = list_next(itr)) || (qos->id != qos_id)) {
+			list_iterator_reset(itr);
+			while ((qos = list_next(itr)))
+				if (qos->id == qos_id)
+					break;
+		}
 		if (qos) {
 			qos->usage->grp_used_wall = grp_used_wall;
 			qos->usage->usage_raw = usage_raw;
 			_set_usage_tres_raw(qos->usage->usage_tres_raw,
 					    tmp_str);
 		}
-
-		xfree(tmp_str);
-		list_iterator_reset(itr);
 	}
 	list_iterator_destroy(itr);
 	assoc_mgr_unlock(&locks);
@@ -5783,7 +6200,6 @@ unpack_error:
 
 	if (itr)
 		list_iterator_destroy(itr);
-	xfree(tmp_str);
 	assoc_mgr_unlock(&locks);
 	return SLURM_ERROR;
 }
@@ -6360,6 +6776,45 @@ extern void assoc_mgr_set_assoc_tres_cnt(slurmdb_assoc_rec_t *assoc)
 				     assoc->max_tres_mins_pj, INFINITE64, 1);
 	assoc_mgr_set_tres_cnt_array(&assoc->max_tres_run_mins_ctld,
 				     assoc->max_tres_run_mins, INFINITE64, 1);
+	assoc_mgr_set_assoc_tres_unlimited(assoc);
+}
+
+static bool _tres_cnt_unlimited(uint64_t *tres_cnt)
+{
+	int i;
+
+	if (!tres_cnt)
+		return false;
+
+	for (i = 0; i < g_tres_count; i++) {
+		if (tres_cnt[i] != INFINITE64)
+			return false;
+	}
+
+	return true;
+}
+
+extern void assoc_mgr_set_assoc_tres_unlimited(slurmdb_assoc_rec_t *assoc)
+{
+	uint16_t flags = 0;
+
+	if (!assoc->usage)
+		return;
+
+	if (_tres_cnt_unlimited(assoc->grp_tres_ctld))
+		flags |= ASSOC_TRES_UNLIM_GRP;
+	if (_tres_cnt_unlimited(assoc->grp_tres_mins_ctld))
+		flags |= ASSOC_TRES_UNLIM_GRP_MINS;
+	if (_tres_cnt_unlimited(assoc->grp_tres_run_mins_ctld))
+		flags |= ASSOC_TRES_UNLIM_GRP_RUN_MINS;
+	if (_tres_cnt_unlimited(assoc->max_tres_ctld))
+		flags |= ASSOC_TRES_UNLIM_MAX;
+	if (_tres_cnt_unlimited(assoc->max_tres_pn_ctld))
+		flags |= ASSOC_TRES_UNLIM_MAX_PN;
+	if (_tres_cnt_unlimited(assoc->max_tres_mins_ctld))
+		flags |= ASSOC_TRES_UNLIM_MAX_MINS;
+
+	assoc->usage->tres_unlimited = flags;
 }
 
 /* tres read lock needs to be locked before this is called. */
@@ -60,6 +60,15 @@
 #define ASSOC_MGR_CACHE_TRES  0x0020
 #define ASSOC_MGR_CACHE_ALL   0xffff
 
+/* Flags for slurmdb_assoc_usage_t tres_unlimited */
+#define ASSOC_TRES_UNLIM_GRP          0x0001 /* grp_tres_ctld */
+#define ASSOC_TRES_UNLIM_GRP_MINS     0x0002 /* grp_tres_mins_ctld */
+#define ASSOC_TRES_UNLIM_GRP_RUN_MINS 0x0004 /* grp_tres_run_mins_ctld */
+#define ASSOC_TRES_UNLIM_MAX          0x0008 /* max_tres_ctld */
+#define ASSOC_TRES_UNLIM_MAX_PN       0x0010 /* max_tres_pn_ctld */
+#define ASSOC_TRES_UNLIM_MAX_MINS     0x0020 /* max_tres_mins_ctld */
+#define ASSOC_TRES_UNLIM_ALL          0x003f
+
 enum {
 	RUNNING_CACHE_STATE_NOTRUNNING = 0,
 	RUNNING_CACHE_STATE_RUNNING,
@@ -121,6 +130,8 @@ extern slurmdb_assoc_rec_t *assoc_mgr_root_assoc;
 extern uint32_t g_qos_max_priority; /* max priority in all qos's */
 extern uint32_t g_qos_count; /* count used for generating qos bitstr's */
 extern uint32_t g_user_assoc_count; /* Number of associations which are users */
+extern uint32_t g_assoc_tree_gen; /* changed when the association tree,
+				   * its shares or usage is rebuilt */
 extern uint32_t g_tres_count; /* Number of TRES from the database
 			       * which also is the number of elements
 			       * in the assoc_mgr_tres_array */
@@ -128,7 +139,12 @@ extern uint32_t g_tres_count; /* Number of TRES from the database
 extern int assoc_mgr_init(void *db_conn, assoc_init_args_t *args,
 			  int db_conn_errno);
 extern int assoc_mgr_fini(bool save_state);
-extern void assoc_mgr_lock(assoc_mgr_lock_t *locks);
+/* Contention statistics of the assoc_mgr locks, see lock_trace_t */
+extern lock_trace_t assoc_mgr_lock_trace;
+
+/* The calling function is recorded for lock contention tracing */
+#define assoc_mgr_lock(locks) assoc_mgr_lock_at(locks, __func__)
+extern void assoc_mgr_lock_at(assoc_mgr_lock_t *locks, const char *site);
 extern void assoc_mgr_unlock(assoc_mgr_lock_t *locks);
 
 #ifndef NDEBUG
@@ -279,7 +295,9 @@ extern bool assoc_mgr_is_user_acct_coord(void *db_conn, uint32_t uid,
 					char *acct);
 
 /*
- * get the share information from the association list
+ * get the share information from the association list, or from the
+ * snapshot of it saved by assoc_mgr_build_shares_snapshot() when there is
+ * one
  * IN: uid: uid_t of user issuing the request
  * IN: req_msg: info about request
  * IN/OUT: resp_msg: message filled in with assoc_mgr info
@@ -288,6 +306,14 @@ extern void assoc_mgr_get_shares(void *db_conn,
 				 uid_t uid, shares_request_msg_t *req_msg,
 				 shares_response_msg_t *resp_msg);
 
+/*
+ * Save the share information of every association so assoc_mgr_get_shares()
+ * can serve it without the assoc_mgr locks. Called by the priority plugin
+ * after each decay cycle, the snapshot is dropped when associations change.
+ * Must not be called with assoc_mgr locks held.
+ */
+extern void assoc_mgr_build_shares_snapshot(void);
+
 /*
  * get the state of the association manager and pack it up in buffer
  * OUT buffer_ptr - the pointer is set to the allocated buffer.
@@ -497,6 +523,12 @@ extern int assoc_mgr_set_tres_cnt_array(uint64_t **tres_cnt, char *tres_str,
  * is called. */
 extern void assoc_mgr_set_assoc_tres_cnt(slurmdb_assoc_rec_t *assoc);
 
+/* Set the ASSOC_TRES_UNLIM_* flags of an association from its TRES limit
+ * arrays. Must be called whenever one of those arrays changes.
+ * NOTE: The assoc_mgr assoc write lock needs to be locked before this
+ * is called. */
+extern void assoc_mgr_set_assoc_tres_unlimited(slurmdb_assoc_rec_t *assoc);
+
 /* Creates all the tres arrays for a QOS.
  * NOTE: The assoc_mgr tres read lock needs to be locked before this
  * is called. */
@@ -181,6 +181,7 @@ static List gres_conf_list = NULL;
 static bool init_run = false;
 static bool have_gpu = false, have_mps = false;
 static uint32_t gpu_plugin_id = NO_VAL, mps_plugin_id = NO_VAL;
+static uint32_t nic_plugin_id = NO_VAL;
 static volatile uint32_t autodetect_flags = GRES_AUTODETECT_UNSET;
 static uint32_t select_plugin_type = NO_VAL;
 static buf_t *gres_context_buf = NULL;
@@ -486,6 +487,8 @@ extern int gres_init(void)
 		} else if (!xstrcmp(one_name, "gpu")) {
 			have_gpu = true;
 			gpu_plugin_id = gres_build_id("gpu");
+		} else if (!xstrcmp(one_name, "nic")) {
+			nic_plugin_id = gres_build_id("nic");
 		}
 		if (!skip_name) {
 			xstrfmtcat(sorted_names, "%s%s", sep, one_name);
@@ -605,6 +608,22 @@ static int _gres_name_context(char *gres_name)
 	return -1;
 }
 
+/*
+ * Given a plugin_id, return its context index or -1 if not found.
+ * Used in place of string comparisons of GRES names in hot loops.
+ */
+static inline int _gres_id_context(uint32_t plugin_id)
+{
+	int i;
+
+	for (i = 0; i < gres_context_cnt; i++) {
+		if (gres_context[i].plugin_id == plugin_id)
+			return i;
+	}
+
+	return -1;
+}
+
 /*
  * Takes a GRES config line (typically from slurm.conf) and remove any
  * records for GRES which are not defined in GresTypes.
@@ -3942,7 +3961,6 @@ static void *_node_state_dup(void *gres_data)
  */
 extern List gres_node_state_dup(List gres_list)
 {
-	int i;
 	List new_list = NULL;
 	ListIterator gres_iter;
 	gres_state_t *gres_ptr, *new_gres;
@@ -3959,24 +3977,19 @@ extern List gres_node_state_dup(List gres_list)
 	}
 	gres_iter = list_iterator_create(gres_list);
 	while ((gres_ptr = (gres_state_t *) list_next(gres_iter))) {
-		for (i=0; i<gres_context_cnt; i++) {
-			if (gres_ptr->plugin_id != gres_context[i].plugin_id)
-				continue;
-			gres_data = _node_state_dup(gres_ptr->gres_data);
-			if (gres_data) {
-				new_gres = xmalloc(sizeof(gres_state_t));
-				new_gres->plugin_id = gres_ptr->plugin_id;
-				new_gres->gres_data = gres_data;
-				new_gres->gres_name =
-					xstrdup(gres_ptr->gres_name);
-				gres_ptr->state_type = GRES_STATE_TYPE_NODE;
-				list_append(new_list, new_gres);
-			}
-			break;
-		}
-		if (i >= gres_context_cnt) {
+		if (_gres_id_context(gres_ptr->plugin_id) < 0) {
 			error("Could not find plugin id %u to dup node record",
 			      gres_ptr->plugin_id);
+			continue;
+		}
+		gres_data = _node_state_dup(gres_ptr->gres_data);
+		if (gres_data) {
+			new_gres = xmalloc(sizeof(gres_state_t));
+			new_gres->plugin_id = gres_ptr->plugin_id;
+			new_gres->gres_data = gres_data;
+			new_gres->gres_name = xstrdup(gres_ptr->gres_name);
+			gres_ptr->state_type = GRES_STATE_TYPE_NODE;
+			list_append(new_list, new_gres);
 		}
 	}
 	list_iterator_destroy(gres_iter);
@@ -5213,9 +5226,9 @@ extern int gres_job_state_validate(char *cpus_per_tres,
 			rc = ESLURM_INVALID_GRES;
 			break;
 		}
-		if (!have_gres_gpu && !xstrcmp(job_gres_data->gres_name, "gpu"))
+		if (!have_gres_gpu && (gres_state->plugin_id == gpu_plugin_id))
 			have_gres_gpu = true;
-		if (!xstrcmp(job_gres_data->gres_name, "mps")) {
+		if (gres_state->plugin_id == mps_plugin_id) {
 			have_gres_mps = true;
 			/*
 			 * gres/mps only supports a per-node count,
@@ -6715,10 +6728,7 @@ extern uint32_t gres_job_test(List job_gres_list, List node_gres_list,
 			break;
 		}
 
-		for (i = 0; i < gres_context_cnt; i++) {
-			if (job_gres_ptr->plugin_id !=
-			    gres_context[i].plugin_id)
-				continue;
+		if ((i = _gres_id_context(job_gres_ptr->plugin_id)) >= 0) {
 			tmp_cnt = _job_test(job_gres_ptr->gres_data,
 					    node_gres_ptr->gres_data,
 					    use_total_gres, core_bitmap,
@@ -6733,7 +6743,6 @@ extern uint32_t gres_job_test(List job_gres_list, List node_gres_list,
 				else
 					core_cnt = MIN(tmp_cnt, core_cnt);
 			}
-			break;
 		}
 		if (core_cnt == 0)
 			break;
@@ -6816,6 +6825,46 @@ extern char *gres_sock_str(List sock_gres_list, int sock_inx)
 	return gres_str;
 }
 
+/* Return true if core_bitmap has any core of socket sock set */
+static bool _sock_has_cores(bitstr_t *core_bitmap, int sock,
+			    uint16_t cores_per_sock)
+{
+	int first = sock * cores_per_sock;
+
+	if (first >= bit_size(core_bitmap))
+		return false;
+	return (bit_set_count_range(core_bitmap, first,
+				    first + cores_per_sock) > 0);
+}
+
+/*
+ * Set bit s of sock_map for each socket with a core set among the first
+ * tot_cores cores of core_bitmap
+ * RET count of sockets set
+ */
+static int _core_bitmap_sock_map(bitstr_t *core_bitmap, uint16_t sockets,
+				 uint16_t cores_per_sock, int tot_cores,
+				 bitstr_t *sock_map)
+{
+	int s, first, sock_cnt = 0;
+
+	tot_cores = MIN(tot_cores, bit_size(core_bitmap));
+	bit_clear_all(sock_map);
+	for (s = 0; s < sockets; s++) {
+		first = s * cores_per_sock;
+		if (first >= tot_cores)
+			break;
+		if (!bit_set_count_range(core_bitmap, first,
+					 MIN(first + cores_per_sock,
+					     tot_cores)))
+			continue;
+		bit_set(sock_map, s);
+		sock_cnt++;
+	}
+
+	return sock_cnt;
+}
+
 /*
  * Determine how many GRES of a given type can be used by this job on a
  * given node and return a structure with the details. Note that multiple
@@ -6840,6 +6889,8 @@ static sock_gres_t *_build_sock_gres_by_topo(
 	uint64_t avail_gres, min_gres = 1;
 	bool match = false;
 	bool use_busy_dev = false;
+	bitstr_t *topo_sock_map = NULL, *topo_sock_src = NULL;
+	int topo_sock_cnt = 0;
 
 	if (node_gres_ptr->gres_cnt_avail == 0)
 		return NULL;
@@ -6902,27 +6953,27 @@ static sock_gres_t *_build_sock_gres_by_topo(
 
 		/*
 		 * If some GRES is available on every socket,
-		 * treat like no topo_core_bitmap is specified
+		 * treat like no topo_core_bitmap is specified.
+		 * GRES usually share a few core affinity patterns (all of them
+		 * on homogeneous nodes), so only compute the sockets of a
+		 * pattern when it differs from the previous one.
 		 */
 		tot_cores = sockets * cores_per_sock;
 		if (node_gres_ptr->topo_core_bitmap &&
 		    node_gres_ptr->topo_core_bitmap[i]) {
-			use_all_sockets = true;
-			for (s = 0; s < sockets; s++) {
-				bool use_this_socket = false;
-				for (c = 0; c < cores_per_sock; c++) {
-					j = (s * cores_per_sock) + c;
-					if (bit_test(node_gres_ptr->
-						     topo_core_bitmap[i], j)) {
-						use_this_socket = true;
-						break;
-					}
-				}
-				if (!use_this_socket) {
-					use_all_sockets = false;
-					break;
-				}
+			if (!topo_sock_map)
+				topo_sock_map = bit_alloc(sockets);
+			if (!topo_sock_src ||
+			    !bit_equal(topo_sock_src,
+				       node_gres_ptr->topo_core_bitmap[i])) {
+				topo_sock_src =
+					node_gres_ptr->topo_core_bitmap[i];
+				topo_sock_cnt = _core_bitmap_sock_map(
+					topo_sock_src, sockets,
+					cores_per_sock, tot_cores,
+					topo_sock_map);
 			}
+			use_all_sockets = (topo_sock_cnt == sockets);
 		}
 
 		if (!node_gres_ptr->topo_core_bitmap ||
@@ -6955,16 +7006,13 @@ static sock_gres_t *_build_sock_gres_by_topo(
 						 topo_core_bitmap[i]));
 		}
 		for (s = 0; ((s < sockets) && avail_gres); s++) {
-			if (enforce_binding && core_bitmap) {
-				for (c = 0; c < cores_per_sock; c++) {
-					j = (s * cores_per_sock) + c;
-					if (bit_test(core_bitmap, j))
-						break;
-				}
-				if (c >= cores_per_sock) {
-					/* No available cores on this socket */
-					continue;
-				}
+			/* No cores with affinity to this GRES on socket */
+			if (!bit_test(topo_sock_map, s))
+				continue;
+			if (enforce_binding && core_bitmap &&
+			    !_sock_has_cores(core_bitmap, s, cores_per_sock)) {
+				/* No available cores on this socket */
+				continue;
 			}
 			for (c = 0; c < cores_per_sock; c++) {
 				j = (s * cores_per_sock) + c;
@@ -7038,14 +7086,10 @@ static sock_gres_t *_build_sock_gres_by_topo(
 		for (s = 0; s < sockets; s++) {
 			if (sock_gres->cnt_by_sock[s] == 0)
 				continue;
-			for (c = 0; c < cores_per_sock; c++) {
-				i = (s * cores_per_sock) + c;
-				if (!bit_test(core_bitmap, i))
-					continue;
-				avail_sock++;
-				avail_sock_flag[s] = true;
-				break;
-			}
+			if (!_sock_has_cores(core_bitmap, s, cores_per_sock))
+				continue;
+			avail_sock++;
+			avail_sock_flag[s] = true;
 		}
 		while (avail_sock > s_p_n) {
 			int low_gres_sock_inx = -1;
@@ -7094,18 +7138,14 @@ static sock_gres_t *_build_sock_gres_by_topo(
 		for (s = 0; s < sockets; s++) {
 			if (sock_gres->cnt_by_sock[s] == 0)
 				continue;
-			for (c = 0; c < cores_per_sock; c++) {
-				i = (s * cores_per_sock) + c;
-				if (!bit_test(core_bitmap, i))
-					continue;
-				avail_sock++;
-				avail_sock_flag[s] = true;
-				if ((best_sock_inx == -1) ||
-				    (sock_gres->cnt_by_sock[s] >
-				     sock_gres->cnt_by_sock[best_sock_inx])) {
-					best_sock_inx = s;
-				}
-				break;
+			if (!_sock_has_cores(core_bitmap, s, cores_per_sock))
+				continue;
+			avail_sock++;
+			avail_sock_flag[s] = true;
+			if ((best_sock_inx == -1) ||
+			    (sock_gres->cnt_by_sock[s] >
+			     sock_gres->cnt_by_sock[best_sock_inx])) {
+				best_sock_inx = s;
 			}
 		}
 		while ((best_sock_inx != -1) && (add_gres > 0)) {
@@ -7132,6 +7172,7 @@ static sock_gres_t *_build_sock_gres_by_topo(
 		xfree(avail_sock_flag);
 	}
 
+	FREE_NULL_BITMAP(topo_sock_map);
 	if (match) {
 		sock_gres->type_id = job_gres_ptr->type_id;
 		sock_gres->type_name = xstrdup(job_gres_ptr->type_name);
@@ -8586,18 +8627,17 @@ extern uint64_t gres_step_count(List step_gres_list, char *gres_name)
 	gres_state_t *gres_ptr = NULL;
 	gres_step_state_t *gres_step_ptr = NULL;
 	ListIterator gres_iter;
-	int i;
+	uint32_t plugin_id;
 
 	if (!step_gres_list)
 		return gres_cnt;
 
+	plugin_id = gres_build_id(gres_name);
 	slurm_mutex_lock(&gres_context_lock);
-	for (i = 0; i < gres_context_cnt; i++) {
-		if (xstrcmp(gres_context[i].gres_name, gres_name))
-			continue;
+	if (_gres_id_context(plugin_id) >= 0) {
 		gres_iter = list_iterator_create(step_gres_list);
 		while ((gres_ptr = (gres_state_t *)list_next(gres_iter))) {
-			if (gres_ptr->plugin_id != gres_context[i].plugin_id)
+			if (gres_ptr->plugin_id != plugin_id)
 				continue;
 			gres_step_ptr = (gres_step_state_t*)gres_ptr->gres_data;
 			if (gres_cnt == NO_VAL64)
@@ -8606,7 +8646,6 @@ extern uint64_t gres_step_count(List step_gres_list, char *gres_name)
 				gres_cnt += gres_step_ptr->gres_per_node;
 		}
 		list_iterator_destroy(gres_iter);
-		break;
 	}
 	slurm_mutex_unlock(&gres_context_lock);
 
@@ -8975,7 +9014,7 @@ extern void gres_g_step_set_env(char ***job_env_ptr, List step_gres_list,
 		if (!gres_context[i].ops.step_set_env)
 			continue;	/* No plugin to call */
 		if (bind_gpu || bind_nic || map_gpu || mask_gpu) {
-			if (!xstrcmp(gres_context[i].gres_name, "gpu")) {
+			if (gres_context[i].plugin_id == gpu_plugin_id) {
 				if (map_gpu) {
 					usable_gres = _get_gres_map(
 						map_gpu, local_proc_id);
@@ -8990,8 +9029,8 @@ extern void gres_g_step_set_env(char ***job_env_ptr, List step_gres_list,
 				}
 				else
 					continue;
-			} else if (!xstrcmp(gres_context[i].gres_name,
-					    "nic")) {
+			} else if (gres_context[i].plugin_id ==
+				   nic_plugin_id) {
 				if (bind_nic)
 					usable_gres = _get_usable_gres(i);
 				else
@@ -70,4 +70,10 @@ extern List priority_g_get_priority_factors_list(
  */
 extern void priority_g_job_end(job_record_t *job_ptr);
 
+/* Call when a job is submitted, or its priority or state changes, so cached
+ * priority factors of the job are not reported any more.
+ * Caller must hold the slurmctld job write lock.
+ */
+extern void priority_g_job_changed(job_record_t *job_ptr);
+
 #endif /*_SLURM_PRIORIY_H */
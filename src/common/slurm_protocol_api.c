@@ -85,10 +85,16 @@ strong_alias(get_unit_type, slurm_get_unit_type);
 /* EXTERNAL VARIABLES */
 
 /* #DEFINES */
+/* Backoff in msec between retries of RPCs rate limited by slurmctld */
+#define RATE_LIMIT_BACKOFF_MIN 250
+#define RATE_LIMIT_BACKOFF_MAX 8000
 
 /* STATIC VARIABLES */
 static int message_timeout = -1;
 
+/* Bytes sent by slurm_send_node_msg() from this thread */
+static __thread uint64_t thread_bytes_sent = 0;
+
 /* STATIC FUNCTIONS */
 static char *_global_auth_key(void);
 static void  _remap_slurmctld_errno(void);
@@ -1545,6 +1551,8 @@ int slurm_send_node_msg(int fd, slurm_msg_t * msg)
 			return SLURM_ERROR;
 
 		rc = slurm_persist_send_msg(msg->conn, buffer);
+		if (rc >= 0)
+			thread_bytes_sent += get_buf_offset(buffer);
 		free_buf(buffer);
 
 		if ((rc < 0) && (errno == ENOTCONN)) {
@@ -1634,6 +1642,8 @@ int slurm_send_node_msg(int fd, slurm_msg_t * msg)
 	 */
 	rc = slurm_msg_sendto(fd, get_buf_data(buffer),
 			      get_buf_offset(buffer));
+	if (rc > 0)
+		thread_bytes_sent += rc;
 
 	if ((rc < 0) && (errno == ENOTCONN)) {
 		log_flag(NET, "%s: peer has disappeared for msg_type=%u",
@@ -1655,6 +1665,14 @@ int slurm_send_node_msg(int fd, slurm_msg_t * msg)
 	return rc;
 }
 
+extern uint64_t slurm_get_thread_bytes_sent(void)
+{
+	uint64_t bytes = thread_bytes_sent;
+
+	thread_bytes_sent = 0;
+	return bytes;
+}
+
 /**********************************************************************\
  * stream functions
 \**********************************************************************/
@@ -2118,6 +2136,7 @@ extern int slurm_send_recv_controller_msg(slurm_msg_t * request_msg,
 	slurm_addr_t ctrl_addr;
 	static bool use_backup = false;
 	slurmdb_cluster_rec_t *save_comm_cluster_rec = comm_cluster_rec;
+	int backoff_msec = RATE_LIMIT_BACKOFF_MIN;
 
 	/*
 	 * Just in case the caller didn't initialize his slurm_msg_t, and
@@ -2176,6 +2195,27 @@ tryagain:
 			} else {
 				retry = 1;
 			}
+		} else if ((rc == 0)
+			   && (response_msg->msg_type == RESPONSE_SLURM_RC)
+			   && ((((return_code_msg_t *)response_msg->data)->return_code)
+			       == SLURMCTLD_COMMUNICATIONS_BACKOFF)
+			   && (backoff_msec <= RATE_LIMIT_BACKOFF_MAX)) {
+			/* Rate limited, retry with exponential backoff */
+			log_flag(NET, "%s: %s rate limited by slurmctld, retry in %d msec",
+				 __func__, rpc_num2string(request_msg->msg_type),
+				 backoff_msec);
+			slurm_free_return_code_msg(response_msg->data);
+			usleep((backoff_msec / 2 +
+				(random() % (backoff_msec / 2 + 1))) * 1000);
+			backoff_msec *= 2;
+			if ((fd = slurm_open_controller_conn(&ctrl_addr,
+							     &use_backup,
+							     comm_cluster_rec))
+			    < 0) {
+				rc = -1;
+			} else {
+				retry = 1;
+			}
 		}
 
 		if (rc == -1)
@@ -315,6 +315,12 @@ int slurm_receive_msg_and_forward(int fd, slurm_addr_t *orig_addr,
  */
 int slurm_send_node_msg(int open_fd, slurm_msg_t *msg);
 
+/*
+ * Return the number of bytes the calling thread has sent through
+ * slurm_send_node_msg() since the previous call, then reset it
+ */
+extern uint64_t slurm_get_thread_bytes_sent(void);
+
 /**********************************************************************\
  * msg connection establishment functions used by msg clients
 \**********************************************************************/
@@ -1745,9 +1745,20 @@ extern void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
 		xfree(msg->rpc_type_id);
 		xfree(msg->rpc_type_cnt);
 		xfree(msg->rpc_type_time);
+		xfree(msg->rpc_type_time_p50);
+		xfree(msg->rpc_type_time_p99);
+		xfree(msg->rpc_type_time_max);
+		xfree(msg->rpc_type_lock_wait);
+		xfree(msg->rpc_type_bytes_in);
+		xfree(msg->rpc_type_bytes_out);
 		xfree(msg->rpc_user_id);
 		xfree(msg->rpc_user_cnt);
 		xfree(msg->rpc_user_time);
+		xfree(msg->rpc_user_recent_cnt);
+		xfree(msg->rpc_user_recent_time);
+		xfree(msg->rpc_user_recent_lock_wait);
+		xfree(msg->rpc_user_recent_bytes);
+		xfree(msg->rpc_user_recent_limited);
 		xfree(msg->rpc_queue_type_id);
 		xfree(msg->rpc_queue_count);
 		xfree(msg->rpc_dump_types);
@@ -1755,6 +1766,37 @@ extern void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
 			xfree(msg->rpc_dump_hostlist[i]);
 		}
 		xfree(msg->rpc_dump_hostlist);
+		xfree(msg->sched_phase_hist_limit);
+		for (i = 0; i < msg->sched_phase_count; i++)
+			xfree(msg->sched_phase_name[i]);
+		xfree(msg->sched_phase_name);
+		xfree(msg->sched_phase_cnt);
+		xfree(msg->sched_phase_time);
+		xfree(msg->sched_phase_time_max);
+		xfree(msg->sched_phase_hist);
+		for (i = 0; i < msg->lock_site_count; i++)
+			xfree(msg->lock_site_name[i]);
+		xfree(msg->lock_site_name);
+		xfree(msg->lock_site_cnt);
+		xfree(msg->lock_site_wait_time);
+		xfree(msg->lock_site_wait_max);
+		xfree(msg->lock_site_hold_time);
+		xfree(msg->lock_site_hold_max);
+		xfree(msg->lock_site_wait_hist);
+		xfree(msg->lock_site_hold_hist);
+		for (i = 0; i < msg->lock_holder_count; i++)
+			xfree(msg->lock_holder[i]);
+		xfree(msg->lock_holder);
+		xfree(msg);
+	}
+}
+
+extern void slurm_free_job_update_list_msg(job_update_list_msg_t *msg)
+{
+	if (msg) {
+		slurm_free_job_desc_msg(msg->job_desc);
+		FREE_NULL_LIST(msg->job_id_list);
+		xfree(msg->partition);
 		xfree(msg);
 	}
 }
@@ -2180,6 +2222,8 @@ extern char *job_reason_string(enum job_state_reason inx)
 		return "QOSMinBilling";
 	case WAIT_RESV_DELETED:
 		return "ReservationDeleted";
+	case WAIT_SCRIPT_WRITE:
+		return "BatchScriptWrite";
 	default:
 		snprintf(val, sizeof(val), "%d", inx);
 		return val;
@@ -2585,6 +2629,8 @@ extern enum job_state_reason job_reason_num(char *reason)
 		return WAIT_QOS_MIN_BILLING;
 	if (!xstrcasecmp(reason, "ReservationDeleted"))
 		return WAIT_RESV_DELETED;
+	if (!xstrcasecmp(reason, "BatchScriptWrite"))
+		return WAIT_SCRIPT_WRITE;
 
 	return NO_VAL;
 }
@@ -4719,6 +4765,7 @@ extern void slurm_free_priority_factors_request_msg(
 	priority_factors_request_msg_t *msg)
 {
 	if (msg) {
+		xfree(msg->accounts);
 		FREE_NULL_LIST(msg->job_id_list);
 		xfree(msg->partitions);
 		FREE_NULL_LIST(msg->uid_list);
@@ -4910,6 +4957,9 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 	case REQUEST_UPDATE_JOB:
 		slurm_free_job_desc_msg(data);
 		break;
+	case REQUEST_UPDATE_JOB_LIST:
+		slurm_free_job_update_list_msg(data);
+		break;
 	case REQUEST_SIB_JOB_LOCK:
 	case REQUEST_SIB_JOB_UNLOCK:
 	case REQUEST_SIB_MSG:
@@ -5197,6 +5247,8 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 		break;
 	case REQUEST_HET_JOB_ALLOCATION:
 	case REQUEST_SUBMIT_BATCH_HET_JOB:
+	case REQUEST_SUBMIT_BATCH_JOB_LIST:
+	case RESPONSE_SUBMIT_BATCH_JOB_LIST:
 	case RESPONSE_HET_JOB_ALLOCATION:
 		FREE_NULL_LIST(data);
 		break;
@@ -5516,6 +5568,8 @@ rpc_num2string(uint16_t opcode)
 		return "REQUEST_UPDATE_RESERVATION";
 	case REQUEST_UPDATE_FRONT_END:				/* 3011 */
 		return "REQUEST_UPDATE_FRONT_END";
+	case REQUEST_UPDATE_JOB_LIST:
+		return "REQUEST_UPDATE_JOB_LIST";
 
 	case REQUEST_RESOURCE_ALLOCATION:			/* 4001 */
 		return "REQUEST_RESOURCE_ALLOCATION";
@@ -5574,6 +5628,10 @@ rpc_num2string(uint16_t opcode)
 		return "REQUEST_HET_JOB_ALLOC_INFO";
 	case REQUEST_SUBMIT_BATCH_HET_JOB:
 		return "REQUEST_SUBMIT_BATCH_HET_JOB";
+	case REQUEST_SUBMIT_BATCH_JOB_LIST:
+		return "REQUEST_SUBMIT_BATCH_JOB_LIST";
+	case RESPONSE_SUBMIT_BATCH_JOB_LIST:
+		return "RESPONSE_SUBMIT_BATCH_JOB_LIST";
 
 	case REQUEST_JOB_STEP_CREATE:				/* 5001 */
 		return "REQUEST_JOB_STEP_CREATE";
@@ -315,6 +315,7 @@ typedef enum {
 	REQUEST_UPDATE_FRONT_END,		/* 3011 */
 	DEFUNCT_RPC_3012,
 	DEFUNCT_RPC_3013,
+	REQUEST_UPDATE_JOB_LIST,
 
 	REQUEST_RESOURCE_ALLOCATION = 4001,
 	RESPONSE_RESOURCE_ALLOCATION,
@@ -344,6 +345,8 @@ typedef enum {
 	RESPONSE_HET_JOB_ALLOCATION,
 	REQUEST_HET_JOB_ALLOC_INFO,
 	REQUEST_SUBMIT_BATCH_HET_JOB,
+	REQUEST_SUBMIT_BATCH_JOB_LIST,
+	RESPONSE_SUBMIT_BATCH_JOB_LIST,
 
 	REQUEST_CTLD_MULT_MSG = 4500,
 	RESPONSE_CTLD_MULT_MSG,
@@ -617,6 +620,7 @@ typedef struct shares_response_msg {
 } shares_response_msg_t;
 
 typedef struct priority_factors_request_msg {
+	char    *accounts;
 	List	 job_id_list;
 	char    *partitions;
 	List	 uid_list;
@@ -1438,6 +1442,7 @@ extern void slurm_free_reboot_msg(reboot_msg_t * msg);
 extern void slurm_free_shutdown_msg(shutdown_msg_t * msg);
 
 extern void slurm_free_job_desc_msg(job_desc_msg_t * msg);
+extern void slurm_free_job_update_list_msg(job_update_list_msg_t *msg);
 
 extern void
 slurm_free_node_registration_status_msg(slurm_node_registration_status_msg_t *
@@ -730,6 +730,9 @@ static void _pack_priority_factors_request_msg(
 		}
 
 		packstr(msg->partitions, buffer);
+
+		if (protocol_version >= SLURM_21_08_PROTOCOL_VERSION)
+			packstr(msg->accounts, buffer);
 	}
 
 }
@@ -778,6 +781,10 @@ static int _unpack_priority_factors_request_msg(
 
 		safe_unpackstr_xmalloc(&object_ptr->partitions, &part_str_len,
 				       buffer);
+
+		if (protocol_version >= SLURM_21_08_PROTOCOL_VERSION)
+			safe_unpackstr_xmalloc(&object_ptr->accounts,
+					       &part_str_len, buffer);
 	}
 
 	return SLURM_SUCCESS;
@@ -6324,6 +6331,69 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+/* _pack_submit_response_list_msg
+ * packs a list of submit_response_msg_t structs
+ * IN resp_list - list of batch job submit responses to pack
+ * IN/OUT buffer - destination of the pack, contains pointers that are
+ *			automatically updated
+ */
+static void
+_pack_submit_response_list_msg(List resp_list, buf_t *buffer,
+			       uint16_t protocol_version)
+{
+	submit_response_msg_t *resp;
+	ListIterator iter;
+	uint16_t cnt = 0;
+
+	if (resp_list)
+		cnt = list_count(resp_list);
+	pack16(cnt, buffer);
+	if (cnt == 0)
+		return;
+
+	iter = list_iterator_create(resp_list);
+	while ((resp = list_next(iter)))
+		_pack_submit_response_msg(resp, buffer, protocol_version);
+	list_iterator_destroy(iter);
+}
+
+static void _free_submit_response_list(void *x)
+{
+	slurm_free_submit_response_response_msg(x);
+}
+
+static int
+_unpack_submit_response_list_msg(List *resp_list, buf_t *buffer,
+				 uint16_t protocol_version)
+{
+	submit_response_msg_t *resp;
+	uint16_t cnt = 0;
+	int i;
+
+	*resp_list = NULL;
+
+	safe_unpack16(&cnt, buffer);
+	if (cnt == 0)
+		return SLURM_SUCCESS;
+	if (cnt > NO_VAL16)
+		goto unpack_error;
+
+	*resp_list = list_create(_free_submit_response_list);
+	for (i = 0; i < cnt; i++) {
+		resp = NULL;
+		if (_unpack_submit_response_msg(&resp, buffer,
+						protocol_version) !=
+		    SLURM_SUCCESS)
+			goto unpack_error;
+		list_append(*resp_list, resp);
+	}
+	return SLURM_SUCCESS;
+
+unpack_error:
+	FREE_NULL_LIST(*resp_list);
+	return SLURM_ERROR;
+}
+
 static void
 _pack_step_alloc_info_msg(step_alloc_info_msg_t * job_desc_ptr, buf_t *buffer,
 			  uint16_t protocol_version)
@@ -10641,6 +10711,112 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 				     buffer);
 		if (uint32_tmp != msg->rpc_dump_count)
 			goto unpack_error;
+
+		if (protocol_version < SLURM_21_08_PROTOCOL_VERSION)
+			return SLURM_SUCCESS;
+
+		safe_unpack64_array(&msg->rpc_type_time_p50, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->rpc_type_size)
+			goto unpack_error;
+		safe_unpack64_array(&msg->rpc_type_time_p99, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->rpc_type_size)
+			goto unpack_error;
+		safe_unpack64_array(&msg->rpc_type_time_max, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->rpc_type_size)
+			goto unpack_error;
+		safe_unpack64_array(&msg->rpc_type_lock_wait, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->rpc_type_size)
+			goto unpack_error;
+		safe_unpack64_array(&msg->rpc_type_bytes_in, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->rpc_type_size)
+			goto unpack_error;
+		safe_unpack64_array(&msg->rpc_type_bytes_out, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->rpc_type_size)
+			goto unpack_error;
+
+		safe_unpack32(&msg->rpc_user_window, buffer);
+		safe_unpack32_array(&msg->rpc_user_recent_cnt, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->rpc_user_size)
+			goto unpack_error;
+		safe_unpack64_array(&msg->rpc_user_recent_time, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->rpc_user_size)
+			goto unpack_error;
+		safe_unpack64_array(&msg->rpc_user_recent_lock_wait,
+				    &uint32_tmp, buffer);
+		if (uint32_tmp != msg->rpc_user_size)
+			goto unpack_error;
+		safe_unpack64_array(&msg->rpc_user_recent_bytes, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->rpc_user_size)
+			goto unpack_error;
+		safe_unpack32_array(&msg->rpc_user_recent_limited, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->rpc_user_size)
+			goto unpack_error;
+
+		safe_unpack64_array(&msg->sched_phase_hist_limit,
+				    &msg->sched_phase_hist_size, buffer);
+		safe_unpackstr_array(&msg->sched_phase_name,
+				     &msg->sched_phase_count, buffer);
+		safe_unpack32_array(&msg->sched_phase_cnt, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->sched_phase_count)
+			goto unpack_error;
+		safe_unpack64_array(&msg->sched_phase_time, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->sched_phase_count)
+			goto unpack_error;
+		safe_unpack64_array(&msg->sched_phase_time_max, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->sched_phase_count)
+			goto unpack_error;
+		safe_unpack32_array(&msg->sched_phase_hist, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != (msg->sched_phase_count *
+				   msg->sched_phase_hist_size))
+			goto unpack_error;
+
+		safe_unpackstr_array(&msg->lock_site_name,
+				     &msg->lock_site_count, buffer);
+		safe_unpack32_array(&msg->lock_site_cnt, &uint32_tmp, buffer);
+		if (uint32_tmp != msg->lock_site_count)
+			goto unpack_error;
+		safe_unpack64_array(&msg->lock_site_wait_time, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->lock_site_count)
+			goto unpack_error;
+		safe_unpack64_array(&msg->lock_site_wait_max, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->lock_site_count)
+			goto unpack_error;
+		safe_unpack64_array(&msg->lock_site_hold_time, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->lock_site_count)
+			goto unpack_error;
+		safe_unpack64_array(&msg->lock_site_hold_max, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->lock_site_count)
+			goto unpack_error;
+		safe_unpack32_array(&msg->lock_site_wait_hist, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != (msg->lock_site_count *
+				   msg->sched_phase_hist_size))
+			goto unpack_error;
+		safe_unpack32_array(&msg->lock_site_hold_hist, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != (msg->lock_site_count *
+				   msg->sched_phase_hist_size))
+			goto unpack_error;
+		safe_unpackstr_array(&msg->lock_holder,
+				     &msg->lock_holder_count, buffer);
 	} else {
 		error("%s: protocol_version %hu not supported",
 		      __func__, protocol_version);
@@ -10814,6 +10990,84 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static void _pack_job_update_list_msg(job_update_list_msg_t *msg,
+				      buf_t *buffer,
+				      uint16_t protocol_version)
+{
+	uint32_t count = NO_VAL;
+	char *tmp_info = NULL;
+	ListIterator itr = NULL;
+
+	xassert(msg);
+
+	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
+		_pack_job_desc_msg(msg->job_desc, buffer, protocol_version);
+
+		if (!msg->job_id_list ||
+		    !(count = list_count(msg->job_id_list)))
+			count = NO_VAL;
+		pack32(count, buffer);
+		if (count != NO_VAL) {
+			itr = list_iterator_create(msg->job_id_list);
+			while ((tmp_info = list_next(itr)))
+				packstr(tmp_info, buffer);
+			list_iterator_destroy(itr);
+		}
+
+		packstr(msg->partition, buffer);
+		pack32(msg->state, buffer);
+		pack32(msg->user_id, buffer);
+	}
+}
+
+static int _unpack_job_update_list_msg(job_update_list_msg_t **msg,
+				       buf_t *buffer,
+				       uint16_t protocol_version)
+{
+	uint32_t uint32_tmp, count = NO_VAL;
+	int i;
+	char *tmp_info = NULL;
+	job_update_list_msg_t *object_ptr;
+
+	xassert(msg);
+
+	object_ptr = xmalloc(sizeof(job_update_list_msg_t));
+	*msg = object_ptr;
+
+	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
+		if (_unpack_job_desc_msg(&object_ptr->job_desc, buffer,
+					 protocol_version))
+			goto unpack_error;
+
+		safe_unpack32(&count, buffer);
+		if (count > NO_VAL)
+			goto unpack_error;
+		if (count != NO_VAL) {
+			object_ptr->job_id_list = list_create(xfree_ptr);
+			for (i = 0; i < count; i++) {
+				safe_unpackstr_xmalloc(&tmp_info,
+						       &uint32_tmp, buffer);
+				list_append(object_ptr->job_id_list, tmp_info);
+			}
+		}
+
+		safe_unpackstr_xmalloc(&object_ptr->partition, &uint32_tmp,
+				       buffer);
+		safe_unpack32(&object_ptr->state, buffer);
+		safe_unpack32(&object_ptr->user_id, buffer);
+	} else {
+		error("%s: protocol_version %hu not supported",
+		      __func__, protocol_version);
+		goto unpack_error;
+	}
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_job_update_list_msg(object_ptr);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
 
 /* _pack_assoc_mgr_info_request_msg()
  */
@@ -11311,8 +11565,13 @@ pack_msg(slurm_msg_t const *msg, buf_t *buffer)
 		_pack_job_desc_msg((job_desc_msg_t *) msg->data, buffer,
 				   msg->protocol_version);
 		break;
+	case REQUEST_UPDATE_JOB_LIST:
+		_pack_job_update_list_msg((job_update_list_msg_t *) msg->data,
+					  buffer, msg->protocol_version);
+		break;
 	case REQUEST_HET_JOB_ALLOCATION:
 	case REQUEST_SUBMIT_BATCH_HET_JOB:
+	case REQUEST_SUBMIT_BATCH_JOB_LIST:
 		_pack_job_desc_list_msg((List) msg->data, buffer,
 					msg->protocol_version);
 		break;
@@ -11399,6 +11658,10 @@ pack_msg(slurm_msg_t const *msg, buf_t *buffer)
 					  msg->data, buffer,
 					  msg->protocol_version);
 		break;
+	case RESPONSE_SUBMIT_BATCH_JOB_LIST:
+		_pack_submit_response_list_msg((List) msg->data, buffer,
+					       msg->protocol_version);
+		break;
 	case RESPONSE_JOB_ALLOCATION_INFO:
 	case RESPONSE_RESOURCE_ALLOCATION:
 		_pack_resource_allocation_response_msg
@@ -11956,8 +12219,14 @@ unpack_msg(slurm_msg_t * msg, buf_t *buffer)
 		rc = _unpack_job_desc_msg((job_desc_msg_t **) & (msg->data),
 					  buffer, msg->protocol_version);
 		break;
+	case REQUEST_UPDATE_JOB_LIST:
+		rc = _unpack_job_update_list_msg(
+			(job_update_list_msg_t **) &(msg->data), buffer,
+			msg->protocol_version);
+		break;
 	case REQUEST_HET_JOB_ALLOCATION:
 	case REQUEST_SUBMIT_BATCH_HET_JOB:
+	case REQUEST_SUBMIT_BATCH_JOB_LIST:
 		rc = _unpack_job_desc_list_msg((List *) &(msg->data),
 					       buffer, msg->protocol_version);
 		break;
@@ -12048,6 +12317,11 @@ unpack_msg(slurm_msg_t * msg, buf_t *buffer)
 						 & (msg->data), buffer,
 						 msg->protocol_version);
 		break;
+	case RESPONSE_SUBMIT_BATCH_JOB_LIST:
+		rc = _unpack_submit_response_list_msg((List *) &(msg->data),
+						      buffer,
+						      msg->protocol_version);
+		break;
 	case RESPONSE_JOB_ALLOCATION_INFO:
 	case RESPONSE_RESOURCE_ALLOCATION:
 		rc = _unpack_resource_allocation_response_msg(
@@ -719,6 +719,7 @@ extern void slurmdb_destroy_assoc_usage(void *object)
 		xfree(usage->grp_used_tres);
 		xfree(usage->usage_tres_raw);
 		FREE_NULL_BITMAP(usage->valid_qos);
+		xfree(usage->fs_children);
 		xfree(usage);
 	}
 }
@@ -37,9 +37,47 @@
 \*****************************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 #include "src/common/log.h"
+#include "src/common/macros.h"
 #include "src/common/slurm_time.h"
+#include "src/common/timers.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#define LOCK_TRACE_LOG_SITES 20
+
+const uint64_t timer_hist_limit[TIMER_HIST_SIZE] = {
+	10, 100, 1000, 10000, 100000, 1000000, 10000000, INFINITE64
+};
+
+#define LOCK_TRACE_DEPTH 8	/* traced lock sets one thread can hold */
+
+typedef struct {
+	lock_trace_t *trace;
+	const char *site;
+	struct timeval start;
+	long wait_usec;
+	int holder;	/* index in lock_trace_t holders[], -1 if none */
+	uint32_t read_mask;
+	uint32_t write_mask;
+} lock_thread_t;
+
+/*
+ * Lock sets held by this thread in the order taken. The same locks may be
+ * taken again while held, e.g. read locks, so each lock_trace_acquired()
+ * gets its own entry and lock_trace_release() removes the newest entry
+ * with the same locks.
+ */
+static __thread lock_thread_t lock_thread[LOCK_TRACE_DEPTH];
+static __thread int lock_thread_cnt = 0;
+
+static bool lock_trace_enabled = false;
+
+/* Time this thread spent blocked on any traced lock, see lock_trace_wait() */
+static __thread long lock_thread_wait = 0;
 
 /* Return the number of micro-seconds between now and argument "tv",
  * Initialize tv to NOW if zero on entry */
@@ -112,3 +150,243 @@ extern void slurm_diff_tv_str(struct timeval *tv1, struct timeval *tv2,
 		}
 	}
 }
+
+/* Return the timer_hist_limit[] bucket for a duration in usec */
+extern int timer_hist_bucket(long usec)
+{
+	int i;
+
+	for (i = 0; i < (TIMER_HIST_SIZE - 1); i++) {
+		if ((usec < 0) || (usec < timer_hist_limit[i]))
+			break;
+	}
+
+	return i;
+}
+
+/* Find or add call site, RET NULL if the table is full */
+static lock_trace_site_t *_lock_trace_site(lock_trace_t *trace,
+					   const char *site)
+{
+	uint32_t inx = (((uintptr_t) site) >> 4) & (LOCK_TRACE_SITES - 1);
+	lock_trace_site_t *site_ptr;
+
+	for (int i = 0; i < LOCK_TRACE_SITES; i++) {
+		site_ptr = &trace->sites[(inx + i) & (LOCK_TRACE_SITES - 1)];
+		if (site_ptr->site == site)
+			return site_ptr;
+		if (!site_ptr->site) {
+			site_ptr->site = site;
+			return site_ptr;
+		}
+	}
+
+	return NULL;
+}
+
+extern void lock_trace_set_enabled(bool enabled)
+{
+	lock_trace_enabled = enabled;
+}
+
+extern void lock_trace_acquired(lock_trace_t *trace, const char *site,
+				long wait_usec, uint32_t read_mask,
+				uint32_t write_mask)
+{
+	lock_thread_t *thread;
+	lock_trace_holder_t *holder;
+
+	wait_usec = MAX(wait_usec, 0);
+	lock_thread_wait += wait_usec;
+
+	if (!lock_trace_enabled || (lock_thread_cnt >= LOCK_TRACE_DEPTH))
+		return;
+
+	thread = &lock_thread[lock_thread_cnt++];
+	gettimeofday(&thread->start, NULL);
+	thread->trace = trace;
+	thread->site = site;
+	thread->wait_usec = wait_usec;
+	thread->holder = -1;
+	thread->read_mask = read_mask;
+	thread->write_mask = write_mask;
+
+	slurm_mutex_lock(&trace->mutex);
+	for (int i = 0; i < LOCK_TRACE_HOLDERS; i++) {
+		holder = &trace->holders[i];
+		if (holder->site)
+			continue;
+		holder->site = site;
+		holder->start = thread->start;
+		holder->read_mask = read_mask;
+		holder->write_mask = write_mask;
+		thread->holder = i;
+		break;
+	}
+	if (thread->holder < 0)
+		trace->holders_dropped++;
+	slurm_mutex_unlock(&trace->mutex);
+}
+
+extern void lock_trace_release(lock_trace_t *trace, uint32_t read_mask,
+			       uint32_t write_mask)
+{
+	lock_thread_t *thread = NULL;
+	lock_trace_site_t *site_ptr;
+	long hold_usec;
+	int i;
+
+	/* Searched even when disabled, tracing may have just been disabled */
+	for (i = lock_thread_cnt - 1; i >= 0; i--) {
+		if ((lock_thread[i].trace == trace) &&
+		    (lock_thread[i].read_mask == read_mask) &&
+		    (lock_thread[i].write_mask == write_mask)) {
+			thread = &lock_thread[i];
+			break;
+		}
+	}
+	if (!thread)
+		return;
+	hold_usec = MAX(slurm_delta_tv(&thread->start), 0);
+
+	slurm_mutex_lock(&trace->mutex);
+	if (thread->holder >= 0)
+		trace->holders[thread->holder].site = NULL;
+	else if (trace->holders_dropped)
+		trace->holders_dropped--;
+	if ((site_ptr = _lock_trace_site(trace, thread->site))) {
+		site_ptr->count++;
+		site_ptr->wait_time += thread->wait_usec;
+		site_ptr->wait_max = MAX(site_ptr->wait_max,
+					 thread->wait_usec);
+		site_ptr->wait_hist[timer_hist_bucket(thread->wait_usec)]++;
+		site_ptr->hold_time += hold_usec;
+		site_ptr->hold_max = MAX(site_ptr->hold_max, hold_usec);
+		site_ptr->hold_hist[timer_hist_bucket(hold_usec)]++;
+	}
+	slurm_mutex_unlock(&trace->mutex);
+
+	lock_thread_cnt--;
+	if (i < lock_thread_cnt)
+		memmove(&lock_thread[i], &lock_thread[i + 1],
+			(lock_thread_cnt - i) * sizeof(lock_thread_t));
+}
+
+extern long lock_trace_wait(void)
+{
+	long wait_usec = lock_thread_wait;
+
+	lock_thread_wait = 0;
+	return wait_usec;
+}
+
+extern void lock_trace_reset(lock_trace_t *trace)
+{
+	slurm_mutex_lock(&trace->mutex);
+	memset(trace->sites, 0, sizeof(trace->sites));
+	slurm_mutex_unlock(&trace->mutex);
+}
+
+static int _sort_site_by_hold(const void *x, const void *y)
+{
+	const lock_trace_site_t *site1 = x, *site2 = y;
+
+	if (site1->hold_time > site2->hold_time)
+		return -1;
+	if (site1->hold_time < site2->hold_time)
+		return 1;
+	return 0;
+}
+
+extern int lock_trace_get_sites(lock_trace_t *trace,
+				lock_trace_site_t **sites)
+{
+	int cnt = 0;
+
+	*sites = xcalloc(LOCK_TRACE_SITES, sizeof(lock_trace_site_t));
+	slurm_mutex_lock(&trace->mutex);
+	for (int i = 0; i < LOCK_TRACE_SITES; i++) {
+		if (trace->sites[i].site)
+			(*sites)[cnt++] = trace->sites[i];
+	}
+	slurm_mutex_unlock(&trace->mutex);
+	qsort(*sites, cnt, sizeof(lock_trace_site_t), _sort_site_by_hold);
+
+	return cnt;
+}
+
+/* Append names of the entities set in mask to str */
+static void _entity_names(lock_trace_t *trace, uint32_t mask, char **str)
+{
+	char *sep = "";
+
+	for (int i = 0; i < trace->entity_cnt; i++) {
+		if (!(mask & (1 << i)))
+			continue;
+		xstrfmtcat(*str, "%s%s", sep, trace->entity_names[i]);
+		sep = ",";
+	}
+}
+
+extern int lock_trace_get_holders(lock_trace_t *trace, char ***holders)
+{
+	lock_trace_holder_t *holder;
+	struct timeval now;
+	long held;
+	int cnt = 0;
+
+	gettimeofday(&now, NULL);
+	*holders = xcalloc(LOCK_TRACE_HOLDERS + 1, sizeof(char *));
+	slurm_mutex_lock(&trace->mutex);
+	for (int i = 0; i < LOCK_TRACE_HOLDERS; i++) {
+		holder = &trace->holders[i];
+		if (!holder->site)
+			continue;
+		held = (now.tv_sec - holder->start.tv_sec) * 1000 +
+		       (now.tv_usec - holder->start.tv_usec) / 1000;
+		xstrfmtcat((*holders)[cnt], "%s %s held %ldms",
+			   trace->name, holder->site, held);
+		if (holder->write_mask) {
+			xstrcat((*holders)[cnt], ", write ");
+			_entity_names(trace, holder->write_mask,
+				      &(*holders)[cnt]);
+		}
+		if (holder->read_mask) {
+			xstrcat((*holders)[cnt], ", read ");
+			_entity_names(trace, holder->read_mask,
+				      &(*holders)[cnt]);
+		}
+		cnt++;
+	}
+	if (trace->holders_dropped)
+		xstrfmtcat((*holders)[cnt++], "%s %u more holders not tracked",
+			   trace->name, trace->holders_dropped);
+	slurm_mutex_unlock(&trace->mutex);
+
+	return cnt;
+}
+
+extern void lock_trace_log(lock_trace_t *trace)
+{
+	lock_trace_site_t *sites;
+	char **holders;
+	int i, cnt;
+
+	cnt = lock_trace_get_holders(trace, &holders);
+	info("%s lock holders:", trace->name);
+	for (i = 0; i < cnt; i++) {
+		info("    %s", holders[i]);
+		xfree(holders[i]);
+	}
+	xfree(holders);
+
+	cnt = lock_trace_get_sites(trace, &sites);
+	info("%s lock call sites by hold time (usec):", trace->name);
+	for (i = 0; (i < cnt) && (i < LOCK_TRACE_LOG_SITES); i++) {
+		info("    %-36s count:%-8u wait_ave:%-8"PRIu64" wait_max:%-8"PRIu64" hold_ave:%-8"PRIu64" hold_max:%"PRIu64,
+		     sites[i].site, sites[i].count,
+		     sites[i].wait_time / sites[i].count, sites[i].wait_max,
+		     sites[i].hold_time / sites[i].count, sites[i].hold_max);
+	}
+	xfree(sites);
+}
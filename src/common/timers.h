@@ -39,6 +39,9 @@
 #ifndef _HAVE_TIMERS_H
 #define _HAVE_TIMERS_H
 
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <sys/time.h>
 
 #define DEF_TIMERS	struct timeval tv1, tv2; char tv_str[20] = ""; long delta_t;
@@ -77,4 +80,113 @@ extern void slurm_diff_tv_str(struct timeval *tv1,struct timeval *tv2,
 			      char *tv_str, int len_tv_str, const char *from,
 			      long limit, long *delta_t);
 
+
+/* Decade histogram of durations in usec, 10us up to 10s and over */
+#define TIMER_HIST_SIZE 8
+extern const uint64_t timer_hist_limit[TIMER_HIST_SIZE];
+
+/* Return the timer_hist_limit[] bucket for a duration in usec */
+extern int timer_hist_bucket(long usec);
+
+/*
+ * Lock contention tracing: acquisition wait and hold time histograms per call
+ * site (the function taking the lock), plus the functions currently holding
+ * the lock. One lock_trace_t covers a family of locks, such as the slurmctld
+ * config/job/node/part/fed locks.
+ */
+#define LOCK_TRACE_SITES	512	/* power of 2 */
+/* slurmctld MAX_SERVER_THREADS RPC threads plus its own background threads */
+#define LOCK_TRACE_HOLDERS	320
+
+typedef enum {
+	LOCK_TRACE_SLURMCTLD,
+	LOCK_TRACE_ASSOC_MGR,
+	LOCK_TRACE_TYPES
+} lock_trace_type_t;
+
+typedef struct {
+	const char *site;	/* function taking the lock, NULL if unused */
+	uint32_t count;
+	uint64_t wait_time;
+	uint64_t wait_max;
+	uint64_t hold_time;
+	uint64_t hold_max;
+	uint32_t wait_hist[TIMER_HIST_SIZE];
+	uint32_t hold_hist[TIMER_HIST_SIZE];
+} lock_trace_site_t;
+
+typedef struct {
+	const char *site;	/* NULL if slot unused */
+	struct timeval start;
+	uint32_t read_mask;	/* bit per entity held for read */
+	uint32_t write_mask;	/* bit per entity held for write */
+} lock_trace_holder_t;
+
+typedef struct {
+	lock_trace_type_t type;
+	const char *name;
+	const char **entity_names;	/* indexed by lock entity */
+	int entity_cnt;
+	pthread_mutex_t mutex;
+	lock_trace_site_t sites[LOCK_TRACE_SITES];
+	lock_trace_holder_t holders[LOCK_TRACE_HOLDERS];
+	uint32_t holders_dropped;	/* current holders without a slot */
+} lock_trace_t;
+
+#define LOCK_TRACE_INITIALIZER(t, n, e, c)				\
+	{ .type = t, .name = n, .entity_names = e, .entity_cnt = c,	\
+	  .mutex = PTHREAD_MUTEX_INITIALIZER }
+
+/*
+ * Enable or disable recording of call site statistics and lock holders,
+ * disabled by default. Lock waits are always added to lock_trace_wait().
+ */
+extern void lock_trace_set_enabled(bool enabled);
+
+/*
+ * Call once the calling thread holds the locks
+ * IN site - function which took the locks, must be a static string
+ * IN wait_usec - time spent blocked acquiring the locks
+ * IN read_mask/write_mask - bit per entity locked for read/write
+ */
+extern void lock_trace_acquired(lock_trace_t *trace, const char *site,
+				long wait_usec, uint32_t read_mask,
+				uint32_t write_mask);
+
+/*
+ * Call just before the calling thread releases the locks
+ * IN read_mask/write_mask - same as passed to lock_trace_acquired()
+ */
+extern void lock_trace_release(lock_trace_t *trace, uint32_t read_mask,
+			       uint32_t write_mask);
+
+/*
+ * Return the time in usec the calling thread spent blocked acquiring traced
+ * locks since the previous call, then reset it
+ */
+extern long lock_trace_wait(void);
+
+/* Clear the per call site statistics, current holders are kept */
+extern void lock_trace_reset(lock_trace_t *trace);
+
+/*
+ * Copy the statistics of every call site which has taken the locks
+ * OUT sites - xmalloc'd array, sorted by total hold time, caller must xfree
+ * RET number of call sites
+ */
+extern int lock_trace_get_sites(lock_trace_t *trace,
+				lock_trace_site_t **sites);
+
+/*
+ * Describe the current lock holders, e.g.
+ * "slurmctld _schedule held 1520ms, write job,node read conf,part,fed"
+ * followed by "slurmctld 12 more holders not tracked" if holders[] was full
+ * OUT holders - xmalloc'd array of xmalloc'd strings, caller must xfree
+ * RET number of holders
+ */
+extern int lock_trace_get_holders(lock_trace_t *trace, char ***holders);
+
+/* Log current holders and the call sites with the longest hold times */
+extern void lock_trace_log(lock_trace_t *trace);
+
 #endif
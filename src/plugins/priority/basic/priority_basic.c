@@ -232,3 +232,8 @@ extern void priority_p_job_end(job_record_t *job_ptr)
 
 	return;
 }
+
+extern void priority_p_job_changed(job_record_t *job_ptr)
+{
+	return;
+}
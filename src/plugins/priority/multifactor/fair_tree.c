@@ -47,6 +47,11 @@
 static int  _ft_decay_apply_new_usage(job_record_t *job, time_t *start);
 static void _apply_priority_fs(void);
 
+/* g_assoc_tree_gen when the cached sibling orders were built */
+static uint32_t fs_tree_gen = NO_VAL;
+/* cached sibling orders can be used by this calculation */
+static bool fs_cache_valid = false;
+
 /* Fair Tree code called from the decay thread loop */
 extern void fair_tree_decay(List jobs, time_t start)
 {
@@ -58,7 +63,9 @@ extern void fair_tree_decay(List jobs, time_t start)
 
 	/* apply decayed usage */
 	lock_slurmctld(job_write_lock);
+	decay_usage_batch_start();
 	list_for_each(jobs, (ListForF) _ft_decay_apply_new_usage, &start);
+	decay_usage_batch_flush();
 	unlock_slurmctld(job_write_lock);
 
 	/* calculate fs factor for associations */
@@ -68,7 +75,7 @@ extern void fair_tree_decay(List jobs, time_t start)
 
 	/* assign job priorities */
 	lock_slurmctld(job_write_lock);
-	list_for_each(jobs, (ListForF) decay_apply_weighted_factors, &start);
+	decay_apply_weighted_factors_all(jobs, start);
 	unlock_slurmctld(job_write_lock);
 }
 
@@ -304,8 +311,61 @@ static slurmdb_assoc_rec_t** _merge_accounts(
 }
 
 
-/* Calculate fairshare for each child then sort children by fairshare value
- * (level_fs). Once they are sorted, operate on each child in sorted order.
+/* Calculate fairshare for each sibling then sort them by fairshare value
+ * (level_fs).
+ * IN/OUT siblings - null terminated array of siblings
+ */
+static void _sort_siblings(slurmdb_assoc_rec_t **siblings)
+{
+	size_t i;
+
+	/* Calculate level_fs for each child */
+	for (i = 0; siblings[i]; i++)
+		_calc_assoc_fs(siblings[i]);
+
+	/* Sort children by level_fs */
+	qsort(siblings, i, sizeof(slurmdb_assoc_rec_t *), _cmp_level_fs);
+}
+
+
+/* Return the children of an account sorted by level_fs.
+ *
+ * Decay scales the usage of every association by the same factor, which
+ * leaves level_fs unchanged. The order from the last calculation is kept
+ * unless usage was added below the account or the tree changed since; only
+ * usage_norm, which is relative to root, is refreshed then.
+ *
+ * IN assoc - account whose children to return
+ * RET - null terminated array owned by assoc->usage. Do not free.
+ */
+static slurmdb_assoc_rec_t **_get_sorted_children(slurmdb_assoc_rec_t *assoc)
+{
+	slurmdb_assoc_rec_t **children;
+	size_t i, child_count = 0;
+
+	if (fs_cache_valid && assoc->usage->fs_children &&
+	    !assoc->usage->fs_usage_changed) {
+		children = assoc->usage->fs_children;
+		for (i = 0; children[i]; i++)
+			set_assoc_usage_norm(children[i]);
+		return children;
+	}
+
+	xfree(assoc->usage->fs_children);
+	children = xmalloc(sizeof(slurmdb_assoc_rec_t *));
+	if (assoc->usage->children_list)
+		children = _append_list_to_array(assoc->usage->children_list,
+						 children, &child_count);
+	_sort_siblings(children);
+
+	assoc->usage->fs_children = children;
+	assoc->usage->fs_usage_changed = false;
+
+	return children;
+}
+
+
+/* Operate on each sibling in sorted order.
  * This portion of the tree is now sorted and users are given a fairshare value
  * based on the order they are operated on. The basic equation is
  * (rank / g_user_assoc_count), though ties are allowed. The rank is
@@ -318,7 +378,7 @@ static slurmdb_assoc_rec_t** _merge_accounts(
  *	3) A user with the same level_fs as a sibling account will receive
  *	   the same rank as the account's highest ranked user
  *
- * IN siblings - array of siblings
+ * IN siblings - array of siblings, sorted by _sort_siblings()
  * IN assoc_level - depth in the tree (root is 0)
  * IN/OUT rank - current user ranking, starting at g_user_assoc_count
  * IN/OUT rnt - rank, no ties (what rank would be if no tie exists)
@@ -339,13 +399,6 @@ static void _calc_tree_fs(slurmdb_assoc_rec_t** siblings,
 		return;
 	}
 
-	/* Calculate level_fs for each child */
-	for (i = 0; (assoc = siblings[i]); i++)
-		_calc_assoc_fs(assoc);
-
-	/* Sort children by level_fs */
-	qsort(siblings, i, sizeof(slurmdb_assoc_rec_t *), _cmp_level_fs);
-
 	/* Iterate through children in sorted order. If it's a user, calculate
 	 * fs_factor, otherwise recurse. */
 	for (i = 0; (assoc = siblings[i]); i++) {
@@ -377,12 +430,21 @@ static void _calc_tree_fs(slurmdb_assoc_rec_t** siblings,
 			slurmdb_assoc_rec_t** children;
 			size_t merge_count = _count_tied_accounts(siblings, i);
 
+			if (!merge_count) {
+				children = _get_sorted_children(assoc);
+				_calc_tree_fs(children, assoc_level+1,
+					      rank, rnt, tied);
+				prev_level_fs = assoc->usage->level_fs;
+				continue;
+			}
+
 			/* Merging does not affect child level_fs calculations
 			 * since the necessary information is stored on each
 			 * assoc's usage struct */
 			children = _merge_accounts(siblings, i,
 						   i + merge_count,
 						   assoc_level);
+			_sort_siblings(children);
 
 			_calc_tree_fs(children, assoc_level+1,
 				      rank, rnt, tied);
@@ -404,19 +466,17 @@ static void _apply_priority_fs(void)
 	slurmdb_assoc_rec_t** children = NULL;
 	uint32_t rank = g_user_assoc_count;
 	uint32_t rnt = rank;
-	size_t child_count = 0;
 
 	log_flag(PRIO, "Fair Tree fairshare algorithm, starting at root:");
 
 	assoc_mgr_root_assoc->usage->level_fs = (long double) NO_VAL;
 
+	/* Sibling orders are only kept while the tree is unchanged */
+	fs_cache_valid = (fs_tree_gen == g_assoc_tree_gen);
+	fs_tree_gen = g_assoc_tree_gen;
+
 	/* _calc_tree_fs requires an array instead of List */
-	children = _append_list_to_array(
-		assoc_mgr_root_assoc->usage->children_list,
-		children,
-		&child_count);
+	children = _get_sorted_children(assoc_mgr_root_assoc);
 
 	_calc_tree_fs(children, 0, &rank, &rnt, false);
-
-	xfree(children);
 }
@@ -56,6 +56,7 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include "slurm/slurm_errno.h"
 
@@ -64,6 +65,7 @@
 #include "src/common/slurm_mcs.h"
 #include "src/common/slurm_priority.h"
 #include "src/common/slurm_time.h"
+#include "src/common/xhash.h"
 #include "src/common/xstring.h"
 #include "src/common/gres.h"
 
@@ -75,6 +77,9 @@
 #define SECS_PER_DAY	(24 * 60 * 60)
 #define SECS_PER_WEEK	(7 * SECS_PER_DAY)
 
+#define PRIO_THREADS_MAX	8	/* Max threads setting job priorities */
+#define PRIO_THREAD_MIN_JOBS	1000	/* Min jobs handled per thread */
+
 /* These are defined here so when we link with something other than
  * the slurmctld we will have these symbols defined.  They will get
  * overwritten when linking with the slurmctld.
@@ -147,6 +152,62 @@ static uint32_t flags;       /* Priority Flags */
 static time_t g_last_ran = 0; /* when the last poll ran */
 static double decay_factor = 1; /* The decay factor when decaying time. */
 
+/*
+ * Usage accumulated per association during one decay pass. Rather than
+ * walking every running job's association path up to root, usage is summed
+ * here and pushed up the tree once per association when the pass ends.
+ */
+typedef struct {
+	slurmdb_assoc_rec_t *assoc;
+	int depth;			/* distance from root */
+	double run_decay;
+	double real_decay;
+	long double *tres_run_decay;
+	uint64_t *tres_run_delta;
+} usage_delta_t;
+
+static xhash_t *usage_delta_hash = NULL; /* non-NULL while batching */
+
+/* Priority factors of one job as of the last decay cycle */
+typedef struct {
+	uint32_t job_id;
+	uint32_t user_id;
+	char *account;
+	char *mcs_label;
+	time_t use_time;	/* time the job became eligible */
+	List factors_list;	/* priority_factors_object_t, one per partition */
+} prio_snapshot_job_t;
+
+typedef struct {
+	List job_list;		/* prio_snapshot_job_t list */
+	uint32_t *job_ids;	/* IDs of job_list records, sorted */
+	int job_cnt;
+	uint32_t *changed_ids;	/* jobs changed since the snapshot was built */
+	int changed_cnt;
+	int changed_size;
+	int ref_cnt;		/* one for prio_snapshot plus one per reader */
+} prio_snapshot_t;
+
+/*
+ * Once more jobs than this (or than the snapshot holds) changed it is cheaper
+ * to drop the snapshot and compute all factors live until the next decay
+ */
+#define PRIO_SNAPSHOT_MIN_CHANGED 1024
+
+/* Served to sprio, NULL until the first decay cycle ends */
+static prio_snapshot_t *prio_snapshot = NULL;
+static pthread_mutex_t prio_snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Slice of the jobs whose priority is set by one thread */
+typedef struct {
+	job_record_t **jobs;
+	int job_cnt;
+	time_t start_time;
+	bool updated;		/* set if any job priority changed */
+} prio_thread_args_t;
+static assoc_mgr_lock_t usage_delta_locks = {
+	WRITE_LOCK, NO_LOCK, WRITE_LOCK, NO_LOCK, READ_LOCK, NO_LOCK, NO_LOCK };
+
 /* variables defined in priority_multifactor.h */
 
 static void _priority_p_set_assoc_usage_debug(slurmdb_assoc_rec_t *assoc);
@@ -238,6 +299,7 @@ static int _reset_usage(void)
 		for (i=0; i<slurmctld_tres_cnt; i++)
 			assoc->usage->usage_tres_raw[i] = 0;
 		assoc->usage->grp_used_wall = 0;
+		assoc->usage->fs_usage_changed = true;
 	}
 	list_iterator_destroy(itr);
 
@@ -402,6 +464,27 @@ static int _set_children_usage_efctv(List children_list)
 }
 
 
+/*
+ * Return the association whose usage sets the fairshare of job_assoc,
+ * computing its effective usage if needed.
+ * Call with the assoc_mgr assoc lock held.
+ */
+static slurmdb_assoc_rec_t *_get_fs_assoc(slurmdb_assoc_rec_t *job_assoc)
+{
+	slurmdb_assoc_rec_t *fs_assoc;
+
+	/* Use values from parent when FairShare=SLURMDB_FS_USE_PARENT */
+	if (job_assoc->shares_raw == SLURMDB_FS_USE_PARENT)
+		fs_assoc = job_assoc->usage->fs_assoc_ptr;
+	else
+		fs_assoc = job_assoc;
+
+	if (fuzzy_equal(fs_assoc->usage->usage_efctv, NO_VAL))
+		priority_p_set_assoc_usage(fs_assoc);
+
+	return fs_assoc;
+}
+
 /* job_ptr should already have the partition priority and such added here
  * before had we will be adding to it
  */
@@ -427,14 +510,7 @@ static double _get_fairshare_priority(job_record_t *job_ptr)
 		return 0;
 	}
 
-	/* Use values from parent when FairShare=SLURMDB_FS_USE_PARENT */
-	if (job_assoc->shares_raw == SLURMDB_FS_USE_PARENT)
-		fs_assoc = job_assoc->usage->fs_assoc_ptr;
-	else
-		fs_assoc = job_assoc;
-
-	if (fuzzy_equal(fs_assoc->usage->usage_efctv, NO_VAL))
-		priority_p_set_assoc_usage(fs_assoc);
+	fs_assoc = _get_fs_assoc(job_assoc);
 
 	/* Priority is 0 -> 1 */
 	if (flags & PRIORITY_FLAGS_FAIR_TREE) {
@@ -864,6 +940,81 @@ static void _handle_assoc_tres_run_secs(long double *tres_run_decay,
 	}
 }
 
+static void _usage_delta_identity(void *item, const char **key,
+				  uint32_t *key_len)
+{
+	usage_delta_t *delta = (usage_delta_t *) item;
+
+	*key = (const char *) &delta->assoc;
+	*key_len = sizeof(delta->assoc);
+}
+
+static void _usage_delta_free(void *item)
+{
+	usage_delta_t *delta = (usage_delta_t *) item;
+
+	xfree(delta->tres_run_decay);
+	xfree(delta->tres_run_delta);
+	xfree(delta);
+}
+
+/*
+ * Find or create the delta record of an association. Records for all of its
+ * parents are created along with it, so every record has one for its parent.
+ */
+static usage_delta_t *_usage_delta_find(slurmdb_assoc_rec_t *assoc)
+{
+	usage_delta_t *delta, *parent = NULL;
+
+	delta = xhash_get(usage_delta_hash, (const char *) &assoc,
+			  sizeof(assoc));
+	if (delta)
+		return delta;
+
+	if (assoc->usage->parent_assoc_ptr)
+		parent = _usage_delta_find(assoc->usage->parent_assoc_ptr);
+
+	delta = xmalloc(sizeof(*delta));
+	delta->assoc = assoc;
+	delta->depth = parent ? (parent->depth + 1) : 0;
+	delta->tres_run_decay = xcalloc(slurmctld_tres_cnt, sizeof(long double));
+	delta->tres_run_delta = xcalloc(slurmctld_tres_cnt, sizeof(uint64_t));
+	xhash_add(usage_delta_hash, delta);
+
+	return delta;
+}
+
+static void _usage_delta_add(usage_delta_t *delta, double run_decay,
+			     double real_decay, long double *tres_run_decay,
+			     uint64_t *tres_run_delta)
+{
+	int i;
+
+	delta->run_decay += run_decay;
+	delta->real_decay += real_decay;
+	for (i = 0; i < slurmctld_tres_cnt; i++) {
+		delta->tres_run_decay[i] += tres_run_decay[i];
+		delta->tres_run_delta[i] += tres_run_delta[i];
+	}
+}
+
+static void _usage_delta_to_array(void *item, void *arg)
+{
+	usage_delta_t ***next = (usage_delta_t ***) arg;
+
+	**next = (usage_delta_t *) item;
+	(*next)++;
+}
+
+/* Sort deepest associations first */
+static int _usage_delta_cmp_depth(const void *a, const void *b)
+{
+	const usage_delta_t *delta_a = *(const usage_delta_t **) a;
+	const usage_delta_t *delta_b = *(const usage_delta_t **) b;
+
+	return delta_b->depth - delta_a->depth;
+}
+
 static void _handle_tres_run_secs(uint64_t *tres_run_delta,
 				  job_record_t *job_ptr)
 {
@@ -1059,7 +1210,8 @@ static int _apply_new_usage(job_record_t *job_ptr, time_t start_period,
 	memset(tres_run_decay, 0, sizeof(tres_run_decay));
 	memset(tres_run_nodecay, 0, sizeof(tres_run_nodecay));
 	memset(tres_run_delta, 0, sizeof(tres_run_delta));
-	assoc_mgr_lock(&locks);
+	if (!usage_delta_hash)
+		assoc_mgr_lock(&locks);
 
 	billable_tres = calc_job_billable_tres(job_ptr, start_period, true);
 	real_decay    = run_decay * billable_tres;
@@ -1146,10 +1298,21 @@ static int _apply_new_usage(job_record_t *job_ptr, time_t start_period,
 	 * to and including root.  This way we
 	 * can keep track of how much usage
 	 * has occured on the entire system
-	 * and use that to normalize against. */
+	 * and use that to normalize against.
+	 * While a decay pass is batching usage
+	 * only record it, the tree is updated
+	 * in decay_usage_batch_flush(). */
+	if (usage_delta_hash) {
+		if (assoc)
+			_usage_delta_add(_usage_delta_find(assoc), run_decay,
+					 real_decay, tres_run_decay,
+					 tres_run_delta);
+		return 1;
+	}
 	while (assoc) {
 		assoc->usage->grp_used_wall += run_decay;
 		assoc->usage->usage_raw += (long double)real_decay;
+		assoc->usage->fs_usage_changed = true;
 		log_flag(PRIO, "Adding %f new usage to assoc %u (%s/%s/%s) raw usage is now %Lf. Group wall added %f making it %f.",
 			 real_decay, assoc->id, assoc->acct, assoc->user,
 			 assoc->partition, assoc->usage->usage_raw, run_decay,
@@ -1164,6 +1327,16 @@ static int _apply_new_usage(job_record_t *job_ptr, time_t start_period,
 }
 
 
+static int _decay_apply_new_usage(job_record_t *job_ptr,
+				  time_t *start_time_ptr)
+{
+	/* Always return SUCCESS so that list_for_each will
+	 * continue processing list of jobs. */
+	decay_apply_new_usage(job_ptr, start_time_ptr);
+
+	return SLURM_SUCCESS;
+}
+
 static int _decay_apply_new_usage_and_weighted_factors(job_record_t *job_ptr,
 						       time_t *start_time_ptr)
 {
@@ -1349,11 +1522,12 @@ static void *_decay_thread(void *no_data)
 		site_factor_g_update();
 
 		if (!(flags & PRIORITY_FLAGS_FAIR_TREE)) {
-			list_for_each(
-				job_list,
-				(ListForF) _decay_apply_new_usage_and_weighted_factors,
-				&start_time
-				);
+			decay_usage_batch_start();
+			list_for_each(job_list,
+				      (ListForF) _decay_apply_new_usage,
+				      &start_time);
+			decay_usage_batch_flush();
+			decay_apply_weighted_factors_all(job_list, start_time);
 		}
 
 		unlock_slurmctld(job_write_lock);
@@ -1364,6 +1538,9 @@ static void *_decay_thread(void *no_data)
 
 		g_last_ran = start_time;
 
+		/* Serve sshare from this cycle's usage and fairshare values */
+		assoc_mgr_build_shares_snapshot();
+
 		_write_last_decay_ran(g_last_ran, last_reset);
 
 		running_decay = 0;
@@ -1379,6 +1556,29 @@ static void *_decay_thread(void *no_data)
 	return NULL;
 }
 
+/* Return true if account is in the comma separated list of accounts */
+static bool _account_in_list(char *accounts, char *account)
+{
+	char *acct_str, *tok, *last = NULL;
+	bool found = false;
+
+	if (!account)
+		return false;
+
+	acct_str = xstrdup(accounts);
+	tok = strtok_r(acct_str, ",", &last);
+	while (tok) {
+		if (!xstrcasecmp(tok, account)) {
+			found = true;
+			break;
+		}
+		tok = strtok_r(NULL, ",", &last);
+	}
+	xfree(acct_str);
+
+	return found;
+}
+
 /* If the specified job record satisfies the filter specifications in req_msg
  * and part_ptr_list (partition name filters), then add its priority specs
  * to ret_list */
@@ -1426,6 +1626,11 @@ static void _filter_job(job_record_t *job_ptr,
 			return;
 	}
 
+	/* Filter by account */
+	if (req_msg->accounts &&
+	    !_account_in_list(req_msg->accounts, job_ptr->account))
+		return;
+
 	/*
 	 * Job is not in any partition, so there is nothing to return.
 	 * This can happen if the Partition was deleted, CALCULATE_RUNNING
@@ -1510,6 +1715,422 @@ static void _filter_job(job_record_t *job_ptr,
 	list_iterator_destroy(job_iter);
 }
 
+/* Free a priority_factors_object_t whose partition name is owned */
+static void _destroy_factors_object(void *object)
+{
+	priority_factors_object_t *obj = (priority_factors_object_t *) object;
+
+	if (obj) {
+		xfree(obj->partition);
+		slurm_destroy_priority_factors_object(obj);
+	}
+}
+
+static void _destroy_snapshot_job(void *object)
+{
+	prio_snapshot_job_t *snap_job = (prio_snapshot_job_t *) object;
+
+	if (snap_job) {
+		xfree(snap_job->account);
+		xfree(snap_job->mcs_label);
+		FREE_NULL_LIST(snap_job->factors_list);
+		xfree(snap_job);
+	}
+}
+
+static void _prio_snapshot_release(prio_snapshot_t *snapshot)
+{
+	bool free_it;
+
+	if (!snapshot)
+		return;
+
+	slurm_mutex_lock(&prio_snapshot_mutex);
+	free_it = (--snapshot->ref_cnt == 0);
+	slurm_mutex_unlock(&prio_snapshot_mutex);
+
+	if (free_it) {
+		FREE_NULL_LIST(snapshot->job_list);
+		xfree(snapshot->job_ids);
+		xfree(snapshot->changed_ids);
+		xfree(snapshot);
+	}
+}
+
+/* Stop serving the snapshot's priority factors of a job which changed */
+static void _prio_snapshot_job_changed(uint32_t job_id)
+{
+	prio_snapshot_t *snapshot = NULL, *old_snapshot = NULL;
+
+	slurm_mutex_lock(&prio_snapshot_mutex);
+	snapshot = prio_snapshot;
+	if (!snapshot) {
+		;
+	} else if (snapshot->changed_cnt >=
+		   MAX(PRIO_SNAPSHOT_MIN_CHANGED, snapshot->job_cnt)) {
+		old_snapshot = snapshot;
+		prio_snapshot = NULL;
+	} else if (!snapshot->changed_cnt ||
+		   (snapshot->changed_ids[snapshot->changed_cnt - 1] !=
+		    job_id)) {
+		if (snapshot->changed_cnt == snapshot->changed_size) {
+			snapshot->changed_size = MAX(64,
+						     snapshot->changed_size * 2);
+			xrealloc(snapshot->changed_ids,
+				 sizeof(uint32_t) * snapshot->changed_size);
+		}
+		snapshot->changed_ids[snapshot->changed_cnt++] = job_id;
+	}
+	slurm_mutex_unlock(&prio_snapshot_mutex);
+
+	_prio_snapshot_release(old_snapshot);
+}
+
+static int _cmp_job_id(const void *x, const void *y)
+{
+	uint32_t id_x = *(uint32_t *) x, id_y = *(uint32_t *) y;
+
+	if (id_x < id_y)
+		return -1;
+	if (id_x > id_y)
+		return 1;
+	return 0;
+}
+
+/* Sort job IDs and remove duplicates, return the new count */
+static int _sort_job_ids(uint32_t *job_ids, int job_cnt)
+{
+	int i, cnt = 0;
+
+	if (job_cnt < 2)
+		return job_cnt;
+
+	qsort(job_ids, job_cnt, sizeof(uint32_t), _cmp_job_id);
+	for (i = 1; i < job_cnt; i++) {
+		if (job_ids[i] != job_ids[cnt])
+			job_ids[++cnt] = job_ids[i];
+	}
+
+	return cnt + 1;
+}
+
+static bool _find_job_id(uint32_t *job_ids, int job_cnt, uint32_t job_id)
+{
+	if (!job_cnt)
+		return false;
+	return bsearch(&job_id, job_ids, job_cnt, sizeof(uint32_t),
+		       _cmp_job_id);
+}
+
+/* Return true if the job's priority factors are private to uid */
+static bool _factors_private(uid_t uid, uint32_t user_id, char *account,
+			     char *mcs_label)
+{
+	if (!(slurm_conf.private_data & PRIVATE_DATA_JOBS) ||
+	    (user_id == uid) || validate_operator(uid))
+		return false;
+
+	if (slurm_mcs_get_privatedata() == 0)
+		return !assoc_mgr_is_user_acct_coord(acct_db_conn, uid,
+						     account);
+	if (slurm_mcs_get_privatedata() == 1)
+		return (mcs_g_check_mcs_label(uid, mcs_label) != 0);
+
+	return false;
+}
+
+/* Return the time the job became eligible for the age factor */
+static time_t _job_use_time(job_record_t *job_ptr)
+{
+	/*
+	 * This means the job is not eligible yet
+	 */
+	if (flags & PRIORITY_FLAGS_ACCRUE_ALWAYS)
+		return job_ptr->details->submit_time;
+	return job_ptr->details->begin_time;
+}
+
+/* Return true if sprio is not to show uid the job's priority factors now */
+static bool _skip_live_job(job_record_t *job_ptr, uid_t uid, time_t now)
+{
+	time_t use_time;
+
+	if (!(flags & PRIORITY_FLAGS_CALCULATE_RUNNING) &&
+	    !IS_JOB_PENDING(job_ptr))
+		return true;
+
+	/* Job is not active on this cluster. */
+	if (IS_JOB_REVOKED(job_ptr) || !job_ptr->details)
+		return true;
+
+	use_time = _job_use_time(job_ptr);
+	if (!use_time || (use_time > now))
+		return true;
+
+	/*
+	 * 0 means the job is held
+	 */
+	if (job_ptr->priority == 0)
+		return true;
+
+	return _factors_private(uid, job_ptr->user_id, job_ptr->account,
+				job_ptr->mcs_label);
+}
+
+/*
+ * Return the records of the comma separated partition names.
+ * Caller must hold the slurmctld partition read lock.
+ */
+static List _part_filter_list(char *partitions)
+{
+	List part_filter_list;
+	part_record_t *part_ptr;
+	char *part_str, *tok, *last = NULL;
+
+	if (!partitions)
+		return NULL;
+
+	part_filter_list = list_create(NULL);
+	part_str = xstrdup(partitions);
+	tok = strtok_r(part_str, ",", &last);
+	while (tok) {
+		if ((part_ptr = find_part_record(tok)))
+			list_append(part_filter_list, part_ptr);
+		tok = strtok_r(NULL, ",", &last);
+	}
+	xfree(part_str);
+
+	return part_filter_list;
+}
+
+/*
+ * Save the priority factors of all jobs shown by sprio, so requests can be
+ * served without the slurmctld job lock until the next decay cycle.
+ * Caller must hold the slurmctld job and partition read locks.
+ */
+static void _build_prio_snapshot(List job_list)
+{
+	priority_factors_request_msg_t req_msg;
+	priority_factors_object_t *obj;
+	prio_snapshot_job_t *snap_job;
+	prio_snapshot_t *snapshot, *old_snapshot;
+	job_record_t *job_ptr;
+	ListIterator itr, obj_itr;
+	int i;
+
+	memset(&req_msg, 0, sizeof(req_msg));
+	snapshot = xmalloc(sizeof(prio_snapshot_t));
+	snapshot->job_list = list_create(_destroy_snapshot_job);
+	snapshot->ref_cnt = 1;
+
+	itr = list_iterator_create(job_list);
+	while ((job_ptr = list_next(itr))) {
+		if (!(flags & PRIORITY_FLAGS_CALCULATE_RUNNING) &&
+		    !IS_JOB_PENDING(job_ptr))
+			continue;
+
+		/* Job is not active on this cluster. */
+		if (IS_JOB_REVOKED(job_ptr))
+			continue;
+
+		/*
+		 * 0 means the job is held
+		 */
+		if (!job_ptr->details || (job_ptr->priority == 0))
+			continue;
+
+		snap_job = xmalloc(sizeof(prio_snapshot_job_t));
+		snap_job->factors_list = list_create(_destroy_factors_object);
+		_filter_job(job_ptr, &req_msg, NULL, snap_job->factors_list);
+		if (list_is_empty(snap_job->factors_list)) {
+			_destroy_snapshot_job(snap_job);
+			continue;
+		}
+
+		/* _filter_job() points at the partition's own name */
+		obj_itr = list_iterator_create(snap_job->factors_list);
+		while ((obj = list_next(obj_itr)))
+			obj->partition = xstrdup(obj->partition);
+		list_iterator_destroy(obj_itr);
+
+		snap_job->job_id = job_ptr->job_id;
+		snap_job->user_id = job_ptr->user_id;
+		snap_job->account = xstrdup(job_ptr->account);
+		snap_job->mcs_label = xstrdup(job_ptr->mcs_label);
+		snap_job->use_time = _job_use_time(job_ptr);
+		list_append(snapshot->job_list, snap_job);
+	}
+	list_iterator_destroy(itr);
+
+	snapshot->job_cnt = list_count(snapshot->job_list);
+	snapshot->job_ids = xcalloc(MAX(snapshot->job_cnt, 1),
+				    sizeof(uint32_t));
+	itr = list_iterator_create(snapshot->job_list);
+	for (i = 0; (snap_job = list_next(itr)); i++)
+		snapshot->job_ids[i] = snap_job->job_id;
+	list_iterator_destroy(itr);
+	snapshot->job_cnt = _sort_job_ids(snapshot->job_ids,
+					  snapshot->job_cnt);
+
+	slurm_mutex_lock(&prio_snapshot_mutex);
+	old_snapshot = prio_snapshot;
+	prio_snapshot = snapshot;
+	slurm_mutex_unlock(&prio_snapshot_mutex);
+
+	_prio_snapshot_release(old_snapshot);
+}
+
+static bool _uint32_in_list(List list, uint32_t value)
+{
+	ListIterator itr;
+	uint32_t *list_value;
+	bool found = false;
+
+	itr = list_iterator_create(list);
+	while ((list_value = list_next(itr))) {
+		if (*list_value == value) {
+			found = true;
+			break;
+		}
+	}
+	list_iterator_destroy(itr);
+
+	return found;
+}
+
+static int _find_part_name(void *x, void *key)
+{
+	return !xstrcmp((char *) x, (char *) key);
+}
+
+/*
+ * Build the sprio response from a snapshot the caller holds a reference of,
+ * leaving out the jobs of the sorted changed_ids
+ */
+static List _get_snapshot_factors_list(prio_snapshot_t *snapshot,
+				       priority_factors_request_msg_t *req_msg,
+				       uid_t uid, uint32_t *changed_ids,
+				       int changed_cnt)
+{
+	List ret_list, part_filter_list = NULL;
+	ListIterator itr, obj_itr;
+	prio_snapshot_job_t *snap_job;
+	priority_factors_object_t *obj, *ret_obj;
+	time_t now = time(NULL);
+	char *part_str, *tok, *last = NULL;
+
+	if (req_msg->partitions) {
+		part_filter_list = list_create(xfree_ptr);
+		part_str = xstrdup(req_msg->partitions);
+		tok = strtok_r(part_str, ",", &last);
+		while (tok) {
+			list_append(part_filter_list, xstrdup(tok));
+			tok = strtok_r(NULL, ",", &last);
+		}
+		xfree(part_str);
+	}
+
+	ret_list = list_create(_destroy_factors_object);
+	itr = list_iterator_create(snapshot->job_list);
+	while ((snap_job = list_next(itr))) {
+		if (req_msg->job_id_list &&
+		    !_uint32_in_list(req_msg->job_id_list, snap_job->job_id))
+			continue;
+		if (req_msg->uid_list &&
+		    !_uint32_in_list(req_msg->uid_list, snap_job->user_id))
+			continue;
+		if (req_msg->accounts &&
+		    !_account_in_list(req_msg->accounts, snap_job->account))
+			continue;
+		if (!snap_job->use_time || (snap_job->use_time > now))
+			continue;
+		if (_find_job_id(changed_ids, changed_cnt, snap_job->job_id))
+			continue;
+		if (_factors_private(uid, snap_job->user_id, snap_job->account,
+				     snap_job->mcs_label))
+			continue;
+
+		obj_itr = list_iterator_create(snap_job->factors_list);
+		while ((obj = list_next(obj_itr))) {
+			if (part_filter_list &&
+			    !list_find_first(part_filter_list, _find_part_name,
+					     obj->partition))
+				continue;
+			ret_obj = xmalloc(sizeof(priority_factors_object_t));
+			slurm_copy_priority_factors_object(ret_obj, obj);
+			list_append(ret_list, ret_obj);
+		}
+		list_iterator_destroy(obj_itr);
+	}
+	list_iterator_destroy(itr);
+	FREE_NULL_LIST(part_filter_list);
+
+	return ret_list;
+}
+
+/*
+ * Return the requested jobs which changed since the snapshot was built or
+ * are not in it, sorted
+ */
+static uint32_t *_requested_live_ids(prio_snapshot_t *snapshot,
+				     List job_id_list, uint32_t *changed_ids,
+				     int changed_cnt, int *live_cnt)
+{
+	ListIterator itr;
+	uint32_t *job_id, *live_ids;
+	int cnt = 0;
+
+	live_ids = xcalloc(MAX(list_count(job_id_list), 1), sizeof(uint32_t));
+	itr = list_iterator_create(job_id_list);
+	while ((job_id = list_next(itr))) {
+		if (_find_job_id(changed_ids, changed_cnt, *job_id) ||
+		    !_find_job_id(snapshot->job_ids, snapshot->job_cnt,
+				  *job_id))
+			live_ids[cnt++] = *job_id;
+	}
+	list_iterator_destroy(itr);
+
+	*live_cnt = _sort_job_ids(live_ids, cnt);
+	return live_ids;
+}
+
+/* Append the priority factors of the jobs of live_ids as they are now */
+static void _add_live_factors(List ret_list,
+			      priority_factors_request_msg_t *req_msg,
+			      uid_t uid, uint32_t *live_ids, int live_cnt)
+{
+	List part_filter_list, live_list;
+	ListIterator itr;
+	job_record_t *job_ptr;
+	priority_factors_object_t *obj;
+	time_t now = time(NULL);
+	int i;
+	/* Read lock on jobs, nodes, and partitions */
+	slurmctld_lock_t job_read_lock =
+		{ NO_LOCK, READ_LOCK, READ_LOCK, READ_LOCK, NO_LOCK };
+
+	live_list = list_create(NULL);
+	lock_slurmctld(job_read_lock);
+	part_filter_list = _part_filter_list(req_msg->partitions);
+	for (i = 0; i < live_cnt; i++) {
+		if (!(job_ptr = find_job_record(live_ids[i])) ||
+		    _skip_live_job(job_ptr, uid, now))
+			continue;
+		_filter_job(job_ptr, req_msg, part_filter_list, live_list);
+	}
+
+	/* _filter_job() points at the partition's own name */
+	itr = list_iterator_create(live_list);
+	while ((obj = list_next(itr)))
+		obj->partition = xstrdup(obj->partition);
+	list_iterator_destroy(itr);
+	unlock_slurmctld(job_read_lock);
+
+	list_transfer(ret_list, live_list);
+	FREE_NULL_LIST(live_list);
+	FREE_NULL_LIST(part_filter_list);
+}
+
 static void _internal_setup(void)
 {
 	damp_factor = (long double) slurm_conf.fs_dampening_factor;
@@ -1759,6 +2380,8 @@ int init ( void )
 
 int fini ( void )
 {
+	prio_snapshot_t *snapshot;
+
 	plugin_shutdown = time(NULL);
 
 	/* Daemon termination handled here */
@@ -1779,6 +2402,12 @@ int fini ( void )
 	if (decay_handler_thread)
 		pthread_join(decay_handler_thread, NULL);
 
+	slurm_mutex_lock(&prio_snapshot_mutex);
+	snapshot = prio_snapshot;
+	prio_snapshot = NULL;
+	slurm_mutex_unlock(&prio_snapshot_mutex);
+	_prio_snapshot_release(snapshot);
+
 	site_factor_plugin_fini();
 
 	return SLURM_SUCCESS;
@@ -1795,6 +2424,7 @@ extern uint32_t priority_p_set(uint32_t last_prio, job_record_t *job_ptr)
 	site_factor_g_set(job_ptr);
 
 	priority = _get_priority_internal(time(NULL), job_ptr);
+	_prio_snapshot_job_changed(job_ptr->job_id);
 
 	debug2("initial priority for job %u is %u", job_ptr->job_id, priority);
 
@@ -1895,68 +2525,68 @@ extern List priority_p_get_priority_factors_list(
 	List ret_list = NULL, part_filter_list = NULL;
 	ListIterator itr;
 	job_record_t *job_ptr = NULL;
-	part_record_t *part_ptr;
+	prio_snapshot_t *snapshot;
 	time_t start_time = time(NULL);
-	char *part_str, *tok, *last = NULL;
+	uint32_t *changed_ids = NULL, *live_ids;
+	int changed_cnt = 0, live_cnt;
 	/* Read lock on jobs, nodes, and partitions */
 	slurmctld_lock_t job_read_lock =
 		{ NO_LOCK, READ_LOCK, READ_LOCK, READ_LOCK, NO_LOCK };
 
 	xassert(req_msg);
 
-	lock_slurmctld(job_read_lock);
-	if (req_msg->partitions) {
-		part_filter_list = list_create(NULL);
-		part_str = xstrdup(req_msg->partitions);
-		tok = strtok_r(part_str, ",", &last);
-		while (tok) {
-			if ((part_ptr = find_part_record(tok)))
-				list_append(part_filter_list, part_ptr);
-			tok = strtok_r(NULL, ",", &last);
+	/*
+	 * Serve from the last decay cycle's factors when there are some.
+	 * Jobs changed since then, or requested but not in the snapshot, are
+	 * computed live.
+	 */
+	slurm_mutex_lock(&prio_snapshot_mutex);
+	snapshot = prio_snapshot;
+	if (snapshot) {
+		snapshot->ref_cnt++;
+		changed_cnt = snapshot->changed_cnt;
+		if (changed_cnt) {
+			changed_ids = xcalloc(changed_cnt, sizeof(uint32_t));
+			memcpy(changed_ids, snapshot->changed_ids,
+			       sizeof(uint32_t) * changed_cnt);
 		}
-		xfree(part_str);
 	}
+	slurm_mutex_unlock(&prio_snapshot_mutex);
+	if (snapshot) {
+		changed_cnt = _sort_job_ids(changed_ids, changed_cnt);
+		ret_list = _get_snapshot_factors_list(snapshot, req_msg, uid,
+						      changed_ids,
+						      changed_cnt);
+		if (req_msg->job_id_list) {
+			live_ids = _requested_live_ids(snapshot,
+						       req_msg->job_id_list,
+						       changed_ids,
+						       changed_cnt,
+						       &live_cnt);
+			xfree(changed_ids);
+		} else {
+			live_ids = changed_ids;
+			live_cnt = changed_cnt;
+		}
+		_prio_snapshot_release(snapshot);
 
-	if (job_list && list_count(job_list)) {
-		time_t use_time;
+		if (live_cnt)
+			_add_live_factors(ret_list, req_msg, uid, live_ids,
+					  live_cnt);
+		xfree(live_ids);
+		if (!list_count(ret_list))
+			FREE_NULL_LIST(ret_list);
+		return ret_list;
+	}
+
+	lock_slurmctld(job_read_lock);
+	part_filter_list = _part_filter_list(req_msg->partitions);
 
+	if (job_list && list_count(job_list)) {
 		ret_list = list_create(slurm_destroy_priority_factors_object);
 		itr = list_iterator_create(job_list);
 		while ((job_ptr = list_next(itr))) {
-			if (!(flags & PRIORITY_FLAGS_CALCULATE_RUNNING) &&
-			    !IS_JOB_PENDING(job_ptr))
-				continue;
-
-			/* Job is not active on this cluster. */
-			if (IS_JOB_REVOKED(job_ptr))
-				continue;
-
-			/*
-			 * This means the job is not eligible yet
-			 */
-			if (flags & PRIORITY_FLAGS_ACCRUE_ALWAYS)
-				use_time = job_ptr->details->submit_time;
-			else
-				use_time = job_ptr->details->begin_time;
-
-			if (!use_time || (use_time > start_time))
-				continue;
-
-			/*
-			 * 0 means the job is held
-			 */
-			if (job_ptr->priority == 0)
-				continue;
-
-			if ((slurm_conf.private_data & PRIVATE_DATA_JOBS) &&
-			    (job_ptr->user_id != uid) &&
-			    !validate_operator(uid) &&
-			    (((slurm_mcs_get_privatedata() == 0) &&
-			      !assoc_mgr_is_user_acct_coord(acct_db_conn, uid,
-			                                    job_ptr->account))||
-			     ((slurm_mcs_get_privatedata() == 1) &&
-			      (mcs_g_check_mcs_label(uid, job_ptr->mcs_label)
-			       != 0))))
+			if (_skip_live_job(job_ptr, uid, start_time))
 				continue;
 
 			_filter_job(job_ptr, req_msg, part_filter_list,
@@ -1981,6 +2611,11 @@ extern void priority_p_job_end(job_record_t *job_ptr)
 	_apply_new_usage(job_ptr, g_last_ran, time(NULL), 1);
 }
 
+extern void priority_p_job_changed(job_record_t *job_ptr)
+{
+	_prio_snapshot_job_changed(job_ptr->job_id);
+}
+
 extern bool decay_apply_new_usage(job_record_t *job_ptr,
 				  time_t *start_time_ptr)
 {
@@ -2001,37 +2636,208 @@ extern bool decay_apply_new_usage(job_record_t *job_ptr,
 }
 
 
-extern int decay_apply_weighted_factors(job_record_t *job_ptr,
-					time_t *start_time_ptr)
+/*
+ * Start batching the usage of running jobs. Until decay_usage_batch_flush()
+ * is called the assoc_mgr locks are held and decay_apply_new_usage() only
+ * records usage per association.
+ * Caller must hold the slurmctld job write lock until the batch is flushed.
+ */
+extern void decay_usage_batch_start(void)
 {
-	uint32_t new_prio;
+	xassert(!usage_delta_hash);
 
-	/* Always return SUCCESS so that list_for_each will
-	 * continue processing list of jobs. */
+	assoc_mgr_lock(&usage_delta_locks);
+	usage_delta_hash = xhash_init(_usage_delta_identity, _usage_delta_free);
+}
+
+/* Add the usage recorded since decay_usage_batch_start() to the tree */
+extern void decay_usage_batch_flush(void)
+{
+	usage_delta_t **deltas, **next, *delta, *parent;
+	slurmdb_assoc_rec_t *assoc;
+	uint32_t cnt, i;
+
+	xassert(usage_delta_hash);
+
+	cnt = xhash_count(usage_delta_hash);
+	deltas = next = xcalloc(cnt + 1, sizeof(usage_delta_t *));
+	xhash_walk(usage_delta_hash, _usage_delta_to_array, &next);
+	qsort(deltas, cnt, sizeof(usage_delta_t *), _usage_delta_cmp_depth);
 
 	/*
-	 * Priority 0 is reserved for held jobs. Also skip priority
-	 * re_calculation for non-pending jobs.
+	 * Children come before their parent, so by the time an association
+	 * is reached its record holds the usage of its whole subtree.
 	 */
+	for (i = 0; i < cnt; i++) {
+		delta = deltas[i];
+		assoc = delta->assoc;
+
+		assoc->usage->grp_used_wall += delta->run_decay;
+		assoc->usage->usage_raw += (long double)delta->real_decay;
+		assoc->usage->fs_usage_changed = true;
+		log_flag(PRIO, "Adding %f new usage to assoc %u (%s/%s/%s) raw usage is now %Lf. Group wall added %f making it %f.",
+			 delta->real_decay, assoc->id, assoc->acct,
+			 assoc->user, assoc->partition,
+			 assoc->usage->usage_raw, delta->run_decay,
+			 assoc->usage->grp_used_wall);
+		_handle_assoc_tres_run_secs(delta->tres_run_decay,
+					    delta->tres_run_delta, 0, assoc);
+
+		if (!assoc->usage->parent_assoc_ptr)
+			continue;
+		parent = _usage_delta_find(assoc->usage->parent_assoc_ptr);
+		_usage_delta_add(parent, delta->run_decay, delta->real_decay,
+				 delta->tres_run_decay, delta->tres_run_delta);
+	}
+
+	xfree(deltas);
+	xhash_free(usage_delta_hash);
+	assoc_mgr_unlock(&usage_delta_locks);
+}
+
+/*
+ * Priority 0 is reserved for held jobs. Also skip priority
+ * re_calculation for non-pending jobs.
+ */
+static bool _job_prio_recalc(job_record_t *job_ptr)
+{
 	if ((job_ptr->priority == 0) ||
 	    IS_JOB_POWER_UP_NODE(job_ptr) ||
 	    (!IS_JOB_PENDING(job_ptr) &&
 	     !(flags & PRIORITY_FLAGS_CALCULATE_RUNNING)))
-		return SLURM_SUCCESS;
+		return false;
+	return true;
+}
 
-	new_prio = _get_priority_internal(*start_time_ptr, job_ptr);
+/* Returns true if the job's priority changed */
+static bool _set_job_prio(job_record_t *job_ptr, time_t start_time)
+{
+	uint32_t new_prio;
+	bool updated = false;
+
+	new_prio = _get_priority_internal(start_time, job_ptr);
 	if (((flags & PRIORITY_FLAGS_INCR_ONLY) == 0) ||
 	    (job_ptr->priority < new_prio)) {
 		job_ptr->priority = new_prio;
-		last_job_update = time(NULL);
+		updated = true;
 	}
 
 	debug2("priority for job %u is now %u",
 	       job_ptr->job_id, job_ptr->priority);
 
+	return updated;
+}
+
+static void *_set_job_prio_thread(void *arg)
+{
+	prio_thread_args_t *args = (prio_thread_args_t *) arg;
+	int i;
+
+	for (i = 0; i < args->job_cnt; i++) {
+		if (_set_job_prio(args->jobs[i], args->start_time))
+			args->updated = true;
+	}
+
+	return NULL;
+}
+
+extern int decay_apply_weighted_factors(job_record_t *job_ptr,
+					time_t *start_time_ptr)
+{
+	/* Always return SUCCESS so that list_for_each will
+	 * continue processing list of jobs. */
+
+	if (!_job_prio_recalc(job_ptr))
+		return SLURM_SUCCESS;
+
+	if (_set_job_prio(job_ptr, *start_time_ptr))
+		last_job_update = time(NULL);
+
 	return SLURM_SUCCESS;
 }
 
+/*
+ * Set the priority of all unfinished jobs in job_list, splitting the jobs
+ * across threads when there are enough of them. A job's priority only
+ * depends on the job itself and on association, QOS and partition data
+ * that is not modified while the priorities are set.
+ * Caller must hold the slurmctld job write lock.
+ */
+extern void decay_apply_weighted_factors_all(List job_list, time_t start_time)
+{
+	job_record_t *job_ptr, **jobs;
+	prio_thread_args_t *args;
+	pthread_t *thread_ids;
+	ListIterator itr;
+	int i, job_cnt = 0, thread_cnt, per_thread;
+	long cpu_cnt;
+	bool updated = false;
+	assoc_mgr_lock_t locks = { .assoc = WRITE_LOCK };
+
+	jobs = xcalloc(list_count(job_list) + 1, sizeof(job_record_t *));
+
+	/*
+	 * Effective usage is computed on first use. Do it here for all jobs
+	 * so the threads below only read association data.
+	 */
+	assoc_mgr_lock(&locks);
+	itr = list_iterator_create(job_list);
+	while ((job_ptr = list_next(itr))) {
+		/* Don't need to handle finished jobs. */
+		if (IS_JOB_FINISHED(job_ptr) || IS_JOB_COMPLETING(job_ptr) ||
+		    !_job_prio_recalc(job_ptr))
+			continue;
+		if (calc_fairshare && weight_fs && job_ptr->assoc_ptr)
+			(void) _get_fs_assoc(job_ptr->assoc_ptr);
+		jobs[job_cnt++] = job_ptr;
+	}
+	list_iterator_destroy(itr);
+	assoc_mgr_unlock(&locks);
+
+	cpu_cnt = sysconf(_SC_NPROCESSORS_ONLN);
+	thread_cnt = MIN(job_cnt / PRIO_THREAD_MIN_JOBS, PRIO_THREADS_MAX);
+	if (cpu_cnt > 0)
+		thread_cnt = MIN(thread_cnt, cpu_cnt);
+
+	if (thread_cnt <= 1) {
+		prio_thread_args_t serial_args = {
+			.jobs = jobs,
+			.job_cnt = job_cnt,
+			.start_time = start_time,
+		};
+
+		_set_job_prio_thread(&serial_args);
+		updated = serial_args.updated;
+	} else {
+		args = xcalloc(thread_cnt, sizeof(prio_thread_args_t));
+		thread_ids = xcalloc(thread_cnt, sizeof(pthread_t));
+		per_thread = (job_cnt + thread_cnt - 1) / thread_cnt;
+		for (i = 0; i < thread_cnt; i++) {
+			args[i].jobs = jobs + (i * per_thread);
+			args[i].job_cnt = MIN(per_thread,
+					      job_cnt - (i * per_thread));
+			args[i].start_time = start_time;
+			slurm_thread_create(&thread_ids[i],
+					    _set_job_prio_thread, &args[i]);
+		}
+		for (i = 0; i < thread_cnt; i++) {
+			pthread_join(thread_ids[i], NULL);
+			if (args[i].updated)
+				updated = true;
+		}
+		log_flag(PRIO, "%s: set priority of %d jobs using %d threads",
+			 __func__, job_cnt, thread_cnt);
+		xfree(args);
+		xfree(thread_ids);
+	}
+
+	if (updated)
+		last_job_update = time(NULL);
+	xfree(jobs);
+
+	_build_prio_snapshot(job_list);
+}
+
 
 extern void set_priority_factors(time_t start_time, job_record_t *job_ptr)
 {
@@ -54,8 +54,12 @@ extern double priority_p_calc_fs_factor(
 		long double usage_efctv, long double shares_norm);
 extern bool decay_apply_new_usage(job_record_t *job_ptr,
 				  time_t *start_time_ptr);
+extern void decay_usage_batch_start(void);
+extern void decay_usage_batch_flush(void);
 extern int decay_apply_weighted_factors(job_record_t *job_ptr,
 					time_t *start_time_ptr);
+extern void decay_apply_weighted_factors_all(List job_list,
+					     time_t start_time);
 extern void set_assoc_usage_norm(slurmdb_assoc_rec_t *assoc);
 extern void set_priority_factors(time_t start_time, job_record_t *job_ptr);
 
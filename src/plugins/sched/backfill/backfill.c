@@ -1013,6 +1013,7 @@ extern void *backfill_agent(void *args)
 		error("cannot set my name to %s %m", "backfill");
 	}
 #endif
+	sched_phase_set_ctx(SCHED_CTX_BACKFILL);
 	_load_config();
 	last_backfill_time = time(NULL);
 	het_job_list = list_create(_het_job_map_del);
@@ -1058,6 +1059,7 @@ extern void *backfill_agent(void *args)
 		last_backfill_time = time(NULL);
 		(void) bb_g_job_try_stage_in();
 		unlock_slurmctld(all_locks);
+		sched_phase_flush();
 
 		slurm_mutex_lock(&check_bf_running_lock);
 		slurmctld_diag_stats.bf_active = 0;
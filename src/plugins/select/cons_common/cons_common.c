@@ -99,6 +99,18 @@ bool     topo_optional        = false;
 
 /* Global variables */
 
+/*
+ * Switches whose node_bitmap includes each node (a leaf switch and its
+ * ancestors), built by select_p_node_init(). The switches of node i are
+ * topo_node_switch[topo_node_switch_off[i]] through
+ * topo_node_switch[topo_node_switch_off[i + 1] - 1].
+ */
+static int *topo_node_switch_off = NULL;
+static uint16_t *topo_node_switch = NULL;
+static switch_record_t *topo_index_table = NULL;
+static int topo_index_switch_cnt = 0;
+static int topo_index_node_cnt = 0;
+
 static job_resources_t *_create_job_resources(int node_cnt)
 {
 	job_resources_t *job_resrcs_ptr;
@@ -726,6 +738,25 @@ extern void common_free_avail_res(avail_res_t *avail_res)
 	xfree(avail_res);
 }
 
+extern uint16_t common_min_cpus_per_node(job_record_t *job_ptr)
+{
+	struct job_details *details = job_ptr->details;
+	uint16_t ntasks_per_node = 1;
+
+	if (details->ntasks_per_node) {
+		ntasks_per_node = details->ntasks_per_node;
+	} else if (details->overcommit) {
+		ntasks_per_node = 1;
+	} else if ((details->max_nodes == 1) && (details->num_tasks != 0)) {
+		ntasks_per_node = details->num_tasks;
+	} else if (details->max_nodes) {
+		ntasks_per_node = (details->num_tasks + details->max_nodes - 1) /
+				  details->max_nodes;
+	}
+
+	return ntasks_per_node * details->cpus_per_task;
+}
+
 /*
  * Return the number of usable logical processors by a given job on
  * some specified node. Returns 0xffff if no limit.
@@ -782,6 +813,96 @@ extern void common_init(void)
 
 }
 
+static void _topo_index_free(void)
+{
+	xfree(topo_node_switch_off);
+	xfree(topo_node_switch);
+	topo_index_table = NULL;
+	topo_index_switch_cnt = 0;
+	topo_index_node_cnt = 0;
+}
+
+static void _topo_index_build(void)
+{
+	int i, n, n_first, n_last, *pos;
+
+	_topo_index_free();
+	if (!switch_record_cnt || !switch_record_table || !select_node_cnt)
+		return;
+
+	topo_node_switch_off = xcalloc(select_node_cnt + 1, sizeof(int));
+	for (i = 0; i < switch_record_cnt; i++) {
+		if (!switch_record_table[i].node_bitmap)
+			continue;
+		n_first = bit_ffs(switch_record_table[i].node_bitmap);
+		if (n_first == -1)
+			continue;
+		n_last = bit_fls(switch_record_table[i].node_bitmap);
+		for (n = n_first; n <= n_last; n++) {
+			if (bit_test(switch_record_table[i].node_bitmap, n))
+				topo_node_switch_off[n + 1]++;
+		}
+	}
+	for (n = 0; n < select_node_cnt; n++)
+		topo_node_switch_off[n + 1] += topo_node_switch_off[n];
+
+	topo_node_switch = xcalloc(topo_node_switch_off[select_node_cnt] + 1,
+				   sizeof(uint16_t));
+	pos = xcalloc(select_node_cnt, sizeof(int));
+	for (i = 0; i < switch_record_cnt; i++) {
+		if (!switch_record_table[i].node_bitmap)
+			continue;
+		n_first = bit_ffs(switch_record_table[i].node_bitmap);
+		if (n_first == -1)
+			continue;
+		n_last = bit_fls(switch_record_table[i].node_bitmap);
+		for (n = n_first; n <= n_last; n++) {
+			if (!bit_test(switch_record_table[i].node_bitmap, n))
+				continue;
+			topo_node_switch[topo_node_switch_off[n] + pos[n]++] =
+				i;
+		}
+	}
+	xfree(pos);
+
+	topo_index_table = switch_record_table;
+	topo_index_switch_cnt = switch_record_cnt;
+	topo_index_node_cnt = select_node_cnt;
+}
+
+extern void common_topo_switch_node_cnt(bitstr_t *node_map,
+					int *switch_node_cnt)
+{
+	int i, j, n_first, n_last;
+
+	memset(switch_node_cnt, 0, sizeof(int) * switch_record_cnt);
+
+	/* Topology changed without select_p_node_init(), count the slow way */
+	if ((topo_index_table != switch_record_table) ||
+	    (topo_index_switch_cnt != switch_record_cnt) ||
+	    (topo_index_node_cnt != select_node_cnt)) {
+		for (i = 0; i < switch_record_cnt; i++) {
+			if (!switch_record_table[i].node_bitmap)
+				continue;
+			switch_node_cnt[i] = bit_overlap(
+				switch_record_table[i].node_bitmap, node_map);
+		}
+		return;
+	}
+
+	n_first = bit_ffs(node_map);
+	if (n_first == -1)
+		return;
+	n_last = bit_fls(node_map);
+	for (i = n_first; i <= n_last; i++) {
+		if (!bit_test(node_map, i))
+			continue;
+		for (j = topo_node_switch_off[i];
+		     j < topo_node_switch_off[i + 1]; j++)
+			switch_node_cnt[topo_node_switch[j]]++;
+	}
+}
+
 extern void common_fini(void)
 {
 	if (slurm_conf.debug_flags & DEBUG_FLAG_SELECT_TYPE)
@@ -795,6 +916,7 @@ extern void common_fini(void)
 	part_data_destroy_res(select_part_record);
 	select_part_record = NULL;
 	cr_fini_global_core_data();
+	_topo_index_free();
 }
 
 /*
@@ -1149,6 +1271,7 @@ extern int select_p_node_init(node_record_t *node_ptr, int node_cnt)
 	}
 	part_data_create_array();
 	node_data_dump();
+	_topo_index_build();
 
 	return SLURM_SUCCESS;
 }
@@ -1450,6 +1573,7 @@ extern int select_p_job_resized(job_record_t *job_ptr, node_record_t *node_ptr)
 			return SLURM_SUCCESS;
 		}
 
+		node_usage[i].version++;
 		if (node_usage[i].gres_list)
 			gres_list = node_usage[i].gres_list;
 		else
@@ -1568,6 +1692,7 @@ extern int select_p_job_mem_confirm(job_record_t *job_ptr)
 			select_node_record[i].mem_spec_limit;
 		job_ptr->job_resrcs->memory_allocated[offset] = avail_mem;
 		select_node_usage[i].alloc_memory = avail_mem;
+		select_node_usage[i].version++;
 		if ((offset == 0) || (lowest_mem > avail_mem))
 			lowest_mem = avail_mem;
 		offset++;
@@ -2067,6 +2192,10 @@ extern int select_p_update_node_config(int index)
 		/* tot_cores should be the same */
 	}
 
+	/* GRES may have changed, rebuild the node's availability summary */
+	if (select_node_usage)
+		select_node_usage[index].version++;
+
 	return SLURM_SUCCESS;
 }
 
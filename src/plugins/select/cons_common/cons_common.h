@@ -138,6 +138,18 @@ extern void common_free_avail_res(avail_res_t *avail_res);
 /* Determine how many cpus per core we can use */
 extern int common_cpus_per_core(struct job_details *details, int node_inx);
 
+/* Minimum CPU count a node must offer to run the job's tasks on it */
+extern uint16_t common_min_cpus_per_node(job_record_t *job_ptr);
+
+/*
+ * Set switch_node_cnt[i] to the count of nodes in node_map which are on
+ * switch_record_table[i], from an index of the switches of each node
+ * rather than a bitmap operation per switch.
+ * switch_node_cnt OUT - array of switch_record_cnt elements
+ */
+extern void common_topo_switch_node_cnt(bitstr_t *node_map,
+					int *switch_node_cnt);
+
 extern void common_init(void);
 extern void common_fini(void);
 
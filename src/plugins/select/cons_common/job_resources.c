@@ -337,6 +337,7 @@ extern int job_res_add_job(job_record_t *job_ptr, job_res_job_action_t action)
 		if (job->cpus[n] == 0)
 			continue;  /* node removed by job resize */
 
+		select_node_usage[i].version++;
 		node_ptr = select_node_record[i].node_ptr;
 		if (action != JOB_RES_ACTION_RESUME) {
 			if (select_node_usage[i].gres_list)
@@ -517,6 +518,7 @@ extern int job_res_rm_job(part_res_record_t *part_record_ptr,
 		if (job->cpus[n] == 0)
 			continue;  /* node lost by job resize */
 
+		node_usage[i].version++;
 		node_ptr = node_record_table_ptr + i;
 		if (action != JOB_RES_ACTION_RESUME) {
 			if (node_usage[i].gres_list)
@@ -63,6 +63,22 @@ typedef struct {
 	bool *qos_preemptor;
 } cr_job_list_args_t;
 
+/*
+ * Structure of arrays view of the per node resources a job is tested against,
+ * indexed by node (GRES by job GRES then node). It lets _node_view_filter()
+ * discard nodes lacking the job's per node CPU, memory or GRES minimum in a
+ * few passes over contiguous arrays, before can_job_run_on_node() does the
+ * detailed (and much more costly) core and GRES evaluation of each node.
+ */
+typedef struct {
+	uint32_t *free_cpus;	/* available cores * threads per core */
+	uint64_t *free_mem;	/* NO_VAL64 if memory is not consumable */
+	int gres_cnt;		/* job GRES with a per node count */
+	uint32_t *gres_id;	/* [gres_cnt] plugin_id */
+	uint64_t *gres_need;	/* [gres_cnt] count required per node */
+	uint64_t *free_gres;	/* [gres_cnt * select_node_cnt] */
+} node_view_t;
+
 uint64_t def_cpu_per_gpu = 0;
 uint64_t def_mem_per_gpu = 0;
 bool preempt_strict_order = false;
@@ -304,6 +320,197 @@ static uint32_t _socks_per_node(job_record_t *job_ptr)
 	return s_p_n;
 }
 
+/*
+ * Fill the free count of each job GRES on node i, walking the node's GRES
+ * list once and matching it against the job's GRES in view->gres_id[],
+ * rather than searching the list for each job GRES. GRES the node lacks
+ * are left at zero.
+ */
+static void _node_view_gres_fill(node_view_t *view, List node_gres_list,
+				 int i, bool use_total_gres)
+{
+	ListIterator iter;
+	gres_state_t *gres_ptr;
+	gres_node_state_t *gres_node_ptr;
+	uint64_t free_cnt;
+	int g;
+
+	if (!node_gres_list)
+		return;
+
+	iter = list_iterator_create(node_gres_list);
+	while ((gres_ptr = list_next(iter))) {
+		for (g = 0; g < view->gres_cnt; g++) {
+			if (view->gres_id[g] == gres_ptr->plugin_id)
+				break;
+		}
+		if (g >= view->gres_cnt)
+			continue;
+
+		gres_node_ptr = gres_ptr->gres_data;
+		if (use_total_gres || gres_node_ptr->no_consume)
+			free_cnt = gres_node_ptr->gres_cnt_avail;
+		else if (gres_node_ptr->gres_cnt_alloc >=
+			 gres_node_ptr->gres_cnt_avail)
+			free_cnt = 0;
+		else
+			free_cnt = gres_node_ptr->gres_cnt_avail -
+				   gres_node_ptr->gres_cnt_alloc;
+		view->free_gres[g * select_node_cnt + i] = free_cnt;
+	}
+	list_iterator_destroy(iter);
+}
+
+static void _node_view_build(node_view_t *view, job_record_t *job_ptr,
+			     bitstr_t *node_map, bitstr_t **core_map,
+			     node_use_record_t *node_usage, uint16_t cr_type,
+			     bool test_only, int i_first, int i_last)
+{
+	ListIterator iter;
+	gres_state_t *gres_ptr;
+	gres_job_state_t *gres_job_ptr;
+	List node_gres_list;
+	node_avail_t *avail = NULL;
+	int cores, g, k, i;
+
+	memset(view, 0, sizeof(*view));
+	view->free_cpus = xcalloc(select_node_cnt, sizeof(uint32_t));
+	view->free_mem = xcalloc(select_node_cnt, sizeof(uint64_t));
+
+	if (job_ptr->gres_list) {
+		g = list_count(job_ptr->gres_list);
+		view->gres_id = xcalloc(g, sizeof(uint32_t));
+		view->gres_need = xcalloc(g, sizeof(uint64_t));
+		iter = list_iterator_create(job_ptr->gres_list);
+		while ((gres_ptr = list_next(iter))) {
+			gres_job_ptr = gres_ptr->gres_data;
+			if (!gres_job_ptr->gres_per_node ||
+			    (gres_job_ptr->flags & GRES_NO_CONSUME))
+				continue;
+			view->gres_id[view->gres_cnt] = gres_ptr->plugin_id;
+			view->gres_need[view->gres_cnt] =
+				gres_job_ptr->gres_per_node;
+			view->gres_cnt++;
+		}
+		list_iterator_destroy(iter);
+		view->free_gres = xcalloc(view->gres_cnt * select_node_cnt,
+					  sizeof(uint64_t));
+	}
+
+	for (i = i_first; i <= i_last; i++) {
+		if (!bit_test(node_map, i))
+			continue;
+
+		if (core_map[i])
+			cores = bit_set_count(core_map[i]);
+		else
+			cores = select_node_record[i].tot_cores;
+		view->free_cpus[i] = cores * select_node_record[i].vpus;
+
+		/*
+		 * Live node state is summarized once per change of the node's
+		 * allocations, state copies (will_run) are read directly
+		 */
+		if (!test_only && (node_usage == select_node_usage))
+			avail = node_data_avail(i);
+
+		/* Same as can_job_run_on_node() */
+		if (!(cr_type & CR_MEMORY)) {
+			view->free_mem[i] = NO_VAL64;
+		} else if (avail) {
+			view->free_mem[i] = avail->free_mem;
+		} else {
+			view->free_mem[i] = select_node_record[i].real_memory -
+					    select_node_record[i].mem_spec_limit;
+			if (!test_only)
+				view->free_mem[i] -=
+					node_usage[i].alloc_memory;
+		}
+
+		if (!view->gres_cnt)
+			continue;
+		if (avail) {
+			for (g = 0; g < view->gres_cnt; g++) {
+				for (k = 0; k < avail->gres_cnt; k++) {
+					if (avail->gres_id[k] !=
+					    view->gres_id[g])
+						continue;
+					view->free_gres[g * select_node_cnt +
+							i] =
+						avail->gres_free[k];
+					break;
+				}
+			}
+			continue;
+		}
+		if (node_usage[i].gres_list)
+			node_gres_list = node_usage[i].gres_list;
+		else
+			node_gres_list = node_record_table_ptr[i].gres_list;
+		_node_view_gres_fill(view, node_gres_list, i, test_only);
+	}
+}
+
+static void _node_view_free(node_view_t *view)
+{
+	xfree(view->free_cpus);
+	xfree(view->free_mem);
+	xfree(view->gres_id);
+	xfree(view->gres_need);
+	xfree(view->free_gres);
+}
+
+/*
+ * Clear from node_map the nodes which can not offer the job its per node
+ * minimum CPU count, memory or GRES count. These are nodes for which
+ * can_job_run_on_node() would find no usable CPUs anyway, so their core_map
+ * is cleared as it would have done.
+ */
+static void _node_view_filter(node_view_t *view, job_record_t *job_ptr,
+			      bitstr_t *node_map, bitstr_t **core_map,
+			      uint16_t cr_type, int i_first, int i_last)
+{
+	uint32_t min_cpus = MAX(common_min_cpus_per_node(job_ptr), 1);
+	uint64_t min_mem = 0, *free_gres;
+	uint8_t *fit;
+	int g, i, cleared = 0;
+
+	if (i_first < 0)
+		return;
+
+	/*
+	 * With memory per CPU a node is unusable if one CPU's memory does
+	 * not fit, see can_job_run_on_node()
+	 */
+	if (cr_type & CR_MEMORY)
+		min_mem = job_ptr->details->pn_min_memory & ~MEM_PER_CPU;
+
+	fit = xcalloc(select_node_cnt, sizeof(uint8_t));
+	for (i = i_first; i <= i_last; i++)
+		fit[i] = (view->free_cpus[i] >= min_cpus) &
+			 (view->free_mem[i] >= min_mem);
+	for (g = 0; g < view->gres_cnt; g++) {
+		free_gres = &view->free_gres[g * select_node_cnt];
+		for (i = i_first; i <= i_last; i++)
+			fit[i] &= (free_gres[i] >= view->gres_need[g]);
+	}
+
+	for (i = i_first; i <= i_last; i++) {
+		if (fit[i] || !bit_test(node_map, i))
+			continue;
+		bit_clear(node_map, i);
+		if (core_map[i])
+			bit_clear_all(core_map[i]);
+		cleared++;
+	}
+	xfree(fit);
+
+	if (cleared) {
+		log_flag(SELECT_TYPE, "%pJ: %d nodes lack %u CPUs, %"PRIu64"MB memory or per node GRES",
+			 job_ptr, cleared, min_cpus, min_mem);
+	}
+}
+
 /*
  * Determine resource availability for pending job
  *
@@ -337,6 +544,19 @@ static avail_res_t **_get_res_avail(job_record_t *job_ptr,
 		i_last = bit_fls(node_map);
 	else
 		i_last = -2;
+
+	/* Discard nodes which obviously can not be used in bulk first */
+	if (is_cons_tres && (i_first != -1)) {
+		node_view_t view;
+
+		_node_view_build(&view, job_ptr, node_map, core_map,
+				 node_usage, cr_type, test_only, i_first,
+				 i_last);
+		_node_view_filter(&view, job_ptr, node_map, core_map, cr_type,
+				  i_first, i_last);
+		_node_view_free(&view);
+	}
+
 	for (i = i_first; i <= i_last; i++) {
 		if (bit_test(node_map, i))
 			avail_res_array[i] =
@@ -1521,11 +1741,15 @@ alloc_job:
 				avail_cores, gres_task_limit);
 	if (is_cons_tres &&
 	    job_ptr->gres_list && (error_code == SLURM_SUCCESS)) {
+		struct timeval tv;
+
+		SCHED_PHASE_START(tv);
 		error_code = gres_select_filter_select_and_set(
 			sock_gres_list,
 			job_ptr->job_id, job_res,
 			job_ptr->details->overcommit,
 			tres_mc_ptr, node_record_table_ptr);
+		SCHED_PHASE_END(tv, SCHED_PHASE_GRES_SELECT);
 	}
 	xfree(gres_task_limit);
 	xfree(node_gres_list);
@@ -2048,6 +2272,63 @@ timer_check:
 	return rc;
 }
 
+/*
+ * Test if the job could run now with all of the preemption candidates which
+ * can be removed (requeue or cancel mode) gone from a copy of the node usage.
+ * RET false only if the job can not run even then
+ */
+static bool _run_now_preempt_all(job_record_t *job_ptr,
+				 bitstr_t *orig_node_map, uint32_t min_nodes,
+				 uint32_t max_nodes, uint32_t req_nodes,
+				 uint16_t job_node_req, uint16_t cr_type,
+				 List preemptee_candidates,
+				 bitstr_t **exc_cores)
+{
+	part_res_record_t *future_part;
+	node_use_record_t *future_usage;
+	job_record_t *tmp_job_ptr;
+	ListIterator job_iterator;
+	bitstr_t *test_node_map;
+	uint16_t mode;
+	int rc = SLURM_SUCCESS, rm_job_cnt = 0;
+
+	future_part = part_data_dup_res(select_part_record, orig_node_map);
+	if (future_part == NULL)
+		return true;
+	future_usage = node_data_dup_use(select_node_usage, orig_node_map);
+	if (future_usage == NULL) {
+		part_data_destroy_res(future_part);
+		return true;
+	}
+
+	job_iterator = list_iterator_create(preemptee_candidates);
+	while ((tmp_job_ptr = list_next(job_iterator))) {
+		mode = slurm_job_preempt_mode(tmp_job_ptr);
+		if ((mode != PREEMPT_MODE_REQUEUE)    &&
+		    (mode != PREEMPT_MODE_CANCEL))
+			continue;	/* can't remove job */
+		if (!_job_res_rm_job(future_part, future_usage, tmp_job_ptr, 0,
+				     false, orig_node_map))
+			rm_job_cnt++;
+	}
+	list_iterator_destroy(job_iterator);
+
+	/* With a single job the caller's first test is this very test */
+	if (rm_job_cnt > 1) {
+		test_node_map = bit_copy(orig_node_map);
+		rc = _job_test(job_ptr, test_node_map, min_nodes, max_nodes,
+			       req_nodes, SELECT_MODE_WILL_RUN, cr_type,
+			       job_node_req, future_part, future_usage,
+			       exc_cores, false, false, true);
+		FREE_NULL_BITMAP(test_node_map);
+	}
+
+	part_data_destroy_res(future_part);
+	node_data_destroy(future_usage, NULL);
+
+	return (rc == SLURM_SUCCESS);
+}
+
 /* Allocate resources for a job now, if possible */
 static int _run_now(job_record_t *job_ptr, bitstr_t *node_bitmap,
 		    uint32_t min_nodes, uint32_t max_nodes,
@@ -2097,6 +2378,28 @@ top:	orig_node_map = bit_copy(save_node_map);
 		int preemptee_cand_cnt = list_count(preemptee_candidates);
 		/* Remove preemptable jobs from simulated environment */
 		preempt_mode = true;
+
+		/*
+		 * If the job can not run with every candidate gone, removing
+		 * them one at a time can not help either. Skip those tests.
+		 */
+		if ((pass_count == 0) && (preemptee_cand_cnt > 1) &&
+		    !_run_now_preempt_all(job_ptr, orig_node_map, min_nodes,
+					  max_nodes, req_nodes, job_node_req,
+					  tmp_cr_type, preemptee_candidates,
+					  exc_cores)) {
+			log_flag(SELECT_TYPE, "%pJ can not run even with all %d preemption candidates gone",
+				 job_ptr, preemptee_cand_cnt);
+			job_iterator = list_iterator_create(
+				preemptee_candidates);
+			while ((tmp_job_ptr = list_next(job_iterator)))
+				tmp_job_ptr->details->usable_nodes = 0;
+			list_iterator_destroy(job_iterator);
+			FREE_NULL_BITMAP(orig_node_map);
+			FREE_NULL_BITMAP(save_node_map);
+			return SLURM_ERROR;
+		}
+
 		future_part = part_data_dup_res(select_part_record,
 						orig_node_map);
 		if (future_part == NULL) {
@@ -40,6 +40,9 @@
 node_res_record_t *select_node_record = NULL;
 node_use_record_t *select_node_usage  = NULL;
 
+static node_avail_t *node_avail = NULL;	/* indexed by node */
+static int node_avail_cnt = 0;
+
 /* Delete the given select_node_record and select_node_usage arrays */
 extern void node_data_destroy(node_use_record_t *node_usage,
 			      node_res_record_t *node_data)
@@ -47,6 +50,8 @@ extern void node_data_destroy(node_use_record_t *node_usage,
 	int i;
 
 	xfree(node_data);
+	if (node_usage && (node_usage == select_node_usage))
+		node_data_avail_reset();
 	if (node_usage) {
 		for (i = 0; i < select_node_cnt; i++) {
 			FREE_NULL_LIST(node_usage[i].gres_list);
@@ -128,3 +133,89 @@ extern node_use_record_t *node_data_dup_use(
 	}
 	return new_use_ptr;
 }
+
+static void _node_avail_free(node_avail_t *avail)
+{
+	xfree(avail->gres_id);
+	xfree(avail->gres_free);
+	memset(avail, 0, sizeof(*avail));
+}
+
+static void _node_avail_build(node_avail_t *avail, int node_inx)
+{
+	node_res_record_t *node_res_ptr = &select_node_record[node_inx];
+	node_use_record_t *node_use_ptr = &select_node_usage[node_inx];
+	uint64_t avail_mem;
+	List gres_list;
+	ListIterator iter;
+	gres_state_t *gres_ptr;
+	gres_node_state_t *gres_node_ptr;
+	int g;
+
+	_node_avail_free(avail);
+
+	/* Same as can_job_run_on_node() */
+	avail_mem = node_res_ptr->real_memory - node_res_ptr->mem_spec_limit;
+	if (node_use_ptr->alloc_memory > avail_mem)
+		avail->free_mem = 0;
+	else
+		avail->free_mem = avail_mem - node_use_ptr->alloc_memory;
+
+	if (node_use_ptr->gres_list)
+		gres_list = node_use_ptr->gres_list;
+	else
+		gres_list = node_res_ptr->node_ptr->gres_list;
+	if (gres_list && (g = list_count(gres_list))) {
+		avail->gres_id = xcalloc(g, sizeof(uint32_t));
+		avail->gres_free = xcalloc(g, sizeof(uint64_t));
+		iter = list_iterator_create(gres_list);
+		while ((gres_ptr = list_next(iter))) {
+			gres_node_ptr = gres_ptr->gres_data;
+			g = avail->gres_cnt++;
+			avail->gres_id[g] = gres_ptr->plugin_id;
+			if (gres_node_ptr->no_consume)
+				avail->gres_free[g] =
+					gres_node_ptr->gres_cnt_avail;
+			else if (gres_node_ptr->gres_cnt_alloc <
+				 gres_node_ptr->gres_cnt_avail)
+				avail->gres_free[g] =
+					gres_node_ptr->gres_cnt_avail -
+					gres_node_ptr->gres_cnt_alloc;
+		}
+		list_iterator_destroy(iter);
+	}
+
+	avail->version = node_use_ptr->version;
+	avail->valid = true;
+}
+
+extern node_avail_t *node_data_avail(int node_inx)
+{
+	node_avail_t *avail;
+
+	xassert(select_node_usage);
+	xassert((node_inx >= 0) && (node_inx < select_node_cnt));
+
+	if (node_avail_cnt != select_node_cnt) {
+		node_data_avail_reset();
+		node_avail = xcalloc(select_node_cnt, sizeof(node_avail_t));
+		node_avail_cnt = select_node_cnt;
+	}
+
+	avail = &node_avail[node_inx];
+	if (!avail->valid ||
+	    (avail->version != select_node_usage[node_inx].version))
+		_node_avail_build(avail, node_inx);
+
+	return avail;
+}
+
+extern void node_data_avail_reset(void)
+{
+	int i;
+
+	for (i = 0; i < node_avail_cnt; i++)
+		_node_avail_free(&node_avail[i]);
+	xfree(node_avail);
+	node_avail_cnt = 0;
+}
@@ -68,8 +68,21 @@ typedef struct {
 				       * Local data used only in state copy
 				       * to emulate future node state */
 	uint16_t node_state;	      /* see node_cr_state comments */
+	uint32_t version;	      /* changed whenever resources are
+				       * allocated or released on the node,
+				       * see node_data_avail() */
 } node_use_record_t;
 
+/* summary of the resources of a node not allocated to jobs */
+typedef struct {
+	uint64_t free_mem;	/* MB of memory not allocated to jobs */
+	int gres_cnt;		/* count of GRES types on the node */
+	uint32_t *gres_id;	/* [gres_cnt] plugin_id */
+	uint64_t *gres_free;	/* [gres_cnt] count not allocated */
+	uint32_t version;	/* node_use_record_t version summarized */
+	bool valid;		/* summary built */
+} node_avail_t;
+
 extern node_res_record_t *select_node_record;
 extern node_use_record_t *select_node_usage;
 
@@ -82,4 +95,14 @@ extern void node_data_dump(void);
 extern node_use_record_t *node_data_dup_use(node_use_record_t *orig_ptr,
 					    bitstr_t *node_map);
 
+/*
+ * Return the availability summary of select_node_usage[node_inx], rebuilt
+ * only if resources were allocated or released on the node since the last
+ * call. The summary is valid until the next change of select_node_usage.
+ */
+extern node_avail_t *node_data_avail(int node_inx);
+
+/* Discard the availability summaries of all nodes */
+extern void node_data_avail_reset(void);
+
 #endif /*_CONS_COMMON_NODE_DATA_H */
@@ -2245,11 +2245,14 @@ static int _eval_nodes_topo(job_record_t *job_ptr,
 	switch_node_cnt    = xcalloc(switch_record_cnt, sizeof(int));
 	switch_required    = xcalloc(switch_record_cnt, sizeof(int));
 
+	common_topo_switch_node_cnt(node_map, switch_node_cnt);
 	for (i = 0, switch_ptr = switch_record_table; i < switch_record_cnt;
 	     i++, switch_ptr++) {
+		/* Switches without usable nodes are left NULL */
+		if (!switch_node_cnt[i])
+			continue;
 		switch_node_bitmap[i] = bit_copy(switch_ptr->node_bitmap);
 		bit_and(switch_node_bitmap[i], node_map);
-		switch_node_cnt[i] = bit_set_count(switch_node_bitmap[i]);
 		if (req_nodes_bitmap &&
 		    bit_overlap_any(req_nodes_bitmap, switch_node_bitmap[i])) {
 			switch_required[i] = 1;
@@ -2305,7 +2308,7 @@ static int _eval_nodes_topo(job_record_t *job_ptr,
 	 * top level switch.
 	 */
 	for (i = 0; i < switch_record_cnt; i++) {
-		if (top_switch_inx != i) {
+		if ((top_switch_inx != i) && switch_node_bitmap[i]) {
 			  bit_and(switch_node_bitmap[i],
 				  switch_node_bitmap[top_switch_inx]);
 		}
@@ -2444,7 +2447,7 @@ static int _eval_nodes_topo(job_record_t *job_ptr,
 
 		for (i = 0, switch_ptr = switch_record_table;
 		     i < switch_record_cnt; i++, switch_ptr++) {
-			if (switch_required[i])
+			if (switch_required[i] || !switch_node_bitmap[i])
 				continue;
 			if (bit_overlap_any(req2_nodes_bitmap,
 					    switch_node_bitmap[i])) {
@@ -2478,6 +2481,8 @@ static int _eval_nodes_topo(job_record_t *job_ptr,
 	avail_nodes_bitmap = bit_alloc(node_record_count);
 	for (i = 0, switch_ptr = switch_record_table; i < switch_record_cnt;
 	     i++, switch_ptr++) {
+		if (!switch_node_bitmap[i])
+			continue;
 		bit_and(switch_node_bitmap[i], best_nodes_bitmap);
 		bit_or(avail_nodes_bitmap, switch_node_bitmap[i]);
 		switch_node_cnt[i] = bit_set_count(switch_node_bitmap[i]);
@@ -2626,7 +2631,8 @@ fini:
 		/* Count up leaf switches. */
 		for (i = 0, switch_ptr = switch_record_table;
 		     i < switch_record_cnt; i++, switch_ptr++) {
-			if (switch_record_table[i].level != 0)
+			if ((switch_record_table[i].level != 0) ||
+			    !switch_node_bitmap[i])
 				continue;
 			if (bit_overlap_any(switch_node_bitmap[i], node_map))
 				leaf_switch_count++;
@@ -3250,7 +3256,7 @@ extern avail_res_t *can_job_run_on_node(job_record_t *job_ptr,
 	avail_res_t *avail_res = NULL;
 	List sock_gres_list = NULL;
 	bool enforce_binding = false;
-	uint16_t min_cpus_per_node, ntasks_per_node = 1;
+	uint16_t min_cpus_per_node;
 
 	if (((job_ptr->bit_flags & BACKFILL_TEST) == 0) &&
 	    !test_only && !will_run && IS_NODE_COMPLETING(node_ptr)) {
@@ -3311,19 +3317,7 @@ extern avail_res_t *can_job_run_on_node(job_record_t *job_ptr,
 	}
 
 	/* Check that sufficient CPUs remain to run a task on this node */
-	if (job_ptr->details->ntasks_per_node) {
-		ntasks_per_node = job_ptr->details->ntasks_per_node;
-	} else if (job_ptr->details->overcommit) {
-		ntasks_per_node = 1;
-	} else if ((job_ptr->details->max_nodes == 1) &&
-		   (job_ptr->details->num_tasks != 0)) {
-		ntasks_per_node = job_ptr->details->num_tasks;
-	} else if (job_ptr->details->max_nodes) {
-		ntasks_per_node = (job_ptr->details->num_tasks +
-				   job_ptr->details->max_nodes - 1) /
-				  job_ptr->details->max_nodes;
-	}
-	min_cpus_per_node = ntasks_per_node * job_ptr->details->cpus_per_task;
+	min_cpus_per_node = common_min_cpus_per_node(job_ptr);
 	if (avail_res->avail_cpus < min_cpus_per_node) {
 #if _DEBUG
 		info("Test fail on node %d: avail_cpus < min_cpus_per_node (%u < %u)",
@@ -38,6 +38,7 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
 \*****************************************************************************/
 
+#include <ctype.h>
 #include <fcntl.h>
 #include <pwd.h>
 #include <stdio.h>
@@ -69,10 +70,12 @@
 #define MAX_WAIT_SLEEP_TIME 32
 
 static void  _add_bb_to_script(char **script_body, char *burst_buffer_file);
+static void  _add_spank_env(job_desc_msg_t *desc);
 static void  _env_merge_filter(job_desc_msg_t *desc);
 static int   _fill_job_desc_from_opts(job_desc_msg_t *desc);
 static void *_get_script_buffer(const char *filename, int *size);
 static int   _job_wait(uint32_t job_id);
+static void  _post_opt_setup(char **script_body, bool spank_post_opt);
 static char *_script_wrap(char *command_string);
 static void  _set_exit_code(void);
 static void  _set_prio_process_env(void);
@@ -80,6 +83,8 @@ static int   _set_rlimit_env(void);
 static void  _set_spank_env(void);
 static void  _set_submit_dir_env(void);
 static int   _set_umask_env(void);
+static void  _spank_post_opt(void);
+static int   _submit_manifest(int argc, char **argv, bool quiet);
 
 int main(int argc, char **argv)
 {
@@ -129,6 +134,14 @@ int main(int argc, char **argv)
 		log_alter(logopt, 0, NULL);
 	}
 
+	if (sbopt.manifest) {
+		if (script_name || sbopt.wrap) {
+			error("--manifest can not be combined with a batch script or --wrap");
+			exit(error_exit);
+		}
+		return _submit_manifest(argc, argv, quiet);
+	}
+
 	if (sbopt.wrap != NULL) {
 		script_body = _script_wrap(sbopt.wrap);
 	} else {
@@ -157,45 +170,7 @@ int main(int argc, char **argv)
 			het_job_fini = true;
 		}
 
-		/*
-		 * Note that this handling here is different than in
-		 * salloc/srun. Instead of sending the file contents as the
-		 * burst_buffer field in job_desc_msg_t, it will be spliced
-		 * in to the job script.
-		 */
-		if (opt.burst_buffer_file) {
-			buf_t *buf = create_mmap_buf(opt.burst_buffer_file);
-			if (!buf) {
-				error("Invalid --bbf specification");
-				exit(error_exit);
-			}
-			_add_bb_to_script(&script_body, get_buf_data(buf));
-			free_buf(buf);
-		}
-
-		if (spank_init_post_opt() < 0) {
-			error("Plugin stack post-option processing failed");
-			exit(error_exit);
-		}
-
-		if (opt.get_user_env_time < 0) {
-			/* Moab doesn't propagate the user's resource limits, so
-			 * slurmd determines the values at the same time that it
-			 * gets the user's default environment variables. */
-			(void) _set_rlimit_env();
-		}
-
-		/*
-		 * if the environment is coming from a file, the
-		 * environment at execution startup, must be unset.
-		 */
-		if (sbopt.export_file != NULL)
-			env_unset_environment();
-
-		_set_prio_process_env();
-		_set_spank_env();
-		_set_submit_dir_env();
-		_set_umask_env();
+		_post_opt_setup(&script_body, true);
 		if (local_env && !job_env_list) {
 			job_env_list = list_create(NULL);
 			list_append(job_env_list, local_env);
@@ -354,6 +329,267 @@ int main(int argc, char **argv)
 	return rc;
 }
 
+/* Run the SPANK plugins' post-option processing */
+static void _spank_post_opt(void)
+{
+	if (spank_init_post_opt() < 0) {
+		error("Plugin stack post-option processing failed");
+		exit(error_exit);
+	}
+}
+
+/*
+ * Apply the processed options of one job (component) to its script body
+ * and to the environment that will be sent with it. spank_post_opt is false
+ * when the caller runs the SPANK post-option processing itself.
+ */
+static void _post_opt_setup(char **script_body, bool spank_post_opt)
+{
+	/*
+	 * Note that this handling here is different than in
+	 * salloc/srun. Instead of sending the file contents as the
+	 * burst_buffer field in job_desc_msg_t, it will be spliced
+	 * in to the job script.
+	 */
+	if (opt.burst_buffer_file) {
+		buf_t *buf = create_mmap_buf(opt.burst_buffer_file);
+		if (!buf) {
+			error("Invalid --bbf specification");
+			exit(error_exit);
+		}
+		_add_bb_to_script(script_body, get_buf_data(buf));
+		free_buf(buf);
+	}
+
+	if (spank_post_opt)
+		_spank_post_opt();
+
+	if (opt.get_user_env_time < 0) {
+		/* Moab doesn't propagate the user's resource limits, so
+		 * slurmd determines the values at the same time that it
+		 * gets the user's default environment variables. */
+		(void) _set_rlimit_env();
+	}
+
+	/*
+	 * if the environment is coming from a file, the
+	 * environment at execution startup, must be unset.
+	 */
+	if (sbopt.export_file != NULL)
+		env_unset_environment();
+
+	_set_prio_process_env();
+	_set_spank_env();
+	_set_submit_dir_env();
+	_set_umask_env();
+}
+
+/*
+ * Build one job request for each line of the --manifest file and submit
+ * them all with a single RPC. Each line holds a batch script path followed
+ * by its arguments. Blank lines and lines starting with '#' are ignored.
+ * Command line options apply to every job and override the options in
+ * each script.
+ * RET SLURM_SUCCESS if every job was accepted, otherwise error_exit
+ */
+static int _submit_manifest(int argc, char **argv, bool quiet)
+{
+	buf_t *buf;
+	char *manifest, *line, *save_ptr = NULL, *arg, *arg_save = NULL;
+	char *script_name, *script_body, *fullpath;
+	int i, argc_off, script_size, retries = 0, rc = SLURM_SUCCESS;
+	bool more_het_comps;
+	job_desc_msg_t *desc;
+	submit_response_msg_t *resp;
+	List job_req_list, name_list, resp_list = NULL;
+	ListIterator desc_iter, name_iter, resp_iter;
+
+	for (i = 1; i < argc; i++) {
+		if (!xstrcmp(argv[i], ":")) {
+			error("Heterogeneous jobs are not supported with --manifest");
+			return error_exit;
+		}
+	}
+
+	if (!(buf = create_mmap_buf(sbopt.manifest))) {
+		error("Unable to read manifest file %s: %m", sbopt.manifest);
+		return error_exit;
+	}
+	manifest = xstrndup(get_buf_data(buf), size_buf(buf));
+	free_buf(buf);
+
+	job_req_list = list_create((ListDelF) slurm_free_job_desc_msg);
+	name_list = list_create(xfree_ptr);
+	for (line = strtok_r(manifest, "\n", &save_ptr); line;
+	     line = strtok_r(NULL, "\n", &save_ptr)) {
+		while (isspace((int) line[0]))
+			line++;
+		if ((line[0] == '\0') || (line[0] == '#'))
+			continue;
+
+		/* Start every job from the command line options alone */
+		(void) process_options_first_pass(argc, argv);
+		for (i = 0; i < sbopt.script_argc; i++)
+			xfree(sbopt.script_argv[i]);
+		xfree(sbopt.script_argv);
+		sbopt.script_argc = 0;
+		for (arg = strtok_r(line, " \t\r", &arg_save); arg;
+		     arg = strtok_r(NULL, " \t\r", &arg_save)) {
+			xrealloc(sbopt.script_argv,
+				 sizeof(char *) * (sbopt.script_argc + 2));
+			sbopt.script_argv[sbopt.script_argc++] = xstrdup(arg);
+		}
+		if ((fullpath = search_path(opt.chdir, sbopt.script_argv[0],
+					    false, R_OK, false))) {
+			xfree(sbopt.script_argv[0]);
+			sbopt.script_argv[0] = fullpath;
+		}
+		script_name = sbopt.script_argv[0];
+
+		if (!(script_body = _get_script_buffer(script_name,
+						       &script_size)))
+			exit(error_exit);
+
+		init_envs(&het_job_env);
+		more_het_comps = false;
+		process_options_second_pass(argc, argv, &argc_off, 0,
+					    &more_het_comps,
+					    xbasename(script_name),
+					    script_body, script_size);
+		if (more_het_comps) {
+			error("%s: Heterogeneous jobs are not supported with --manifest",
+			      script_name);
+			exit(error_exit);
+		}
+		if (sbopt.test_only || sbopt.wait || opt.clusters) {
+			error("--clusters, --test-only and --wait are not supported with --manifest");
+			exit(error_exit);
+		}
+
+		_post_opt_setup(&script_body, false);
+
+		desc = xmalloc(sizeof(job_desc_msg_t));
+		slurm_init_job_desc_msg(desc);
+		if (_fill_job_desc_from_opts(desc) == -1)
+			exit(error_exit);
+		set_env_from_opts(&opt, &desc->environment, -1);
+		set_envs(&desc->environment, &het_job_env, -1);
+		desc->env_size = envcount(desc->environment);
+		desc->script = script_body;
+		list_append(job_req_list, desc);
+		list_append(name_list, xstrdup(script_name));
+	}
+	xfree(manifest);
+
+	if (!list_count(job_req_list)) {
+		error("No batch scripts found in manifest file %s",
+		      sbopt.manifest);
+		exit(error_exit);
+	}
+
+	/*
+	 * SPANK plugins expect post-option processing once per process, so it
+	 * runs after every job is parsed and what it sets goes to all of them
+	 */
+	_spank_post_opt();
+	_set_spank_env();
+	desc_iter = list_iterator_create(job_req_list);
+	while ((desc = list_next(desc_iter)))
+		_add_spank_env(desc);
+	list_iterator_destroy(desc_iter);
+
+	while (true) {
+		static char *msg;
+		rc = slurm_submit_batch_jobs(job_req_list, &resp_list);
+		if (rc >= 0)
+			break;
+		if (errno == ESLURM_ERROR_ON_DESC_TO_RECORD_COPY) {
+			msg = "Slurm job queue full, sleeping and retrying";
+		} else if (errno == ESLURM_NODES_BUSY) {
+			msg = "Job creation temporarily disabled, retrying";
+		} else if (errno == EAGAIN) {
+			msg = "Slurm temporarily unable to accept job, "
+			      "sleeping and retrying";
+		} else
+			msg = NULL;
+		if ((msg == NULL) || (retries >= MAX_RETRIES))
+			break;
+
+		if (retries)
+			debug("%s", msg);
+		else if (errno == ESLURM_NODES_BUSY)
+			info("%s", msg); /* Not an error, powering up nodes */
+		else
+			error("%s", msg);
+		sleep(++retries);
+	}
+
+	if ((rc < 0) && (errno != ESLURM_NOT_SUPPORTED)) {
+		/*
+		 * Some of the jobs may have been created before the error, so
+		 * submitting them again could run them twice
+		 */
+		error("Batch job list submission failed: %m");
+		exit(error_exit);
+	} else if ((rc >= 0) &&
+		   (!resp_list ||
+		    (list_count(resp_list) != list_count(job_req_list)))) {
+		error("Batch job list submission failed: %s",
+		      slurm_strerror(SLURM_UNEXPECTED_MSG_ERROR));
+		exit(error_exit);
+	} else if (rc < 0) {
+		/* Controllers which refuse the list get the jobs one at a time */
+		debug("Batch job list submission not supported, submitting jobs individually");
+		FREE_NULL_LIST(resp_list);
+		resp_list = list_create((ListDelF)
+					slurm_free_submit_response_response_msg);
+		desc_iter = list_iterator_create(job_req_list);
+		while ((desc = list_next(desc_iter))) {
+			resp = NULL;
+			if ((slurm_submit_batch_job(desc, &resp) < 0) ||
+			    !resp) {
+				resp = xmalloc(sizeof(*resp));
+				resp->error_code = errno ? errno : SLURM_ERROR;
+			}
+			list_append(resp_list, resp);
+		}
+		list_iterator_destroy(desc_iter);
+	}
+
+	rc = SLURM_SUCCESS;
+	name_iter = list_iterator_create(name_list);
+	resp_iter = list_iterator_create(resp_list);
+	while ((script_name = list_next(name_iter)) &&
+	       (resp = list_next(resp_iter))) {
+		if (!resp->job_id) {
+			print_multi_line_string(resp->job_submit_user_msg, -1,
+						LOG_LEVEL_ERROR);
+			error("%s: Batch job submission failed: %s",
+			      script_name, slurm_strerror(resp->error_code));
+			rc = error_exit;
+			continue;
+		}
+
+		print_multi_line_string(resp->job_submit_user_msg, -1,
+					LOG_LEVEL_INFO);
+		cli_filter_g_post_submit(0, resp->job_id, NO_VAL);
+		if (quiet)
+			continue;
+		if (!sbopt.parsable)
+			printf("Submitted batch job %u\n", resp->job_id);
+		else
+			printf("%u\n", resp->job_id);
+	}
+	list_iterator_destroy(resp_iter);
+	list_iterator_destroy(name_iter);
+
+	FREE_NULL_LIST(resp_list);
+	FREE_NULL_LIST(name_list);
+	FREE_NULL_LIST(job_req_list);
+
+	return rc;
+}
+
 /* Insert the contents of "burst_buffer_file" into "script_body" */
 static void  _add_bb_to_script(char **script_body, char *burst_buffer_file)
 {
@@ -576,7 +812,7 @@ static int _fill_job_desc_from_opts(job_desc_msg_t *desc)
 	if (opt.account)
 		desc->account = xstrdup(opt.account);
 	if (opt.burst_buffer)
-		desc->burst_buffer = opt.burst_buffer;
+		desc->burst_buffer = xstrdup(opt.burst_buffer);
 	if (opt.comment)
 		desc->comment = xstrdup(opt.comment);
 	if (opt.qos)
@@ -757,6 +993,41 @@ static void _set_exit_code(void)
 }
 
 /* Propagate SPANK environment via SLURM_SPANK_ environment variables */
+/*
+ * Copy the job environment set by the SPANK plugins into a job request
+ * built before the plugins' post-option processing ran
+ */
+static void _add_spank_env(job_desc_msg_t *desc)
+{
+	extern char **environ;
+	char **env, *name, *value;
+	int i;
+
+	for (i = 0; i < desc->spank_job_env_size; i++)
+		xfree(desc->spank_job_env[i]);
+	xfree(desc->spank_job_env);
+	desc->spank_job_env_size = opt.spank_job_env_size;
+	if (opt.spank_job_env_size) {
+		desc->spank_job_env =
+			xmalloc(sizeof(char *) * opt.spank_job_env_size);
+		for (i = 0; i < opt.spank_job_env_size; i++)
+			desc->spank_job_env[i] = xstrdup(opt.spank_job_env[i]);
+	}
+
+	for (env = environ; env && *env; env++) {
+		if (xstrncmp(*env, "SLURM_SPANK_", 12) &&
+		    xstrncmp(*env, SPANK_OPTION_ENV_PREFIX,
+			     strlen(SPANK_OPTION_ENV_PREFIX)))
+			continue;
+		if (!(value = strchr(*env, '=')))
+			continue;
+		name = xstrndup(*env, value - *env);
+		env_array_overwrite(&desc->environment, name, value + 1);
+		xfree(name);
+	}
+	desc->env_size = envcount(desc->environment);
+}
+
 static void _set_spank_env(void)
 {
 	int i;
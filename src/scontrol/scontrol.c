@@ -1758,7 +1758,12 @@ static void _update_it(int argc, char **argv)
 					MAX(tag_len, 3))) {
 			part_tag = 1;
 		} else if (!xstrncasecmp(tag, "JobId", MAX(tag_len, 3)) ||
-			   !xstrncasecmp(tag, "JobNAME", MAX(tag_len, 3))) {
+			   !xstrncasecmp(tag, "JobNAME", MAX(tag_len, 3)) ||
+			   !xstrncasecmp(tag, "JobPartition", MAX(tag_len, 4)) ||
+			   !xstrncasecmp(tag, "JobState", MAX(tag_len, 4)) ||
+			   /* Full name, reservations have a Users tag */
+			   ((tag_len == 6) &&
+			    !xstrncasecmp(tag, "UserID", 6))) {
 			job_tag = 1;
 		} else if (!xstrncasecmp(tag, "StepId", MAX(tag_len, 4))) {
 			step_tag = 1;
@@ -54,7 +54,11 @@ static bool	_is_job_id(char *job_str);
 static bool	_is_single_job(char *job_id_str);
 static char *	_job_name2id(char *job_name, uint32_t job_uid);
 static char *	_next_job_id(void);
+static int	_print_job_array_resp(job_array_resp_msg_t *resp);
 static void	_update_job_size(uint32_t job_id);
+static int	_update_job_filter(job_desc_msg_t *job_msg, uint32_t user_id,
+				   char *partition, uint32_t state);
+static int	_update_job_ids(job_desc_msg_t *job_msg);
 
 /* Local variables for managing job IDs */
 static char *local_job_str = NULL;
@@ -204,6 +208,142 @@ fini:	xfree(local_job_str);
 	return NULL;
 }
 
+/* Report failures from a job update response, RET highest error code */
+static int _print_job_array_resp(job_array_resp_msg_t *resp)
+{
+	int i, rc = SLURM_SUCCESS;
+
+	for (i = 0; i < resp->job_array_count; i++) {
+		if (resp->error_code[i] == SLURM_SUCCESS)
+			continue;
+		rc = MAX(rc, resp->error_code[i]);
+		exit_code = 1;
+		if (quiet_flag == 1)
+			continue;
+		fprintf(stderr, "%s: %s\n", resp->job_array_id[i],
+			slurm_strerror(resp->error_code[i]));
+	}
+
+	return rc;
+}
+
+/*
+ * Apply job_msg to every job ID returned by _next_job_id(). Several job IDs
+ * are updated with a single RPC, falling back to one RPC per job ID only if
+ * the controller refuses the list. Any other failure is reported, since the
+ * update may already have been applied (e.g. a lost reply) and relative
+ * changes such as TimeLimit=+N must not be made twice.
+ * RET 0 if no slurm error, errno otherwise
+ */
+static int _update_job_ids(job_desc_msg_t *job_msg)
+{
+	List job_id_list = list_create(xfree_ptr);
+	ListIterator iter;
+	job_update_list_msg_t req;
+	job_array_resp_msg_t *resp = NULL;
+	char *job_id_str;
+	int i, rc = SLURM_SUCCESS, rc2;
+
+	while ((job_id_str = _next_job_id()))
+		list_append(job_id_list, xstrdup(job_id_str));
+
+	if (list_count(job_id_list) > 1) {
+		memset(&req, 0, sizeof(req));
+		req.job_desc = job_msg;
+		req.job_id_list = job_id_list;
+		req.state = NO_VAL;
+		req.user_id = NO_VAL;
+		job_msg->job_id_str = NULL;
+		if (slurm_update_job_list(&req, &resp) == SLURM_SUCCESS) {
+			if (resp)
+				rc = _print_job_array_resp(resp);
+			slurm_free_job_array_resp(resp);
+			FREE_NULL_LIST(job_id_list);
+			return rc;
+		}
+		rc = slurm_get_errno();
+		if (rc != ESLURM_NOT_SUPPORTED) {
+			exit_code = 1;
+			if (quiet_flag != 1)
+				fprintf(stderr, "Job list update failed: %s\n",
+					slurm_strerror(rc));
+			FREE_NULL_LIST(job_id_list);
+			return rc;
+		}
+		debug("Job list update not supported, updating jobs one at a time");
+		rc = SLURM_SUCCESS;
+	}
+
+	iter = list_iterator_create(job_id_list);
+	while ((job_msg->job_id_str = list_next(iter))) {
+		rc2 = slurm_update_job2(job_msg, &resp);
+		if (rc2 != SLURM_SUCCESS) {
+			rc2 = slurm_get_errno();
+			rc = MAX(rc, rc2);
+			exit_code = 1;
+			if (quiet_flag != 1) {
+				fprintf(stderr, "%s for job %s\n",
+					slurm_strerror(rc2),
+					job_msg->job_id_str);
+			}
+		} else if (resp) {
+			for (i = 0; i < resp->job_array_count; i++) {
+				if ((resp->error_code[i] == SLURM_SUCCESS) &&
+				    (resp->job_array_count == 1))
+					continue;
+				exit_code = 1;
+				if (quiet_flag == 1)
+					continue;
+				fprintf(stderr, "%s: %s\n",
+					resp->job_array_id[i],
+					slurm_strerror(resp->error_code[i]));
+			}
+			slurm_free_job_array_resp(resp);
+			resp = NULL;
+		}
+	}
+	list_iterator_destroy(iter);
+	job_msg->job_id_str = NULL;
+	FREE_NULL_LIST(job_id_list);
+
+	return rc;
+}
+
+/*
+ * Apply job_msg to every job of the given user, partition and state with a
+ * single RPC. Filters not used are NO_VAL or NULL.
+ * RET 0 if no slurm error, errno otherwise
+ */
+static int _update_job_filter(job_desc_msg_t *job_msg, uint32_t user_id,
+			      char *partition, uint32_t state)
+{
+	job_update_list_msg_t req;
+	job_array_resp_msg_t *resp = NULL;
+	int rc = SLURM_SUCCESS;
+
+	memset(&req, 0, sizeof(req));
+	req.job_desc = job_msg;
+	req.partition = partition;
+	req.state = state;
+	req.user_id = user_id;
+	if (slurm_update_job_list(&req, &resp) != SLURM_SUCCESS) {
+		rc = slurm_get_errno();
+		exit_code = 1;
+		if (quiet_flag != 1)
+			fprintf(stderr, "Job list update failed: %s\n",
+				slurm_strerror(rc));
+		return rc;
+	}
+	if (resp) {
+		if (!resp->job_array_count && (quiet_flag != 1))
+			fprintf(stderr, "No matching jobs\n");
+		rc = _print_job_array_resp(resp);
+		slurm_free_job_array_resp(resp);
+	}
+
+	return rc;
+}
+
 /*
  * scontrol_hold - perform some job hold/release operation
  * IN op	- hold/release operation
@@ -242,35 +382,7 @@ scontrol_hold(char *op, char *job_str)
 		job_msg.priority = INFINITE;
 
 	if (_is_job_id(job_str)) {
-		while ((job_msg.job_id_str = _next_job_id())) {
-			rc2 = slurm_update_job2(&job_msg, &resp);
-			if (rc2 != SLURM_SUCCESS) {
-				rc2 = slurm_get_errno();
-				rc = MAX(rc, rc2);
-				exit_code = 1;
-				if (quiet_flag != 1) {
-					fprintf(stderr, "%s for job %s\n",
-						slurm_strerror(rc2),
-						job_msg.job_id_str);
-				}
-			} else if (resp) {
-				for (i = 0; i < resp->job_array_count; i++) {
-					if ((resp->error_code[i]==SLURM_SUCCESS)
-					    && (resp->job_array_count == 1))
-						continue;
-					exit_code = 1;
-					if (quiet_flag == 1)
-						continue;
-					fprintf(stderr, "%s: %s\n",
-						resp->job_array_id[i],
-						slurm_strerror(resp->
-							       error_code[i]));
-				}
-				slurm_free_job_array_resp(resp);
-				resp = NULL;
-			}
-		}
-		return rc;
+		return _update_job_ids(&job_msg);
 	} else if (job_str) {
 		if (!xstrncasecmp(job_str, "Name=", 5)) {
 			job_str += 5;
@@ -576,7 +688,8 @@ extern int scontrol_update_job(int argc, char **argv)
 	int taglen, vallen;
 	job_desc_msg_t job_msg;
 	job_array_resp_msg_t *resp = NULL;
-	uint32_t job_uid = NO_VAL;
+	uint32_t job_uid = NO_VAL, job_state = NO_VAL;
+	char *job_part = NULL;
 
 	slurm_init_job_desc_msg (&job_msg);
 	for (i = 0; i < argc; i++) {
@@ -618,6 +731,18 @@ extern int scontrol_update_job(int argc, char **argv)
 		if (xstrncasecmp(tag, "JobId", MAX(taglen, 3)) == 0) {
 			job_msg.job_id_str = val;
 		}
+		else if (!xstrncasecmp(tag, "JobPartition", MAX(taglen, 4))) {
+			job_part = val;
+		}
+		else if (!xstrncasecmp(tag, "JobState", MAX(taglen, 4))) {
+			job_state = job_state_num(val);
+			if (job_state >= JOB_END) {
+				exit_code = 1;
+				fprintf (stderr, "Invalid JobState: %s\n", val);
+				fprintf (stderr, "Request aborted\n");
+				return 0;
+			}
+		}
 		else if (xstrncasecmp(tag, "AdminComment",
 				      MAX(taglen, 6)) == 0) {
 			if (add_info) {
@@ -1149,6 +1274,24 @@ extern int scontrol_update_job(int argc, char **argv)
 	if (euid != NO_VAL)
 		job_msg.user_id = euid;
 
+	if (job_part || (job_state != NO_VAL)) {
+		if (job_msg.job_id_str || job_msg.name) {
+			error("JobPartition and JobState can not be combined with JobId or JobName");
+			exit_code = 1;
+			return 0;
+		}
+	}
+	if (!job_msg.job_id_str && !job_msg.name &&
+	    (job_part || (job_state != NO_VAL) || (job_uid != NO_VAL))) {
+		if (update_size) {
+			error("NumNodes can only be updated for a single job ID");
+			exit_code = 1;
+			return 0;
+		}
+		return _update_job_filter(&job_msg, job_uid, job_part,
+					  job_state);
+	}
+
 	if (!job_msg.job_id_str && job_msg.name) {
 		/* Translate name to job ID string */
 		job_msg.job_id_str = _job_name2id(job_msg.name, job_uid);
@@ -1169,7 +1312,9 @@ extern int scontrol_update_job(int argc, char **argv)
 		return 0;
 	}
 
-	if (_is_job_id(job_msg.job_id_str)) {
+	if (_is_job_id(job_msg.job_id_str) && !update_size) {
+		rc = _update_job_ids(&job_msg);
+	} else if (_is_job_id(job_msg.job_id_str)) {
 		job_msg.job_id_str = _next_job_id();
 		while (job_msg.job_id_str) {
 			rc2 = slurm_update_job2(&job_msg, &resp);
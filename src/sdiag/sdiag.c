@@ -59,6 +59,9 @@ stats_info_response_msg_t *buf;
 uint32_t *rpc_type_ave_time = NULL, *rpc_user_ave_time = NULL;
 
 static int  _print_stats(void);
+static void _print_user_cost(void);
+static void _print_sched_phases(void);
+static void _print_lock_sites(void);
 static void _sort_rpc(void);
 
 stats_info_request_msg_t req;
@@ -203,6 +206,17 @@ static int _print_stats(void)
 		       rpc_num2string(buf->rpc_type_id[i]),
 		       buf->rpc_type_id[i], buf->rpc_type_cnt[i],
 		       rpc_type_ave_time[i], buf->rpc_type_time[i]);
+		if (buf->rpc_type_time_p50) {
+			printf("\t\tp50:%-8"PRIu64" p99:%-8"PRIu64" "
+			       "max:%-8"PRIu64" lock_wait:%-10"PRIu64" "
+			       "bytes_in:%-10"PRIu64" bytes_out:%"PRIu64"\n",
+			       buf->rpc_type_time_p50[i],
+			       buf->rpc_type_time_p99[i],
+			       buf->rpc_type_time_max[i],
+			       buf->rpc_type_lock_wait[i],
+			       buf->rpc_type_bytes_in[i],
+			       buf->rpc_type_bytes_out[i]);
+		}
 	}
 
 	printf("\nRemote Procedure Call statistics by user\n");
@@ -219,6 +233,8 @@ static int _print_stats(void)
 		xfree(user);
 	}
 
+	_print_user_cost();
+
 	printf("\nPending RPC statistics\n");
 	if (buf->rpc_queue_type_count == 0)
 		printf("\tNo pending RPCs\n");
@@ -240,56 +256,212 @@ static int _print_stats(void)
 		       buf->rpc_dump_hostlist[i]);
 	}
 
+	_print_sched_phases();
+	_print_lock_sites();
+
 	return 0;
 }
 
+/* Print the rolling per user cost ledger, users idle in the window skipped */
+static void _print_user_cost(void)
+{
+	uint32_t i;
+
+	if (!buf->rpc_user_recent_cnt)
+		return;
+
+	printf("\nRemote Procedure Call cost by user over the last %u seconds\n",
+	       buf->rpc_user_window);
+	for (i = 0; i < buf->rpc_user_size; i++) {
+		char *user;
+
+		if (!buf->rpc_user_recent_cnt[i] &&
+		    !buf->rpc_user_recent_limited[i])
+			continue;
+		if (!(user = uid_to_string_or_null(buf->rpc_user_id[i])))
+			xstrfmtcat(user, "%u", buf->rpc_user_id[i]);
+
+		printf("\t%-16s(%8u) count:%-6u total_time:%-10"PRIu64" "
+		       "lock_wait:%-10"PRIu64" bytes:%-10"PRIu64" "
+		       "rate_limited:%u\n",
+		       user, buf->rpc_user_id[i], buf->rpc_user_recent_cnt[i],
+		       buf->rpc_user_recent_time[i],
+		       buf->rpc_user_recent_lock_wait[i],
+		       buf->rpc_user_recent_bytes[i],
+		       buf->rpc_user_recent_limited[i]);
+
+		xfree(user);
+	}
+}
+
+/* Format a histogram bucket bound given in usec */
+static void _usec_str(uint64_t usec, char *str, int len)
+{
+	if (usec >= USEC_IN_SEC)
+		snprintf(str, len, "%"PRIu64"s", usec / USEC_IN_SEC);
+	else if (usec >= 1000)
+		snprintf(str, len, "%"PRIu64"ms", usec / 1000);
+	else
+		snprintf(str, len, "%"PRIu64"us", usec);
+}
+
+/* Print one histogram line using the bucket bounds sent by slurmctld */
+static void _print_hist(char *label, uint32_t *hist)
+{
+	uint32_t j, hist_size = buf->sched_phase_hist_size;
+	char bound[16];
+
+	printf("\t\t%s", label);
+	for (j = 0; j < hist_size; j++) {
+		if (j < (hist_size - 1)) {
+			_usec_str(buf->sched_phase_hist_limit[j],
+				  bound, sizeof(bound));
+			printf(" <%s:%u", bound, hist[j]);
+		} else if (j) {
+			_usec_str(buf->sched_phase_hist_limit[j - 1],
+				  bound, sizeof(bound));
+			printf(" >=%s:%u", bound, hist[j]);
+		}
+	}
+	printf("\n");
+}
+
+static void _print_sched_phases(void)
+{
+	uint32_t i, hist_size = buf->sched_phase_hist_size;
+
+	if (!buf->sched_phase_count)
+		return;
+
+	printf("\nScheduler phase statistics (microseconds)\n");
+	for (i = 0; i < buf->sched_phase_count; i++) {
+		printf("\t%-28s count:%-8u ave_time:%-8"PRIu64" "
+		       "max_time:%-8"PRIu64" total_time:%"PRIu64"\n",
+		       buf->sched_phase_name[i], buf->sched_phase_cnt[i],
+		       buf->sched_phase_cnt[i] ?
+		       (buf->sched_phase_time[i] / buf->sched_phase_cnt[i]) : 0,
+		       buf->sched_phase_time_max[i], buf->sched_phase_time[i]);
+
+		_print_hist("time:", &buf->sched_phase_hist[i * hist_size]);
+	}
+}
+
+static void _print_lock_sites(void)
+{
+	uint32_t i, hist_size = buf->sched_phase_hist_size;
+	uint32_t cnt;
+
+	if (buf->lock_holder_count)
+		printf("\nCurrent lock holders\n");
+	for (i = 0; i < buf->lock_holder_count; i++)
+		printf("\t%s\n", buf->lock_holder[i]);
+
+	if (!buf->lock_site_count)
+		return;
+
+	printf("\nLock statistics by calling function (microseconds)\n");
+	for (i = 0; i < buf->lock_site_count; i++) {
+		cnt = buf->lock_site_cnt[i];
+		printf("\t%-44s count:%-8u wait_ave:%-8"PRIu64" "
+		       "wait_max:%-8"PRIu64" hold_ave:%-8"PRIu64" "
+		       "hold_max:%"PRIu64"\n",
+		       buf->lock_site_name[i], cnt,
+		       cnt ? (buf->lock_site_wait_time[i] / cnt) : 0,
+		       buf->lock_site_wait_max[i],
+		       cnt ? (buf->lock_site_hold_time[i] / cnt) : 0,
+		       buf->lock_site_hold_max[i]);
+		_print_hist("wait:", &buf->lock_site_wait_hist[i * hist_size]);
+		_print_hist("hold:", &buf->lock_site_hold_hist[i * hist_size]);
+	}
+}
+
+static void _swap32(uint32_t *array, int i, int j)
+{
+	uint32_t tmp;
+
+	if (!array)
+		return;
+	tmp = array[i];
+	array[i] = array[j];
+	array[j] = tmp;
+}
+
+static void _swap64(uint64_t *array, int i, int j)
+{
+	uint64_t tmp;
+
+	if (!array)
+		return;
+	tmp = array[i];
+	array[i] = array[j];
+	array[j] = tmp;
+}
+
+/* Exchange entries i and j of every per message type array */
+static void _swap_rpc_type(int i, int j)
+{
+	uint16_t type_id = buf->rpc_type_id[i];
+
+	buf->rpc_type_id[i] = buf->rpc_type_id[j];
+	buf->rpc_type_id[j] = type_id;
+	_swap32(rpc_type_ave_time, i, j);
+	_swap32(buf->rpc_type_cnt, i, j);
+	_swap64(buf->rpc_type_time, i, j);
+	_swap64(buf->rpc_type_time_p50, i, j);
+	_swap64(buf->rpc_type_time_p99, i, j);
+	_swap64(buf->rpc_type_time_max, i, j);
+	_swap64(buf->rpc_type_lock_wait, i, j);
+	_swap64(buf->rpc_type_bytes_in, i, j);
+	_swap64(buf->rpc_type_bytes_out, i, j);
+}
+
+/* Exchange entries i and j of every per user array */
+static void _swap_rpc_user(int i, int j)
+{
+	_swap32(rpc_user_ave_time, i, j);
+	_swap32(buf->rpc_user_id, i, j);
+	_swap32(buf->rpc_user_cnt, i, j);
+	_swap64(buf->rpc_user_time, i, j);
+	_swap32(buf->rpc_user_recent_cnt, i, j);
+	_swap64(buf->rpc_user_recent_time, i, j);
+	_swap64(buf->rpc_user_recent_lock_wait, i, j);
+	_swap64(buf->rpc_user_recent_bytes, i, j);
+	_swap32(buf->rpc_user_recent_limited, i, j);
+}
+
 static void _sort_rpc(void)
 {
 	int i, j;
-	uint16_t type_id;
-	uint32_t type_ave, type_cnt, user_ave, user_cnt, user_id;
-	uint64_t type_time, user_time;
 
 	rpc_type_ave_time = xmalloc(sizeof(uint32_t) * buf->rpc_type_size);
 	rpc_user_ave_time = xmalloc(sizeof(uint32_t) * buf->rpc_user_size);
 
+	for (i = 0; i < buf->rpc_type_size; i++) {
+		if (buf->rpc_type_cnt[i]) {
+			rpc_type_ave_time[i] = buf->rpc_type_time[i] /
+					       buf->rpc_type_cnt[i];
+		}
+	}
+	for (i = 0; i < buf->rpc_user_size; i++) {
+		if (buf->rpc_user_cnt[i]) {
+			rpc_user_ave_time[i] = buf->rpc_user_time[i] /
+					       buf->rpc_user_cnt[i];
+		}
+	}
+
 	if (params.sort == SORT_ID) {
 		for (i = 0; i < buf->rpc_type_size; i++) {
 			for (j = i+1; j < buf->rpc_type_size; j++) {
 				if (buf->rpc_type_id[i] <= buf->rpc_type_id[j])
 					continue;
-				type_id   = buf->rpc_type_id[i];
-				type_cnt  = buf->rpc_type_cnt[i];
-				type_time = buf->rpc_type_time[i];
-				buf->rpc_type_id[i]   = buf->rpc_type_id[j];
-				buf->rpc_type_cnt[i]  = buf->rpc_type_cnt[j];
-				buf->rpc_type_time[i] = buf->rpc_type_time[j];
-				buf->rpc_type_id[j]   = type_id;
-				buf->rpc_type_cnt[j]  = type_cnt;
-				buf->rpc_type_time[j] = type_time;
-			}
-			if (buf->rpc_type_cnt[i]) {
-				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
-						       buf->rpc_type_cnt[i];
+				_swap_rpc_type(i, j);
 			}
 		}
 		for (i = 0; i < buf->rpc_user_size; i++) {
 			for (j = i+1; j < buf->rpc_user_size; j++) {
 				if (buf->rpc_user_id[i] <= buf->rpc_user_id[j])
 					continue;
-				user_id   = buf->rpc_user_id[i];
-				user_cnt  = buf->rpc_user_cnt[i];
-				user_time = buf->rpc_user_time[i];
-				buf->rpc_user_id[i]   = buf->rpc_user_id[j];
-				buf->rpc_user_cnt[i]  = buf->rpc_user_cnt[j];
-				buf->rpc_user_time[i] = buf->rpc_user_time[j];
-				buf->rpc_user_id[j]   = user_id;
-				buf->rpc_user_cnt[j]  = user_cnt;
-				buf->rpc_user_time[j] = user_time;
-			}
-			if (buf->rpc_user_cnt[i]) {
-				rpc_user_ave_time[i] = buf->rpc_user_time[i] /
-						       buf->rpc_user_cnt[i];
+				_swap_rpc_user(i, j);
 			}
 		}
 	} else if (params.sort == SORT_TIME) {
@@ -297,87 +469,29 @@ static void _sort_rpc(void)
 			for (j = i+1; j < buf->rpc_type_size; j++) {
 				if (buf->rpc_type_time[i] >= buf->rpc_type_time[j])
 					continue;
-				type_id   = buf->rpc_type_id[i];
-				type_cnt  = buf->rpc_type_cnt[i];
-				type_time = buf->rpc_type_time[i];
-				buf->rpc_type_id[i]   = buf->rpc_type_id[j];
-				buf->rpc_type_cnt[i]  = buf->rpc_type_cnt[j];
-				buf->rpc_type_time[i] = buf->rpc_type_time[j];
-				buf->rpc_type_id[j]   = type_id;
-				buf->rpc_type_cnt[j]  = type_cnt;
-				buf->rpc_type_time[j] = type_time;
-			}
-			if (buf->rpc_type_cnt[i]) {
-				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
-						       buf->rpc_type_cnt[i];
+				_swap_rpc_type(i, j);
 			}
 		}
 		for (i = 0; i < buf->rpc_user_size; i++) {
 			for (j = i+1; j < buf->rpc_user_size; j++) {
 				if (buf->rpc_user_time[i] >= buf->rpc_user_time[j])
 					continue;
-				user_id   = buf->rpc_user_id[i];
-				user_cnt  = buf->rpc_user_cnt[i];
-				user_time = buf->rpc_user_time[i];
-				buf->rpc_user_id[i]   = buf->rpc_user_id[j];
-				buf->rpc_user_cnt[i]  = buf->rpc_user_cnt[j];
-				buf->rpc_user_time[i] = buf->rpc_user_time[j];
-				buf->rpc_user_id[j]   = user_id;
-				buf->rpc_user_cnt[j]  = user_cnt;
-				buf->rpc_user_time[j] = user_time;
-			}
-			if (buf->rpc_user_cnt[i]) {
-				rpc_user_ave_time[i] = buf->rpc_user_time[i] /
-						       buf->rpc_user_cnt[i];
+				_swap_rpc_user(i, j);
 			}
 		}
 	} else if (params.sort == SORT_TIME2) {
-		for (i = 0; i < buf->rpc_type_size; i++) {
-			if (buf->rpc_type_cnt[i]) {
-				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
-						       buf->rpc_type_cnt[i];
-			}
-		}
 		for (i = 0; i < buf->rpc_type_size; i++) {
 			for (j = i+1; j < buf->rpc_type_size; j++) {
 				if (rpc_type_ave_time[i] >= rpc_type_ave_time[j])
 					continue;
-				type_ave  = rpc_type_ave_time[i];
-				type_id   = buf->rpc_type_id[i];
-				type_cnt  = buf->rpc_type_cnt[i];
-				type_time = buf->rpc_type_time[i];
-				rpc_type_ave_time[i]  = rpc_type_ave_time[j];
-				buf->rpc_type_id[i]   = buf->rpc_type_id[j];
-				buf->rpc_type_cnt[i]  = buf->rpc_type_cnt[j];
-				buf->rpc_type_time[i] = buf->rpc_type_time[j];
-				rpc_type_ave_time[j]  = type_ave;
-				buf->rpc_type_id[j]   = type_id;
-				buf->rpc_type_cnt[j]  = type_cnt;
-				buf->rpc_type_time[j] = type_time;
-			}
-		}
-		for (i = 0; i < buf->rpc_user_size; i++) {
-			if (buf->rpc_user_cnt[i]) {
-				rpc_user_ave_time[i] = buf->rpc_user_time[i] /
-						       buf->rpc_user_cnt[i];
+				_swap_rpc_type(i, j);
 			}
 		}
 		for (i = 0; i < buf->rpc_user_size; i++) {
 			for (j = i+1; j < buf->rpc_user_size; j++) {
 				if (rpc_user_ave_time[i] >= rpc_user_ave_time[j])
 					continue;
-				user_ave  = rpc_user_ave_time[i];
-				user_id   = buf->rpc_user_id[i];
-				user_cnt  = buf->rpc_user_cnt[i];
-				user_time = buf->rpc_user_time[i];
-				rpc_user_ave_time[i]  = rpc_user_ave_time[j];
-				buf->rpc_user_id[i]   = buf->rpc_user_id[j];
-				buf->rpc_user_cnt[i]  = buf->rpc_user_cnt[j];
-				buf->rpc_user_time[i] = buf->rpc_user_time[j];
-				rpc_user_ave_time[j]  = user_ave;
-				buf->rpc_user_id[j]   = user_id;
-				buf->rpc_user_cnt[j]  = user_cnt;
-				buf->rpc_user_time[j] = user_time;
+				_swap_rpc_user(i, j);
 			}
 		}
 	} else { /* sort by count */
@@ -385,38 +499,14 @@ static void _sort_rpc(void)
 			for (j = i+1; j < buf->rpc_type_size; j++) {
 				if (buf->rpc_type_cnt[i] >= buf->rpc_type_cnt[j])
 					continue;
-				type_id   = buf->rpc_type_id[i];
-				type_cnt  = buf->rpc_type_cnt[i];
-				type_time = buf->rpc_type_time[i];
-				buf->rpc_type_id[i]   = buf->rpc_type_id[j];
-				buf->rpc_type_cnt[i]  = buf->rpc_type_cnt[j];
-				buf->rpc_type_time[i] = buf->rpc_type_time[j];
-				buf->rpc_type_id[j]   = type_id;
-				buf->rpc_type_cnt[j]  = type_cnt;
-				buf->rpc_type_time[j] = type_time;
-			}
-			if (buf->rpc_type_cnt[i]) {
-				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
-						       buf->rpc_type_cnt[i];
+				_swap_rpc_type(i, j);
 			}
 		}
 		for (i = 0; i < buf->rpc_user_size; i++) {
 			for (j = i+1; j < buf->rpc_user_size; j++) {
 				if (buf->rpc_user_cnt[i] >= buf->rpc_user_cnt[j])
 					continue;
-				user_id   = buf->rpc_user_id[i];
-				user_cnt  = buf->rpc_user_cnt[i];
-				user_time = buf->rpc_user_time[i];
-				buf->rpc_user_id[i]   = buf->rpc_user_id[j];
-				buf->rpc_user_cnt[i]  = buf->rpc_user_cnt[j];
-				buf->rpc_user_time[i] = buf->rpc_user_time[j];
-				buf->rpc_user_id[j]   = user_id;
-				buf->rpc_user_cnt[j]  = user_cnt;
-				buf->rpc_user_time[j] = user_time;
-			}
-			if (buf->rpc_user_cnt[i]) {
-				rpc_user_ave_time[i] = buf->rpc_user_time[i] /
-						       buf->rpc_user_cnt[i];
+				_swap_rpc_user(i, j);
 			}
 		}
 	}
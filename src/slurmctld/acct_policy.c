@@ -3431,8 +3431,8 @@ extern bool acct_policy_job_runnable_state(job_record_t *job_ptr)
  *	association limits prevent the job from ever running (lowered
  *	limits since job submission), then cancel the job.
  */
-extern bool acct_policy_job_runnable_pre_select(job_record_t *job_ptr,
-						bool assoc_mgr_locked)
+static bool _job_runnable_pre_select(job_record_t *job_ptr,
+				     bool assoc_mgr_locked)
 {
 	slurmdb_qos_rec_t *qos_ptr_1, *qos_ptr_2;
 	slurmdb_qos_rec_t qos_rec;
@@ -3657,13 +3657,27 @@ end_it:
 	return rc;
 }
 
+/* acct_policy_job_runnable_pre_select - see _job_runnable_pre_select() */
+extern bool acct_policy_job_runnable_pre_select(job_record_t *job_ptr,
+						bool assoc_mgr_locked)
+{
+	struct timeval tv;
+	bool rc;
+
+	SCHED_PHASE_START(tv);
+	rc = _job_runnable_pre_select(job_ptr, assoc_mgr_locked);
+	SCHED_PHASE_END(tv, SCHED_PHASE_ACCT_POLICY);
+
+	return rc;
+}
+
 /*
  * acct_policy_job_runnable_post_select - After nodes have been
  *	selected for the job verify the counts don't exceed aggregated limits.
  */
-extern bool acct_policy_job_runnable_post_select(job_record_t *job_ptr,
-						 uint64_t *tres_req_cnt,
-						 bool assoc_mgr_locked)
+static bool _job_runnable_post_select(job_record_t *job_ptr,
+				      uint64_t *tres_req_cnt,
+				      bool assoc_mgr_locked)
 {
 	slurmdb_qos_rec_t *qos_ptr_1, *qos_ptr_2;
 	slurmdb_qos_rec_t qos_rec;
@@ -3771,6 +3785,23 @@ extern bool acct_policy_job_runnable_post_select(job_record_t *job_ptr,
 
 	assoc_ptr = job_ptr->assoc_ptr;
 	while (assoc_ptr) {
+		uint16_t tres_unlimited = assoc_ptr->usage->tres_unlimited;
+
+		/*
+		 * Parents only have their group limits checked. Skip any
+		 * association without a TRES limit left to check rather than
+		 * testing every TRES against an INFINITE64 limit.
+		 */
+		if (parent)
+			tres_unlimited |= (ASSOC_TRES_UNLIM_MAX |
+					   ASSOC_TRES_UNLIM_MAX_PN |
+					   ASSOC_TRES_UNLIM_MAX_MINS);
+		if (tres_unlimited == ASSOC_TRES_UNLIM_ALL) {
+			assoc_ptr = assoc_ptr->usage->parent_assoc_ptr;
+			parent = 1;
+			continue;
+		}
+
 		for (i = 0; i < slurmctld_tres_cnt; i++) {
 			tres_usage_mins[i] =
 				(uint64_t)(assoc_ptr->usage->usage_tres_raw[i]
@@ -3866,16 +3897,20 @@ extern bool acct_policy_job_runnable_post_select(job_record_t *job_ptr,
 			break;
 		}
 
-		orig_node_cnt = tres_req_cnt[TRES_ARRAY_NODE];
-		_get_unique_job_node_cnt(job_ptr,
-					 assoc_ptr->usage->grp_node_bitmap,
-					 &tres_req_cnt[TRES_ARRAY_NODE]);
-		tres_usage = _validate_tres_usage_limits_for_assoc(
-			&tres_pos,
-			grp_tres_ctld, qos_rec.grp_tres_ctld,
-			tres_req_cnt, assoc_ptr->usage->grp_used_tres,
-			NULL, job_ptr->limit_set.tres, true);
-		tres_req_cnt[TRES_ARRAY_NODE] = orig_node_cnt;
+		if (tres_unlimited & ASSOC_TRES_UNLIM_GRP) {
+			tres_usage = TRES_USAGE_OKAY;
+		} else {
+			orig_node_cnt = tres_req_cnt[TRES_ARRAY_NODE];
+			_get_unique_job_node_cnt(
+				job_ptr, assoc_ptr->usage->grp_node_bitmap,
+				&tres_req_cnt[TRES_ARRAY_NODE]);
+			tres_usage = _validate_tres_usage_limits_for_assoc(
+				&tres_pos,
+				grp_tres_ctld, qos_rec.grp_tres_ctld,
+				tres_req_cnt, assoc_ptr->usage->grp_used_tres,
+				NULL, job_ptr->limit_set.tres, true);
+			tres_req_cnt[TRES_ARRAY_NODE] = orig_node_cnt;
+		}
 		switch (tres_usage) {
 		case TRES_USAGE_CUR_EXCEEDS_LIMIT:
 			/* not possible because the curr_usage sent in is NULL*/
@@ -4043,6 +4078,22 @@ end_it:
 	return rc;
 }
 
+/* acct_policy_job_runnable_post_select - see _job_runnable_post_select() */
+extern bool acct_policy_job_runnable_post_select(job_record_t *job_ptr,
+						 uint64_t *tres_req_cnt,
+						 bool assoc_mgr_locked)
+{
+	struct timeval tv;
+	bool rc;
+
+	SCHED_PHASE_START(tv);
+	rc = _job_runnable_post_select(job_ptr, tres_req_cnt,
+				       assoc_mgr_locked);
+	SCHED_PHASE_END(tv, SCHED_PHASE_ACCT_POLICY);
+
+	return rc;
+}
+
 extern uint32_t acct_policy_get_max_nodes(job_record_t *job_ptr,
 					  uint32_t *wait_reason)
 {
@@ -202,6 +202,7 @@ static int	daemonize = DEFAULT_DAEMONIZE;
 static int	debug_level = 0;
 static char *	debug_logfile = NULL;
 static bool	dump_core = false;
+static volatile sig_atomic_t dump_lock_trace = 0;
 static int      job_sched_cnt = 0;
 static uint32_t max_server_threads = MAX_SERVER_THREADS;
 static time_t	next_stats_reset = 0;
@@ -233,6 +234,7 @@ static int          _controller_index(void);
 static void         _become_slurm_user(void);
 static void         _create_clustername_file(void);
 static void         _default_sigaction(int sig);
+static void         _dump_lock_trace(void);
 static void         _get_fed_updates();
 static void         _init_config(void);
 static void         _init_pidfile(void);
@@ -767,6 +769,12 @@ int main(int argc, char **argv)
 		slurm_thread_create(&slurmctld_config.thread_id_purge_files,
 				    _purge_files_thread, NULL);
 
+		/*
+		 * create attached thread for writing batch job scripts
+		 */
+		slurm_thread_create(&slurmctld_config.thread_id_script_write,
+				    script_write_thread, NULL);
+
 		/*
 		 * process slurm background activities, could run as pthread
 		 */
@@ -784,10 +792,14 @@ int main(int argc, char **argv)
 		pthread_join(slurmctld_config.thread_id_sig,  NULL);
 		pthread_join(slurmctld_config.thread_id_rpc,  NULL);
 		pthread_join(slurmctld_config.thread_id_save, NULL);
+		/* After the RPC thread, so no more scripts get queued */
+		script_write_fini();
+		pthread_join(slurmctld_config.thread_id_script_write, NULL);
 		slurmctld_config.thread_id_purge_files = (pthread_t) 0;
 		slurmctld_config.thread_id_sig  = (pthread_t) 0;
 		slurmctld_config.thread_id_rpc  = (pthread_t) 0;
 		slurmctld_config.thread_id_save = (pthread_t) 0;
+		slurmctld_config.thread_id_script_write = (pthread_t) 0;
 
 		/* kill all scripts running by the slurmctld */
 		track_script_flush();
@@ -1111,6 +1123,19 @@ static void _default_sigaction(int sig)
 
 static void _sig_handler(int signal)
 {
+	dump_lock_trace = 1;
+}
+
+/* Log lock holders and contention statistics, triggered by SIGUSR1 */
+static void _dump_lock_trace(void)
+{
+	dump_lock_trace = 0;
+	if (slurmctld_config.shutdown_time)
+		return;	/* SIGUSR1 sent to interrupt poll() for shutdown */
+
+	info("Lock trace dump signal (SIGUSR1) received");
+	lock_trace_log(&slurmctld_lock_trace);
+	lock_trace_log(&assoc_mgr_lock_trace);
 }
 
 /*
@@ -1169,7 +1194,8 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	 * This signal is generated by the slurmctld signal
 	 * handler thread upon receipt of SIGABRT, SIGINT,
 	 * or SIGTERM. That thread does all processing of
-	 * all signals.
+	 * all other signals. SIGUSR1 sent to the daemon
+	 * dumps the lock contention statistics to the log.
 	 */
 	xsignal(SIGUSR1, _sig_handler);
 	xsignal_unblock(sigarray);
@@ -1182,8 +1208,13 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 			if (errno != EINTR)
 				error("slurm_accept_msg_conn poll: %m");
 			server_thread_decr();
+			if (dump_lock_trace)
+				_dump_lock_trace();
 			continue;
 		}
+		/* SIGUSR1 may have been caught by an RPC thread instead */
+		if (dump_lock_trace)
+			_dump_lock_trace();
 
 		/* find one to process */
 		for (i = 0; i < nports; i++) {
@@ -1261,6 +1292,11 @@ static void *_service_connection(void *arg)
 		goto cleanup;
 	}
 
+	if (rpc_rate_limit_exceeded(msg)) {
+		slurm_send_rc_msg(msg, SLURMCTLD_COMMUNICATIONS_BACKOFF);
+		goto close_fd;
+	}
+
 	if (rpc_enqueue(msg)) {
 		server_thread_decr();
 		return NULL;
@@ -1269,6 +1305,7 @@ static void *_service_connection(void *arg)
 	/* process the request */
 	slurmctld_req(msg);
 
+close_fd:
 	if ((msg->conn_fd >= 0) && (close(msg->conn_fd) < 0))
 		error("close(%d): %m", msg->conn_fd);
 
@@ -1475,6 +1512,7 @@ static void _remove_qos(slurmdb_qos_rec_t *rec)
 	unlock_slurmctld(part_write_lock);
 
 	bb_g_reconfig();
+	slurm_preempt_cache_clear();
 
 	cnt = job_hold_by_qos_id(rec->id);
 
@@ -1544,6 +1582,9 @@ static void _update_qos(slurmdb_qos_rec_t *rec)
 	slurmctld_lock_t job_write_lock =
 		{ NO_LOCK, WRITE_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
 
+	/* The QOS priority or preemption settings may have changed */
+	slurm_preempt_cache_clear();
+
 	if (!job_list || !accounting_enforce
 	    || !(accounting_enforce & ACCOUNTING_ENFORCE_LIMITS))
 		return;
@@ -95,8 +95,10 @@ static int _handle_job(void *x, void *y)
 	job->bitflags |= CRON_JOB;
 
 	/* give job_submit a chance to play with it first */
-	args->return_code = validate_job_create_req(job, args->uid,
-						    args->err_msg);
+	args->return_code = validate_job_desc_strings(job);
+	if (!args->return_code)
+		args->return_code = validate_job_create_req(job, args->uid,
+							    args->err_msg);
 
 	if (args->return_code) {
 		xstrfmtcat(*args->failed_lines, "%u-%u",
@@ -1687,6 +1687,8 @@ static int _fed_mgr_job_allocate_sib(char *sib_name, job_desc_msg_t *job_desc,
 		error("REQUEST_SUBMIT_BATCH_JOB lacks alloc_node");
 	}
 
+	if (error_code == SLURM_SUCCESS)
+		error_code = validate_job_desc_strings(job_desc);
 	if (error_code == SLURM_SUCCESS)
 		error_code = validate_job_create_req(job_desc,uid,&err_msg);
 
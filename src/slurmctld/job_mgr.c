@@ -43,6 +43,10 @@
 #include "config.h"
 #define _GNU_SOURCE
 
+#if HAVE_SYS_PRCTL_H
+#  include <sys/prctl.h>
+#endif
+
 #include <ctype.h>
 #include <dirent.h>
 #include <errno.h>
@@ -115,6 +119,7 @@
 #define SLURM_CREATE_JOB_FLAG_NO_ALLOCATE_0 0
 #define TOP_PRIORITY 0xffff0000	/* large, but leave headroom for higher */
 #define PURGE_OLD_JOB_IN_SEC 2592000 /* 30 days in seconds */
+#define UPDATE_LIST_LOCK_CHUNK 64	/* job list updates per lock hold */
 
 #define JOB_HASH_INX(_job_id)	(_job_id % hash_table_size)
 #define JOB_ARRAY_HASH_INX(_job_id, _task_id) \
@@ -151,6 +156,29 @@ typedef struct {
 	int rc;
 } job_overlap_args_t;
 
+/* Batch script and environment waiting to be written to StateSaveLocation */
+typedef struct {
+	char *dir_name;
+	uint32_t env_size;
+	char **environment;
+	uint32_t job_id;
+	char *script;
+	uint64_t seq;		/* order in which the write was queued */
+	uint64_t size;		/* bytes of script and environment held */
+} script_write_t;
+
+/*
+ * Batch script write which failed. Split job array tasks share the write of
+ * their meta record, so it is kept until the files of job_id are deleted.
+ */
+typedef struct {
+	uint32_t job_id;	/* job owning the batch directory */
+	uint64_t seq;		/* seq of the failed write */
+} script_write_failed_t;
+
+/* Upper bound on script and environment bytes queued for the writer */
+#define SCRIPT_WRITE_MAX_BYTES (64 * 1024 * 1024)
+
 /* Global variables */
 List   job_list = NULL;		/* job_record list */
 time_t last_job_update;		/* time of last update to job records */
@@ -173,6 +201,17 @@ static time_t   last_file_write_time = (time_t) 0;
 static uint32_t max_array_size = NO_VAL;
 static bitstr_t *requeue_exit = NULL;
 static bitstr_t *requeue_exit_hold = NULL;
+static bool     script_write_async = false;
+static uint64_t script_write_bytes = 0;	/* bytes held by script_write_list */
+static script_write_t *script_write_cur = NULL; /* being written now */
+static uint64_t script_write_done = 0;	/* seq of last completed write */
+static List     script_write_failed = NULL; /* script_write_failed_t */
+static List     script_write_list = NULL; /* script_write_t queue */
+static uint64_t script_write_seq = 0;	/* seq of last queued write */
+static pthread_cond_t  script_write_cond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t script_write_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool     script_write_running = false;
+static bool     script_write_shutdown = false;
 static bool     validate_cfgd_licenses = true;
 
 /* Local functions */
@@ -180,7 +219,7 @@ static void _add_job_hash(job_record_t *job_ptr);
 static void _add_job_array_hash(job_record_t *job_ptr);
 static void _clear_job_gres_details(job_record_t *job_ptr);
 static int  _copy_job_desc_to_file(job_desc_msg_t * job_desc,
-				   uint32_t job_id);
+				   job_record_t *job_ptr);
 static int  _copy_job_desc_to_job_record(job_desc_msg_t * job_desc,
 					 job_record_t **job_ptr,
 					 bitstr_t ** exc_bitmap,
@@ -257,6 +296,11 @@ static int  _validate_job_desc(job_desc_msg_t *job_desc_msg, int allocate,
 			       bool cron, uid_t submit_uid,
 			       part_record_t *part_ptr, List part_list);
 static void _validate_job_files(List batch_dirs);
+static bool _script_write_done(job_record_t *job_ptr, bool *failed);
+static void _cancel_script_write(uint32_t job_id);
+static bool _flush_script_write(job_record_t *job_ptr);
+static buf_t *_get_queued_script(uint32_t job_id);
+static void _wait_script_write(uint32_t job_id);
 static bool _validate_min_mem_partition(job_desc_msg_t *job_desc_msg,
 					part_record_t *part_ptr,
 					List part_list);
@@ -264,6 +308,8 @@ static bool _valid_pn_min_mem(job_desc_msg_t * job_desc_msg,
 			      part_record_t *part_ptr);
 static int  _write_data_array_to_file(char *file_name, char **data,
 				      uint32_t size);
+static int  _write_job_desc_files(char *dir_name, char *script,
+				  char **environment, uint32_t env_size);
 
 static char *_get_mail_user(const char *user_name, uid_t user_id)
 {
@@ -692,6 +738,9 @@ extern void delete_job_desc_files(uint32_t job_id)
 	DIR *f_dir;
 	struct dirent *dir_ent;
 
+	/* Don't let a pending write recreate the files we remove */
+	_cancel_script_write(job_id);
+
 	dir_name = xstrdup_printf("%s/hash.%d/job.%u",
 	                          slurm_conf.state_save_location,
 	                          hash, job_id);
@@ -3918,6 +3967,7 @@ extern void excise_node_from_job(job_record_t *job_ptr,
 	job_ptr->total_nodes = job_ptr->node_cnt = new_pos + 1;
 
 	FREE_NULL_BITMAP(orig_bitmap);
+	slurm_preempt_cache_clear();
 	(void) select_g_job_resized(job_ptr, node_ptr);
 }
 
@@ -4257,6 +4307,8 @@ extern job_record_t *job_array_split(job_record_t *job_ptr)
 	job_ptr_pend->db_flags = 0;
 	job_ptr_pend->step_list = save_step_list;
 	job_ptr_pend->db_index = save_db_index;
+	/* Dependency graph edges reference the old job ID, register anew */
+	job_ptr->depend_test_time = 0;
 
 	job_ptr_pend->prio_factors = save_prio_factors;
 	slurm_copy_priority_factors_object(job_ptr_pend->prio_factors,
@@ -4823,6 +4875,11 @@ extern int job_allocate(job_desc_msg_t * job_specs, int immediate,
 
 		if (xstrcasestr(slurm_conf.sched_params, "allow_zero_lic"))
 			validate_cfgd_licenses = false;
+
+		if (xstrcasestr(slurm_conf.sched_params, "async_script_write"))
+			script_write_async = true;
+		else
+			script_write_async = false;
 	}
 
 	if (job_specs->array_bitmap)
@@ -4856,6 +4913,15 @@ extern int job_allocate(job_desc_msg_t * job_specs, int immediate,
 		return error_code;
 	}
 	xassert(job_ptr);
+	/*
+	 * A job which may start right away has its batch script written now,
+	 * rather than waiting in job_independent() for the script writer.
+	 */
+	if (!job_specs->array_bitmap && !will_run && !defer_sched &&
+	    (job_specs->priority != 0) && job_ptr->details &&
+	    !job_ptr->details->depend_list &&
+	    (job_ptr->details->begin_time <= now))
+		(void) _flush_script_write(job_ptr);
 	if (job_specs->array_bitmap)
 		independent = false;
 	else
@@ -7109,7 +7175,7 @@ static int _job_create(job_desc_msg_t *job_desc, int allocate, int will_run,
 	if (job_desc->script
 	    &&  (!will_run)) {	/* don't bother with copy if just a test */
 		if ((error_code = _copy_job_desc_to_file(job_desc,
-							 job_ptr->job_id))) {
+							 job_ptr))) {
 			error_code = ESLURM_WRITING_TO_FILE;
 			goto cleanup_fail;
 		}
@@ -7331,8 +7397,14 @@ static int _test_job_desc_fields(job_desc_msg_t * job_desc)
 	return SLURM_SUCCESS;
 }
 
-/* Perform some size checks on strings we store to prevent
- * malicious user filling slurmctld's memory
+extern int validate_job_desc_strings(job_desc_msg_t *job_desc)
+{
+	return _test_job_desc_fields(job_desc);
+}
+
+/* Validate a job create request and run the job_submit plugins on it.
+ * The caller must have checked string sizes with validate_job_desc_strings()
+ * first, job_submit_plugin_submit() repeats that if a plugin ran.
  * IN job_desc   - user job submit request
  * IN submit_uid - UID making job submit request
  * OUT err_msg   - custom error message to return
@@ -7372,10 +7444,6 @@ extern int validate_job_create_req(job_desc_msg_t * job_desc, uid_t submit_uid,
 	if (rc != SLURM_SUCCESS)
 		return rc;
 
-	rc = _test_job_desc_fields(job_desc);
-	if (rc != SLURM_SUCCESS)
-		return rc;
-
 	if (!_valid_array_inx(job_desc))
 		return ESLURM_INVALID_ARRAY;
 
@@ -7439,13 +7507,340 @@ extern int validate_job_create_req(job_desc_msg_t * job_desc, uid_t submit_uid,
 	return SLURM_SUCCESS;
 }
 
+static void _script_write_free(void *x)
+{
+	script_write_t *write_ptr = (script_write_t *) x;
+	int i;
+
+	if (!write_ptr)
+		return;
+
+	xfree(write_ptr->dir_name);
+	for (i = 0; i < write_ptr->env_size; i++)
+		xfree(write_ptr->environment[i]);
+	xfree(write_ptr->environment);
+	xfree(write_ptr->script);
+	xfree(write_ptr);
+}
+
+static int _find_script_write(void *x, void *key)
+{
+	script_write_t *write_ptr = (script_write_t *) x;
+	uint32_t *job_id = (uint32_t *) key;
+
+	if (write_ptr->job_id == *job_id)
+		return 1;
+	return 0;
+}
+
+static int _find_script_write_failed(void *x, void *key)
+{
+	script_write_failed_t *failed_ptr = (script_write_failed_t *) x;
+
+	return (failed_ptr->seq == *(uint64_t *) key);
+}
+
+static int _find_script_write_failed_job(void *x, void *key)
+{
+	script_write_failed_t *failed_ptr = (script_write_failed_t *) x;
+
+	return (failed_ptr->job_id == *(uint32_t *) key);
+}
+
+/* Record a failed write. Call with script_write_lock held. */
+static void _add_script_write_failed(uint32_t job_id, uint64_t seq)
+{
+	script_write_failed_t *failed_ptr;
+
+	failed_ptr = xmalloc(sizeof(script_write_failed_t));
+	failed_ptr->job_id = job_id;
+	failed_ptr->seq = seq;
+	list_append(script_write_failed, failed_ptr);
+}
+
+/* Drop queued writes for job_id. Call with script_write_lock held. */
+static int _purge_script_write(void *x, void *key)
+{
+	script_write_t *write_ptr = (script_write_t *) x;
+
+	if (!_find_script_write(x, key))
+		return 0;
+	script_write_bytes -= write_ptr->size;
+	return 1;
+}
+
+/*
+ * Hand the job's batch script and environment to the script writer thread.
+ * RET sequence number of the queued write, or 0 if the files must be written
+ *     by the caller (writer not running or too much data already queued)
+ */
+static uint64_t _queue_script_write(job_desc_msg_t *job_desc, uint32_t job_id,
+				    char *dir_name)
+{
+	script_write_t *write_ptr;
+	uint64_t size, seq;
+	int i;
+
+	size = strlen(job_desc->script) + 1;
+	for (i = 0; i < job_desc->env_size; i++)
+		size += strlen(job_desc->environment[i]) + 1;
+
+	slurm_mutex_lock(&script_write_lock);
+	if (!script_write_running || script_write_shutdown ||
+	    ((script_write_bytes + size) > SCRIPT_WRITE_MAX_BYTES)) {
+		slurm_mutex_unlock(&script_write_lock);
+		return 0;
+	}
+
+	write_ptr = xmalloc(sizeof(script_write_t));
+	write_ptr->dir_name = xstrdup(dir_name);
+	write_ptr->env_size = job_desc->env_size;
+	write_ptr->environment = xcalloc(job_desc->env_size, sizeof(char *));
+	for (i = 0; i < job_desc->env_size; i++)
+		write_ptr->environment[i] = xstrdup(job_desc->environment[i]);
+	write_ptr->job_id = job_id;
+	write_ptr->script = xstrdup(job_desc->script);
+	write_ptr->seq = seq = ++script_write_seq;
+	write_ptr->size = size;
+	script_write_bytes += size;
+
+	list_enqueue(script_write_list, write_ptr);
+	slurm_cond_broadcast(&script_write_cond);
+	slurm_mutex_unlock(&script_write_lock);
+
+	return seq;
+}
+
+/*
+ * Test if the job's queued batch script write has completed, without
+ * waiting for it. Writes complete in the order they are queued.
+ * OUT failed - set if the files could not be written
+ * RET true if job_ptr has no write pending
+ */
+static bool _script_write_done(job_record_t *job_ptr, bool *failed)
+{
+	*failed = false;
+	if (!job_ptr->script_write_seq)
+		return true;
+
+	slurm_mutex_lock(&script_write_lock);
+	if (script_write_failed &&
+	    list_find_first(script_write_failed, _find_script_write_failed,
+			    &job_ptr->script_write_seq)) {
+		*failed = true;
+	} else if (job_ptr->script_write_seq > script_write_done) {
+		slurm_mutex_unlock(&script_write_lock);
+		return false;
+	}
+	slurm_mutex_unlock(&script_write_lock);
+
+	job_ptr->script_write_seq = 0;
+	return true;
+}
+
+/*
+ * Write the job's queued batch script and environment now, or wait for the
+ * writer if it is already writing them, so a job able to start as soon as
+ * it is submitted does not wait for the writer to reach its files.
+ * RET true if job_ptr has no write pending and its files were written
+ */
+static bool _flush_script_write(job_record_t *job_ptr)
+{
+	script_write_t *write_ptr = NULL;
+	uint32_t job_id = job_ptr->job_id;
+	bool failed;
+	int rc;
+
+	if (!job_ptr->script_write_seq)
+		return true;
+
+	slurm_mutex_lock(&script_write_lock);
+	if (script_write_list)
+		write_ptr = list_remove_first(script_write_list,
+					      _purge_script_write, &job_id);
+	if (!write_ptr) {
+		while (script_write_cur && (script_write_cur->job_id == job_id))
+			slurm_cond_wait(&script_write_cond,
+					&script_write_lock);
+		slurm_mutex_unlock(&script_write_lock);
+		return (_script_write_done(job_ptr, &failed) && !failed);
+	}
+	slurm_mutex_unlock(&script_write_lock);
+
+	rc = _write_job_desc_files(write_ptr->dir_name, write_ptr->script,
+				   write_ptr->environment, write_ptr->env_size);
+	if (rc) {
+		/* job_independent() fails the job */
+		slurm_mutex_lock(&script_write_lock);
+		_add_script_write_failed(job_id, write_ptr->seq);
+		slurm_mutex_unlock(&script_write_lock);
+	} else {
+		job_ptr->script_write_seq = 0;
+	}
+	_script_write_free(write_ptr);
+
+	return (rc == 0);
+}
+
+/*
+ * Wait for any queued write of the job's script and environment to finish.
+ * Jobs are not launched before their write completes (see job_independent()),
+ * so this only waits when the files are read some other way right after
+ * submission.
+ */
+static void _wait_script_write(uint32_t job_id)
+{
+	slurm_mutex_lock(&script_write_lock);
+	while ((script_write_cur && (script_write_cur->job_id == job_id)) ||
+	       (script_write_list &&
+		list_find_first(script_write_list, _find_script_write,
+				&job_id)))
+		slurm_cond_wait(&script_write_cond, &script_write_lock);
+	slurm_mutex_unlock(&script_write_lock);
+}
+
+/*
+ * Return a copy of the job's batch script if its write is still pending,
+ * so it can be served without waiting for StateSaveLocation.
+ */
+static buf_t *_get_queued_script(uint32_t job_id)
+{
+	script_write_t *write_ptr = NULL;
+	buf_t *buf = NULL;
+
+	slurm_mutex_lock(&script_write_lock);
+	if (script_write_cur && (script_write_cur->job_id == job_id))
+		write_ptr = script_write_cur;
+	else if (script_write_list)
+		write_ptr = list_find_first(script_write_list,
+					    _find_script_write, &job_id);
+	if (write_ptr)
+		buf = create_buf(xstrdup(write_ptr->script),
+				 strlen(write_ptr->script) + 1);
+	slurm_mutex_unlock(&script_write_lock);
+
+	return buf;
+}
+
+/*
+ * Forget about the job's batch script write. A write not yet started is
+ * dropped, one in progress is waited for so it can't recreate the files.
+ */
+static void _cancel_script_write(uint32_t job_id)
+{
+	slurm_mutex_lock(&script_write_lock);
+	if (script_write_list)
+		list_delete_all(script_write_list, _purge_script_write,
+				&job_id);
+	while (script_write_cur && (script_write_cur->job_id == job_id))
+		slurm_cond_wait(&script_write_cond, &script_write_lock);
+	if (script_write_failed)
+		list_delete_all(script_write_failed,
+				_find_script_write_failed_job, &job_id);
+	slurm_mutex_unlock(&script_write_lock);
+}
+
+/*
+ * Run as pthread to write batch job scripts and environments queued by
+ * job_allocate() with SchedulerParameters=async_script_write, keeping the
+ * file I/O out of the job write lock. Exits once script_write_fini() is
+ * called and the queue is drained.
+ */
+extern void *script_write_thread(void *no_data)
+{
+	script_write_t *write_ptr;
+	int rc;
+
+#if HAVE_SYS_PRCTL_H
+	if (prctl(PR_SET_NAME, "sscript", NULL, NULL, NULL) < 0) {
+		error("%s: cannot set my name to %s %m", __func__, "sscript");
+	}
+#endif
+
+	slurm_mutex_lock(&script_write_lock);
+	if (!script_write_list)
+		script_write_list = list_create(_script_write_free);
+	if (!script_write_failed)
+		script_write_failed = list_create(xfree_ptr);
+	script_write_running = true;
+	while (1) {
+		if (!(write_ptr = list_dequeue(script_write_list))) {
+			if (script_write_shutdown)
+				break;
+			slurm_cond_wait(&script_write_cond,
+					&script_write_lock);
+			continue;
+		}
+		script_write_bytes -= write_ptr->size;
+		script_write_cur = write_ptr;
+		slurm_mutex_unlock(&script_write_lock);
+
+		rc = _write_job_desc_files(write_ptr->dir_name,
+					   write_ptr->script,
+					   write_ptr->environment,
+					   write_ptr->env_size);
+		if (rc)
+			error("%s: Unable to write batch script for JobId=%u",
+			      __func__, write_ptr->job_id);
+
+		slurm_mutex_lock(&script_write_lock);
+		if (rc) {
+			/* job_independent() fails the job */
+			_add_script_write_failed(write_ptr->job_id,
+						 write_ptr->seq);
+		}
+		script_write_done = write_ptr->seq;
+		script_write_cur = NULL;
+		_script_write_free(write_ptr);
+		slurm_cond_broadcast(&script_write_cond);
+	}
+	script_write_running = false;
+	script_write_shutdown = false;
+	slurm_mutex_unlock(&script_write_lock);
+
+	return NULL;
+}
+
+/* Tell script_write_thread() to write any queued job files and exit */
+extern void script_write_fini(void)
+{
+	slurm_mutex_lock(&script_write_lock);
+	script_write_shutdown = true;
+	slurm_cond_broadcast(&script_write_cond);
+	slurm_mutex_unlock(&script_write_lock);
+}
+
+/* Write the environment and script files into a job's batch directory */
+static int _write_job_desc_files(char *dir_name, char *script,
+				 char **environment, uint32_t env_size)
+{
+	int error_code;
+	char *file_name;
+
+	/* Create environment file, and write data to it */
+	file_name = xstrdup_printf("%s/environment", dir_name);
+	error_code = _write_data_array_to_file(file_name, environment,
+					       env_size);
+	xfree(file_name);
+
+	if (error_code == 0) {
+		/* Create script file */
+		file_name = xstrdup_printf("%s/script", dir_name);
+		error_code = write_data_to_file(file_name, script);
+		xfree(file_name);
+	}
+
+	return error_code;
+}
+
 /* _copy_job_desc_to_file - copy the job script and environment from the RPC
  *	structure into a file */
 static int
-_copy_job_desc_to_file(job_desc_msg_t * job_desc, uint32_t job_id)
+_copy_job_desc_to_file(job_desc_msg_t * job_desc, job_record_t *job_ptr)
 {
 	int error_code = 0, hash;
-	char *dir_name, *file_name;
+	uint32_t job_id = job_ptr->job_id;
+	char *dir_name;
 	DEF_TIMERS;
 
 	START_TIMER;
@@ -7476,19 +7871,18 @@ _copy_job_desc_to_file(job_desc_msg_t * job_desc, uint32_t job_id)
 		return ESLURM_WRITING_TO_FILE;
 	}
 
-	/* Create environment file, and write data to it */
-	file_name = xstrdup_printf("%s/environment", dir_name);
-	error_code = _write_data_array_to_file(file_name,
-					       job_desc->environment,
-					       job_desc->env_size);
-	xfree(file_name);
-
-	if (error_code == 0) {
-		/* Create script file */
-		file_name = xstrdup_printf("%s/script", dir_name);
-		error_code = write_data_to_file(file_name, job_desc->script);
-		xfree(file_name);
-	}
+	/*
+	 * Burst buffer plugins read the script file directly while still
+	 * validating the job, so it must exist before we return.
+	 */
+	job_ptr->script_write_seq = 0;
+	if (script_write_async && !job_desc->burst_buffer)
+		job_ptr->script_write_seq =
+			_queue_script_write(job_desc, job_id, dir_name);
+	if (!job_ptr->script_write_seq)
+		error_code = _write_job_desc_files(dir_name, job_desc->script,
+						   job_desc->environment,
+						   job_desc->env_size);
 
 	xfree(dir_name);
 	END_TIMER2("_copy_job_desc_to_file");
@@ -7617,6 +8011,7 @@ char **get_job_env(job_record_t *job_ptr, uint32_t *env_size)
 
 	use_id = (job_ptr->array_task_id != NO_VAL) ?
 		job_ptr->array_job_id : job_ptr->job_id;
+	_wait_script_write(use_id);
 	hash = use_id % 10;
 	file_name = xstrdup_printf("%s/hash.%d/job.%u/environment",
 	                           slurm_conf.state_save_location,
@@ -7654,6 +8049,8 @@ buf_t *get_job_script(const job_record_t *job_ptr)
 
 	use_id = (job_ptr->array_task_id != NO_VAL) ?
 		job_ptr->array_job_id : job_ptr->job_id;
+	if ((buf = _get_queued_script(use_id)))
+		return buf;
 	hash = use_id % 10;
 	file_name = xstrdup_printf("%s/hash.%d/job.%u/script",
 	                           slurm_conf.state_save_location,
@@ -9194,6 +9591,12 @@ static void _delete_job_common(job_record_t *job_ptr)
 	/* Remove record from fed_job_list */
 	fed_mgr_remove_fed_job_info(job_ptr->job_id);
 
+	/*
+	 * Drop this job's edges and have jobs waiting upon it notice that it
+	 * is gone
+	 */
+	depend_graph_job_purged(job_ptr);
+
 	/* Remove the record from job hash table */
 	_remove_job_hash(job_ptr, JOB_HASH_JOB);
 
@@ -9218,6 +9621,7 @@ static void _list_delete_job(void *job_entry)
 	xassert (job_ptr->magic == JOB_MAGIC);
 	job_ptr->magic = 0;	/* make sure we don't delete record twice */
 
+	slurm_preempt_cache_clear();
 	_delete_job_common(job_ptr);
 
 	if (job_ptr->array_recs) {
@@ -12992,6 +13396,7 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_specs,
 			orig_jobx_node_bitmap = bit_copy(expand_job_ptr->
 							 job_resrcs->
 							 node_bitmap);
+			slurm_preempt_cache_clear();
 			error_code = select_g_job_expand(job_ptr,
 							 expand_job_ptr);
 			if (error_code == SLURM_SUCCESS) {
@@ -13595,6 +14000,7 @@ fini:
 	if ((job_ptr->priority != 0) &&
 	    xstrcmp(slurm_conf.priority_type, "priority/basic"))
 		set_job_prio(job_ptr);
+	priority_g_job_changed(job_ptr);
 
 	if ((error_code == SLURM_SUCCESS) &&
 	    fed_mgr_fed_rec &&
@@ -13655,20 +14061,16 @@ extern int update_job(slurm_msg_t *msg, uid_t uid, bool send_msg)
 }
 
 /*
- * IN msg - RPC to update job, including change specification
+ * Apply job_specs to the job(s) named by job_specs->job_id_str
  * IN job_specs - a job's specification
  * IN uid - uid of user issuing RPC
+ * OUT resp_array_msg - per task results for job arrays, NULL otherwise
  * RET returns an error code from slurm_errno.h
- * global: job_list - global list of job entries
- *	last_job_update - time of last job table update
  */
-extern int update_job_str(slurm_msg_t *msg, uid_t uid)
+static int _update_job_str(job_desc_msg_t *job_specs, uid_t uid,
+			   job_array_resp_msg_t **resp_array_msg)
 {
-
-	slurm_msg_t resp_msg;
-	job_desc_msg_t *job_specs = (job_desc_msg_t *) msg->data;
 	job_record_t *job_ptr, *new_job_ptr, *het_job;
-	char *hostname = auth_g_get_host(msg->auth_cred);
 	ListIterator iter;
 	long int long_id;
 	uint32_t job_id = 0, het_job_offset;
@@ -13679,17 +14081,10 @@ extern int update_job_str(slurm_msg_t *msg, uid_t uid)
 	char *end_ptr, *tok, *tmp = NULL;
 	char *job_id_str;
 	resp_array_struct_t *resp_array = NULL;
-	job_array_resp_msg_t *resp_array_msg = NULL;
-	return_code_msg_t rc_msg;
 
+	*resp_array_msg = NULL;
 	job_id_str = job_specs->job_id_str;
 
-	if (hostname) {
-		xfree(job_specs->alloc_node);
-		job_specs->alloc_node = hostname;
-
-	}
-
 	if (max_array_size == NO_VAL)
 		max_array_size = slurm_conf.max_array_sz;
 
@@ -13884,11 +14279,44 @@ extern int update_job_str(slurm_msg_t *msg, uid_t uid)
 	}
 
 reply:
+	if ((rc != ESLURM_JOB_SETTING_DB_INX) && resp_array)
+		*resp_array_msg = _resp_array_xlate(resp_array, job_id);
+	_resp_array_free(resp_array);
+
+	FREE_NULL_BITMAP(array_bitmap);
+
+	return rc;
+}
+
+/*
+ * IN msg - RPC to update job, including change specification
+ * IN job_specs - a job's specification
+ * IN uid - uid of user issuing RPC
+ * RET returns an error code from slurm_errno.h
+ * global: job_list - global list of job entries
+ *	last_job_update - time of last job table update
+ */
+extern int update_job_str(slurm_msg_t *msg, uid_t uid)
+{
+	slurm_msg_t resp_msg;
+	job_desc_msg_t *job_specs = (job_desc_msg_t *) msg->data;
+	char *hostname = auth_g_get_host(msg->auth_cred);
+	job_array_resp_msg_t *resp_array_msg = NULL;
+	return_code_msg_t rc_msg;
+	int rc;
+
+	if (hostname) {
+		xfree(job_specs->alloc_node);
+		job_specs->alloc_node = hostname;
+
+	}
+
+	rc = _update_job_str(job_specs, uid, &resp_array_msg);
+
 	if ((rc != ESLURM_JOB_SETTING_DB_INX) && (msg->conn_fd >= 0)) {
 		slurm_msg_t_init(&resp_msg);
 		resp_msg.protocol_version = msg->protocol_version;
-		if (resp_array) {
-			resp_array_msg = _resp_array_xlate(resp_array, job_id);
+		if (resp_array_msg) {
 			resp_msg.msg_type  = RESPONSE_JOB_ARRAY_ERRORS;
 			resp_msg.data      = resp_array_msg;
 		} else {
@@ -13898,19 +14326,239 @@ reply:
 		}
 		resp_msg.conn = msg->conn;
 		slurm_send_node_msg(msg->conn_fd, &resp_msg);
+	}
+	slurm_free_job_array_resp(resp_array_msg);
 
-		if (resp_array_msg) {
-			slurm_free_job_array_resp(resp_array_msg);
-			resp_msg.data = NULL;
+	return rc;
+}
+
+/* Append one result to a job list update response, takes ownership of id */
+static void _update_list_resp_add(job_array_resp_msg_t *resp,
+				  uint32_t *resp_size, char *id, uint32_t rc)
+{
+	if (resp->job_array_count >= *resp_size) {
+		*resp_size = MAX(64, *resp_size * 2);
+		xrecalloc(resp->job_array_id, *resp_size, sizeof(char *));
+		xrecalloc(resp->error_code, *resp_size, sizeof(uint32_t));
+	}
+	resp->job_array_id[resp->job_array_count] = id;
+	resp->error_code[resp->job_array_count++] = rc;
+}
+
+static int _find_part_ptr(void *x, void *key)
+{
+	return (x == key);
+}
+
+/* Test if a job record matches the filters of a job list update */
+static bool _update_list_match(job_record_t *job_ptr,
+			       job_update_list_msg_t *req,
+			       part_record_t *part_ptr, uid_t uid,
+			       bool operator)
+{
+	if (IS_JOB_FINISHED(job_ptr))
+		return false;
+	if (!operator && (job_ptr->user_id != uid))
+		return false;
+	if ((req->user_id != NO_VAL) && (job_ptr->user_id != req->user_id))
+		return false;
+	if ((req->state != NO_VAL) &&
+	    ((job_ptr->job_state & JOB_STATE_BASE) != req->state))
+		return false;
+	if (part_ptr && (job_ptr->part_ptr != part_ptr) &&
+	    (!job_ptr->part_ptr_list ||
+	     !list_find_first(job_ptr->part_ptr_list, _find_part_ptr,
+			      part_ptr)))
+		return false;
+	return true;
+}
+
+/* Build the job ID string _update_job_str() needs to update one record */
+static char *_update_list_job_id(job_record_t *job_ptr)
+{
+	char *id = NULL, *task_str;
+
+	if (job_ptr->het_job_id) {
+		xstrfmtcat(id, "%u+%u",
+			   job_ptr->het_job_id, job_ptr->het_job_offset);
+	} else if (job_ptr->array_recs &&
+		   job_ptr->array_recs->task_id_bitmap) {
+		/* Only the pending tasks still in the meta record */
+		task_str = bit_fmt_full(job_ptr->array_recs->task_id_bitmap);
+		xstrfmtcat(id, "%u_[%s]", job_ptr->array_job_id, task_str);
+		xfree(task_str);
+	} else if (job_ptr->array_task_id != NO_VAL) {
+		xstrfmtcat(id, "%u_%u",
+			   job_ptr->array_job_id, job_ptr->array_task_id);
+	} else {
+		xstrfmtcat(id, "%u", job_ptr->job_id);
+	}
+
+	return id;
+}
+
+/*
+ * Apply the update to one job ID string and append its results.
+ * Like REQUEST_UPDATE_JOB, a job still waiting for its db_index is retried
+ * for a few seconds with job_write_lock released while waiting.
+ */
+static void _update_list_one(job_desc_msg_t *job_specs, uid_t uid,
+			     char *job_id_str, job_array_resp_msg_t *resp,
+			     uint32_t *resp_size,
+			     slurmctld_lock_t *job_write_lock)
+{
+	job_array_resp_msg_t *resp_array_msg = NULL;
+	uint32_t i;
+	int db_inx_max_cnt = 5, db_inx_cnt = 0;
+	int rc;
+
+	while (true) {
+		/* Left behind by the previous job ID or attempt, if any */
+		FREE_NULL_BITMAP(job_specs->array_bitmap);
+		job_specs->job_id_str = job_id_str;
+		rc = _update_job_str(job_specs, uid, &resp_array_msg);
+		job_specs->job_id_str = NULL;
+		if (rc != ESLURM_JOB_SETTING_DB_INX)
+			break;
+		if (db_inx_cnt >= db_inx_max_cnt) {
+			info("%s: can't update job, waited %d seconds for JobId=%s to get a db_index, but it hasn't happened yet. Giving up and informing the user",
+			     __func__, db_inx_max_cnt, job_id_str);
+			break;
 		}
+		db_inx_cnt++;
+		debug("%s: We cannot update JobId=%s at the moment, we are setting the db index, waiting",
+		      __func__, job_id_str);
+		unlock_slurmctld(*job_write_lock);
+		sleep(1);
+		lock_slurmctld(*job_write_lock);
 	}
-	_resp_array_free(resp_array);
 
-	FREE_NULL_BITMAP(array_bitmap);
+	if (!resp_array_msg) {
+		_update_list_resp_add(resp, resp_size, xstrdup(job_id_str), rc);
+		return;
+	}
+	for (i = 0; i < resp_array_msg->job_array_count; i++) {
+		_update_list_resp_add(resp, resp_size,
+				      resp_array_msg->job_array_id[i],
+				      resp_array_msg->error_code[i]);
+		resp_array_msg->job_array_id[i] = NULL;
+	}
+	slurm_free_job_array_resp(resp_array_msg);
+}
 
-	return rc;
+/*
+ * Apply one job update to every job named in the request plus every job
+ * matching its filters, replying with a result for each job.
+ * Jobs matching the filters are collected first and then updated by ID
+ * like the named jobs, so het job components and array tasks get the same
+ * handling as REQUEST_UPDATE_JOB. The job write lock is released every
+ * UPDATE_LIST_LOCK_CHUNK updates.
+ * IN msg - RPC with a job_update_list_msg_t
+ * IN uid - uid of user issuing RPC
+ * RET SLURM_SUCCESS or an error code if the request itself is invalid
+ * global: job_list - global list of job entries
+ * NOTE: Sets its own locks
+ */
+extern int update_job_list(slurm_msg_t *msg, uid_t uid)
+{
+	/* Locks: Read config, write job, write node, read partition, read fed*/
+	slurmctld_lock_t job_write_lock = {
+		READ_LOCK, WRITE_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK };
+	job_update_list_msg_t *req = (job_update_list_msg_t *) msg->data;
+	job_desc_msg_t *job_specs = req->job_desc;
+	char *hostname = auth_g_get_host(msg->auth_cred);
+	job_array_resp_msg_t *resp;
+	part_record_t *part_ptr = NULL;
+	job_record_t *job_ptr;
+	List match_list = NULL;
+	ListIterator iter;
+	slurm_msg_t resp_msg;
+	uint32_t resp_size = 0;
+	bool operator = validate_operator(uid);
+	char *job_id_str;
+	int chunk_cnt = 0, rc = SLURM_SUCCESS;
+
+	/* Only the IDs in job_id_list or matched below are used */
+	xfree(job_specs->job_id_str);
+	if (hostname) {
+		xfree(job_specs->alloc_node);
+		job_specs->alloc_node = hostname;
+	}
+
+	lock_slurmctld(job_write_lock);
+	/* Jobs are not routed to their origin cluster one at a time */
+	if (fed_mgr_fed_rec)
+		rc = ESLURM_NOT_SUPPORTED;
+	else if (req->partition &&
+		 !(part_ptr = find_part_record(req->partition)))
+		rc = ESLURM_INVALID_PARTITION_NAME;
+	else if (!req->job_id_list && !req->partition &&
+		 (req->state == NO_VAL) && (req->user_id == NO_VAL))
+		rc = ESLURM_INVALID_JOB_ID;
+	if (rc != SLURM_SUCCESS) {
+		unlock_slurmctld(job_write_lock);
+		return rc;
+	}
+
+	/* part_ptr is only valid until the locks are released */
+	if (part_ptr || (req->state != NO_VAL) || (req->user_id != NO_VAL)) {
+		match_list = list_create(xfree_ptr);
+		iter = list_iterator_create(job_list);
+		while ((job_ptr = list_next(iter))) {
+			if (_update_list_match(job_ptr, req, part_ptr, uid,
+					       operator))
+				list_append(match_list,
+					    _update_list_job_id(job_ptr));
+		}
+		list_iterator_destroy(iter);
+	}
+
+	resp = xmalloc(sizeof(*resp));
+	if (req->job_id_list) {
+		iter = list_iterator_create(req->job_id_list);
+		while ((job_id_str = list_next(iter))) {
+			_update_list_one(job_specs, uid, job_id_str, resp,
+					 &resp_size, &job_write_lock);
+			if (++chunk_cnt >= UPDATE_LIST_LOCK_CHUNK) {
+				unlock_slurmctld(job_write_lock);
+				chunk_cnt = 0;
+				lock_slurmctld(job_write_lock);
+			}
+		}
+		list_iterator_destroy(iter);
+	}
+	if (match_list) {
+		iter = list_iterator_create(match_list);
+		while ((job_id_str = list_next(iter))) {
+			_update_list_one(job_specs, uid, job_id_str, resp,
+					 &resp_size, &job_write_lock);
+			if (++chunk_cnt >= UPDATE_LIST_LOCK_CHUNK) {
+				unlock_slurmctld(job_write_lock);
+				chunk_cnt = 0;
+				lock_slurmctld(job_write_lock);
+			}
+		}
+		list_iterator_destroy(iter);
+		FREE_NULL_LIST(match_list);
+	}
+	FREE_NULL_BITMAP(job_specs->array_bitmap);
+	unlock_slurmctld(job_write_lock);
+
+	debug("%s: updated %u jobs for uid %u",
+	      __func__, resp->job_array_count, uid);
+
+	slurm_msg_t_init(&resp_msg);
+	resp_msg.protocol_version = msg->protocol_version;
+	resp_msg.msg_type = RESPONSE_JOB_ARRAY_ERRORS;
+	resp_msg.data = resp;
+	resp_msg.conn = msg->conn;
+	slurm_send_node_msg(msg->conn_fd, &resp_msg);
+	slurm_free_job_array_resp(resp);
+
+	return SLURM_SUCCESS;
 }
 
+
 static void _send_job_kill(job_record_t *job_ptr)
 {
 	kill_job_msg_t *kill_job = NULL;
@@ -15008,6 +15656,7 @@ void batch_requeue_fini(job_record_t *job_ptr)
 /* job_fini - free all memory associated with job records */
 void job_fini (void)
 {
+	depend_graph_fini();
 	FREE_NULL_LIST(job_list);
 	xfree(job_hash);
 	xfree(job_array_hash_j);
@@ -15124,6 +15773,8 @@ extern void job_completion_logger(job_record_t *job_ptr, bool requeue)
 	}
 
 	_job_array_comp(job_ptr, was_running, requeue);
+	depend_graph_job_changed(job_ptr);
+	priority_g_job_changed(job_ptr);
 
 	if (!IS_JOB_RESIZING(job_ptr) &&
 	    !IS_JOB_PENDING(job_ptr)  &&
@@ -15230,6 +15881,7 @@ extern bool job_independent(job_record_t *job_ptr)
 	struct job_details *detail_ptr = job_ptr->details;
 	time_t now = time(NULL);
 	int depend_rc;
+	bool script_failed;
 
 	if ((job_ptr->state_reason == FAIL_BURST_BUFFER_OP) ||
 	    (job_ptr->state_reason == FAIL_ACCOUNT) ||
@@ -15241,6 +15893,30 @@ extern bool job_independent(job_record_t *job_ptr)
 	    (job_ptr->state_reason == WAIT_DEP_INVALID))
 		return false;
 
+	/* Don't launch before the batch script is in StateSaveLocation */
+	if (!_script_write_done(job_ptr, &script_failed)) {
+		job_ptr->state_reason = WAIT_SCRIPT_WRITE;
+		xfree(job_ptr->state_desc);
+		return false;
+	}
+	if (job_ptr->state_reason == WAIT_SCRIPT_WRITE) {
+		job_ptr->state_reason = WAIT_NO_REASON;
+		xfree(job_ptr->state_desc);
+	}
+	if (script_failed) {
+		error("%s: Unable to write batch script for %pJ, failing job",
+		      __func__, job_ptr);
+		job_ptr->job_state = JOB_FAILED;
+		job_ptr->exit_code = 1;
+		job_ptr->state_reason = FAIL_SYSTEM;
+		xfree(job_ptr->state_desc);
+		job_ptr->state_desc = xstrdup("Unable to write batch script");
+		job_ptr->start_time = job_ptr->end_time = now;
+		job_completion_logger(job_ptr, false);
+		last_job_update = now;
+		return false;
+	}
+
 	/* Test dependencies first so we can cancel jobs before dependent
 	 * job records get purged (e.g. afterok, afternotok) */
 	depend_rc = test_job_dependency(job_ptr, NULL);
@@ -15285,6 +15961,8 @@ extern bool job_independent(job_record_t *job_ptr)
 	if ((detail_ptr && (detail_ptr->begin_time == 0) &&
 	    (job_ptr->priority != 0))) {
 		detail_ptr->begin_time = now;
+		/* Its age factor starts counting now */
+		priority_g_job_changed(job_ptr);
 		/*
 		 * Send begin time to the database if it is already there, or it
 		 * won't get there until the job starts.
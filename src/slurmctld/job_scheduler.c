@@ -72,6 +72,7 @@
 #include "src/common/track_script.h"
 #include "src/common/uid.h"
 #include "src/common/xassert.h"
+#include "src/common/xhash.h"
 #include "src/common/xstring.h"
 
 #include "src/slurmctld/acct_policy.h"
@@ -98,8 +99,18 @@
 #  define CORRESPOND_ARRAY_TASK_CNT 10
 #endif
 #define BUILD_TIMEOUT 2000000	/* Max build_job_queue() run time in usec */
+#define DEPEND_RETEST_PERIOD 60	/* Max age of cached dependency test, secs */
 #define MAX_FAILED_RESV 10
 
+/*
+ * Reverse edge of the job dependency graph: the jobs waiting upon job_id.
+ * Consumed (removed) once job_id changes state.
+ */
+typedef struct {
+	uint32_t job_id;	/* job being depended upon */
+	List dependents;	/* job IDs (uint32_t *) of dependent jobs */
+} depend_edge_t;
+
 typedef struct wait_boot_arg {
 	uint32_t job_id;
 	bitstr_t *node_bitmap;
@@ -134,6 +145,7 @@ static uint16_t bf_hetjob_prio = 0;
 static int sched_min_interval = 2;
 
 static int bb_array_stage_cnt = 10;
+static xhash_t *depend_graph = NULL;	/* depend_edge_t records by job_id */
 extern diag_stats_t slurmctld_diag_stats;
 
 static int _find_singleton_job (void *x, void *key)
@@ -433,7 +445,7 @@ extern void job_queue_rec_resv_list(job_queue_rec_t *job_queue_rec)
  * RET the job queue
  * NOTE: the caller must call FREE_NULL_LIST() on RET value to free memory
  */
-extern List build_job_queue(bool clear_start, bool backfill)
+static List _build_job_queue(bool clear_start, bool backfill)
 {
 	static time_t last_log_time = 0;
 	List job_queue;
@@ -651,6 +663,19 @@ extern List build_job_queue(bool clear_start, bool backfill)
 	return job_queue;
 }
 
+/* build_job_queue - see _build_job_queue(), timed for sdiag */
+extern List build_job_queue(bool clear_start, bool backfill)
+{
+	struct timeval tv;
+	List job_queue;
+
+	SCHED_PHASE_START(tv);
+	job_queue = _build_job_queue(clear_start, backfill);
+	SCHED_PHASE_END(tv, SCHED_PHASE_BUILD_JOB_QUEUE);
+
+	return job_queue;
+}
+
 /*
  * job_is_completing - Determine if jobs are in the process of completing.
  * IN/OUT  eff_cg_bitmap - optional bitmap of all relevent completing nodes,
@@ -1040,6 +1065,7 @@ static int _schedule(bool full_queue)
 	bool fail_by_part, wait_on_resv;
 	uint32_t deadline_time_limit, save_time_limit = 0;
 	uint32_t prio_reserve;
+	sched_ctx_t old_ctx;
 #if HAVE_SYS_PRCTL_H
 	char get_name[16];
 #endif
@@ -1057,6 +1083,7 @@ static int _schedule(bool full_queue)
 		error("%s: cannot set my name to %s %m", __func__, "sched");
 	}
 #endif
+	old_ctx = sched_phase_set_ctx(SCHED_CTX_MAIN);
 
 	if (sched_update != slurm_conf.last_update) {
 		char *tmp_ptr;
@@ -1971,6 +1998,7 @@ fail_this_part:	if (fail_by_part) {
 	_do_diag_stats(DELTA_TIMER);
 
 out:
+	sched_phase_set_ctx(old_ctx);
 #if HAVE_SYS_PRCTL_H
 	if (prctl(PR_SET_NAME, get_name, NULL, NULL, NULL) < 0) {
 		error("%s: cannot set my name to %s %m",
@@ -2931,6 +2959,160 @@ static void _test_dependency_state(depend_spec_t *dep_ptr, bool *or_satisfied,
 	}
 }
 
+/* Fetch key from xhash_t item. Called from function ptr */
+static void _depend_edge_key(void *item, const char **key, uint32_t *key_len)
+{
+	depend_edge_t *edge = (depend_edge_t *) item;
+
+	xassert(edge);
+
+	*key = (char *) &edge->job_id;
+	*key_len = sizeof(uint32_t);
+}
+
+/* Free item from xhash_t. Called from function ptr */
+static void _depend_edge_free(void *item)
+{
+	depend_edge_t *edge = (depend_edge_t *) item;
+
+	if (edge) {
+		FREE_NULL_LIST(edge->dependents);
+		xfree(edge);
+	}
+}
+
+static int _find_dependent_id(void *x, void *key)
+{
+	return (*(uint32_t *) x == *(uint32_t *) key);
+}
+
+/* Record that dependent_id must be retested once job_id changes state */
+static void _depend_graph_add(uint32_t job_id, uint32_t dependent_id)
+{
+	depend_edge_t *edge;
+	uint32_t *dependent;
+
+	if (!depend_graph)
+		depend_graph = xhash_init(_depend_edge_key, _depend_edge_free);
+
+	if (!(edge = xhash_get(depend_graph, (char *) &job_id,
+			       sizeof(uint32_t)))) {
+		edge = xmalloc(sizeof(depend_edge_t));
+		edge->job_id = job_id;
+		edge->dependents = list_create(xfree_ptr);
+		xhash_add(depend_graph, edge);
+	} else if (list_find_first(edge->dependents, _find_dependent_id,
+				   &dependent_id)) {
+		return;
+	}
+
+	dependent = xmalloc(sizeof(uint32_t));
+	*dependent = dependent_id;
+	list_append(edge->dependents, dependent);
+}
+
+/* Remove the edges registered for job_ptr's current dependency list */
+static void _depend_graph_remove(job_record_t *job_ptr)
+{
+	ListIterator depend_iter;
+	depend_spec_t *dep_ptr;
+	depend_edge_t *edge;
+
+	if (!depend_graph || !job_ptr->details ||
+	    !job_ptr->details->depend_list)
+		return;
+
+	depend_iter = list_iterator_create(job_ptr->details->depend_list);
+	while ((dep_ptr = list_next(depend_iter))) {
+		if (!(edge = xhash_get(depend_graph, (char *) &dep_ptr->job_id,
+				       sizeof(uint32_t))))
+			continue;
+		list_delete_all(edge->dependents, _find_dependent_id,
+				&job_ptr->job_id);
+		if (!list_count(edge->dependents))
+			xhash_delete(depend_graph, (char *) &edge->job_id,
+				     sizeof(uint32_t));
+	}
+	list_iterator_destroy(depend_iter);
+}
+
+static int _depend_graph_invalidate(void *x, void *arg)
+{
+	job_record_t *job_ptr = find_job_record(*(uint32_t *) x);
+
+	if (job_ptr)
+		job_ptr->depend_test_time = 0;
+
+	return SLURM_SUCCESS;
+}
+
+/* Invalidate the cached dependency test of every job waiting upon job_id */
+static void _depend_graph_notify(uint32_t job_id)
+{
+	depend_edge_t *edge;
+
+	if (!depend_graph || !job_id)
+		return;
+
+	if (!(edge = xhash_pop(depend_graph, (char *) &job_id,
+			       sizeof(uint32_t))))
+		return;
+
+	list_for_each(edge->dependents, _depend_graph_invalidate, NULL);
+	_depend_edge_free(edge);
+}
+
+extern void depend_graph_job_changed(job_record_t *job_ptr)
+{
+	xassert(job_ptr);
+
+	_depend_graph_notify(job_ptr->job_id);
+	/* Dependencies on the job array as a whole or one of its tasks */
+	if (job_ptr->array_job_id && (job_ptr->array_job_id != job_ptr->job_id))
+		_depend_graph_notify(job_ptr->array_job_id);
+}
+
+extern void depend_graph_job_purged(job_record_t *job_ptr)
+{
+	xassert(job_ptr);
+
+	_depend_graph_remove(job_ptr);
+	depend_graph_job_changed(job_ptr);
+}
+
+extern void depend_graph_fini(void)
+{
+	xhash_free(depend_graph);
+}
+
+/*
+ * Return true if an unfulfilled dependency can only be satisfied or failed
+ * by a state change of the job it references (e.g. start or completion), so
+ * its test result can be cached until depend_graph_job_changed() is called
+ * for that job.
+ */
+static bool _depend_event_driven(depend_spec_t *dep_ptr)
+{
+	if (dep_ptr->depend_flags & SLURM_FLAGS_REMOTE)
+		return false;
+	if (!dep_ptr->job_ptr)
+		return false;
+
+	switch (dep_ptr->depend_type) {
+	case SLURM_DEPEND_AFTER:
+		/* "after:<job>+<time>" and sibling starts are time driven */
+		if (dep_ptr->depend_time || dep_ptr->job_ptr->fed_details)
+			return false;
+		return true;
+	case SLURM_DEPEND_AFTER_ANY:
+	case SLURM_DEPEND_AFTER_OK:
+	case SLURM_DEPEND_AFTER_NOT_OK:
+		return true;
+	default:
+		return false;
+	}
+}
+
 /*
  * Determine if a job's dependencies are met
  * Inputs: job_ptr
@@ -2952,17 +3134,34 @@ extern int test_job_dependency(job_record_t *job_ptr, bool *was_changed)
 	job_record_t  *djob_ptr;
 	bool is_complete, is_completed, is_pending;
 	bool or_satisfied = false, and_failed = false, or_flag = false,
-	     has_unfulfilled = false, changed = false;
+	     has_unfulfilled = false, changed = false, cacheable = true;
+	bool edges_valid;
+	time_t now = time(NULL);
 
 	if ((job_ptr->details == NULL) ||
 	    (job_ptr->details->depend_list == NULL) ||
 	    (list_count(job_ptr->details->depend_list) == 0)) {
 		job_ptr->bit_flags &= ~JOB_DEPENDENT;
+		job_ptr->depend_test_time = 0;
 		if (was_changed)
 			*was_changed = changed;
 		return NO_DEPEND;
 	}
 
+	/*
+	 * None of the jobs this one waits upon changed state since the last
+	 * test, so the dependency can not have been satisfied. Retest
+	 * periodically anyway in case some state change was not reported.
+	 */
+	if (!was_changed && job_ptr->depend_test_time &&
+	    (difftime(now, job_ptr->depend_test_time) < DEPEND_RETEST_PERIOD)) {
+		job_ptr->bit_flags |= JOB_DEPENDENT;
+		return LOCAL_DEPEND;
+	}
+	/* Reverse edges are still registered unless consumed by a change */
+	edges_valid = (job_ptr->depend_test_time != 0);
+	job_ptr->depend_test_time = 0;
+
 	depend_iter = list_iterator_create(job_ptr->details->depend_list);
 	while ((dep_ptr = list_next(depend_iter))) {
 		bool clear_dep = false, failure = false;
@@ -3054,6 +3253,9 @@ extern int test_job_dependency(job_record_t *job_ptr, bool *was_changed)
 
 		_test_dependency_state(dep_ptr, &or_satisfied, &and_failed,
 				       &or_flag, &has_unfulfilled);
+		if ((dep_ptr->depend_state == DEPEND_NOT_FULFILLED) &&
+		    !_depend_event_driven(dep_ptr))
+			cacheable = false;
 	}
 	list_iterator_destroy(depend_iter);
 
@@ -3095,6 +3297,25 @@ extern int test_job_dependency(job_record_t *job_ptr, bool *was_changed)
 				REMOTE_DEPEND;
 	}
 
+	if ((results == LOCAL_DEPEND) && cacheable) {
+		/*
+		 * Only a state change of a job we wait upon can change this
+		 * result. Register with those jobs so they wake us up.
+		 */
+		if (!edges_valid) {
+			depend_iter = list_iterator_create(
+				job_ptr->details->depend_list);
+			while ((dep_ptr = list_next(depend_iter))) {
+				if (dep_ptr->depend_state ==
+				    DEPEND_NOT_FULFILLED)
+					_depend_graph_add(dep_ptr->job_id,
+							  job_ptr->job_id);
+			}
+			list_iterator_destroy(depend_iter);
+		}
+		job_ptr->depend_test_time = now;
+	}
+
 	if (was_changed)
 		*was_changed = changed;
 	return results;
@@ -3544,6 +3765,8 @@ extern bool update_job_dependency_list(job_record_t *job_ptr,
 		was_changed = true;
 	}
 	list_iterator_destroy(itr);
+	if (was_changed)
+		job_ptr->depend_test_time = 0;
 	return was_changed;
 }
 
@@ -3647,8 +3870,10 @@ extern int update_job_dependency(job_record_t *job_ptr, char *new_depend)
 	job_ptr->details->expanding_jobid = 0;
 	if ((new_depend == NULL) || (new_depend[0] == '\0') ||
 	    ((new_depend[0] == '0') && (new_depend[1] == '\0'))) {
+		_depend_graph_remove(job_ptr);
 		xfree(job_ptr->details->dependency);
 		FREE_NULL_LIST(job_ptr->details->depend_list);
+		job_ptr->depend_test_time = 0;
 		return rc;
 
 	}
@@ -3759,8 +3984,10 @@ extern int update_job_dependency(job_record_t *job_ptr, char *new_depend)
 	}
 
 	if (rc == SLURM_SUCCESS) {
+		_depend_graph_remove(job_ptr);
 		FREE_NULL_LIST(job_ptr->details->depend_list);
 		job_ptr->details->depend_list = new_depend_list;
+		job_ptr->depend_test_time = 0;
 		_depend_list2str(job_ptr, or_flag);
 		if (slurm_conf.debug_flags & DEBUG_FLAG_DEPENDENCY)
 			print_job_dependency(job_ptr, __func__);
@@ -104,6 +104,25 @@ extern batch_job_launch_msg_t *build_launch_job_msg(job_record_t *job_ptr,
  */
 extern bool deadline_ok(job_record_t *job_ptr, char *func);
 
+/* Free the job dependency graph */
+extern void depend_graph_fini(void);
+
+/*
+ * Note that a job started, completed, was requeued or purged. Jobs waiting
+ * upon it in their dependency list will be fully retested on their next
+ * test_job_dependency() call rather than reuse a cached result.
+ * IN job_ptr - job that changed state
+ */
+extern void depend_graph_job_changed(job_record_t *job_ptr);
+
+/*
+ * Note that a job record is being purged. Its own entries in the dependency
+ * graph are removed and jobs waiting upon it are retested as by
+ * depend_graph_job_changed().
+ * IN job_ptr - job being purged, its dependency list still set
+ */
+extern void depend_graph_job_purged(job_record_t *job_ptr);
+
 /*
  * epilog_slurmctld - execute the prolog_slurmctld for a job that has just
  *	terminated.
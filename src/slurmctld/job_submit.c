@@ -235,6 +235,10 @@ extern int job_submit_plugin_submit(job_desc_msg_t *job_desc,
 	for (i = 0; ((i < g_context_cnt) && (rc == SLURM_SUCCESS)); i++)
 		rc = (*(ops[i].submit))(job_desc, submit_uid, err_msg);
 	slurm_mutex_unlock(&g_context_lock);
+
+	/* The caller's string size checks don't cover plugin changes */
+	if ((rc == SLURM_SUCCESS) && (i > 0))
+		rc = validate_job_desc_strings(job_desc);
 	END_TIMER2("job_submit_plugin_submit");
 
 	return rc;
@@ -48,6 +48,7 @@
 #include "src/common/list.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 #include "src/slurmctld/licenses.h"
@@ -58,6 +59,14 @@
 List license_list = (List) NULL;
 time_t last_license_update = 0;
 static pthread_mutex_t license_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Name index of license_list, protected by license_mutex. Rebuilt on first
+ * use after a license is added or removed or license_list is replaced.
+ */
+static xhash_t *license_hash = NULL;
+static List license_hash_list = NULL;
+static bool license_hash_valid = false;
 static void _pack_license(struct licenses *lic, buf_t *buffer,
 			  uint16_t protocol_version);
 
@@ -218,9 +227,49 @@ static void _add_res_rec_2_lic_list(slurmdb_res_rec_t *rec, bool sync)
 	license_entry->remote = sync ? 2 : 1;
 
 	list_push(license_list, license_entry);
+	license_hash_valid = false;
 	last_license_update = time(NULL);
 }
 
+static void _license_hash_identity(void *item, const char **key,
+				   uint32_t *key_len)
+{
+	licenses_t *license_entry = (licenses_t *) item;
+
+	*key = license_entry->name;
+	*key_len = strlen(license_entry->name);
+}
+
+/*
+ * Find a license_t record in license_list by license name.
+ * license_mutex should be locked before calling this.
+ */
+static licenses_t *_license_find(char *name)
+{
+	ListIterator iter;
+	licenses_t *license_entry;
+
+	if (!license_list || !name)
+		return NULL;
+
+	if (!license_hash_valid || (license_hash_list != license_list)) {
+		xhash_free(license_hash);
+		license_hash = xhash_init(_license_hash_identity, NULL);
+		iter = list_iterator_create(license_list);
+		while ((license_entry = list_next(iter))) {
+			/* Keep the first record of a name, as a list scan */
+			if (license_entry->name &&
+			    !xhash_get_str(license_hash, license_entry->name))
+				xhash_add(license_hash, license_entry);
+		}
+		list_iterator_destroy(iter);
+		license_hash_list = license_list;
+		license_hash_valid = true;
+	}
+
+	return xhash_get_str(license_hash, name);
+}
+
 /* Initialize licenses on this system based upon slurm.conf */
 extern int license_init(char *licenses)
 {
@@ -293,6 +342,7 @@ extern int license_update(char *licenses)
 
         FREE_NULL_LIST(license_list);
         license_list = new_list;
+        license_hash_valid = false;
         _licenses_print("update_license", license_list, NULL);
         slurm_mutex_unlock(&license_mutex);
         return SLURM_SUCCESS;
@@ -402,6 +452,7 @@ extern void license_remove_remote(slurmdb_res_rec_t *rec)
 			     "removed with %u in use",
 			     license_entry->name, license_entry->used);
 			list_delete_item(iter);
+			license_hash_valid = false;
 			last_license_update = time(NULL);
 			break;
 		}
@@ -470,6 +521,7 @@ extern void license_sync_remote(List res_list)
 			     "removed with %u in use",
 			     license_entry->name, license_entry->used);
 			list_delete_item(iter);
+			license_hash_valid = false;
 			last_license_update = time(NULL);
 		} else if (license_entry->remote == 2)
 			license_entry->remote = 1;
@@ -484,6 +536,9 @@ extern void license_free(void)
 {
 	slurm_mutex_lock(&license_mutex);
 	FREE_NULL_LIST(license_list);
+	xhash_free(license_hash);
+	license_hash_list = NULL;
+	license_hash_valid = false;
 	slurm_mutex_unlock(&license_mutex);
 }
 
@@ -527,12 +582,7 @@ extern List license_validate(char *licenses, bool validate_configured,
 	_licenses_print("request_license", job_license_list, NULL);
 	iter = list_iterator_create(job_license_list);
 	while ((license_entry = list_next(iter))) {
-		if (license_list) {
-			match = list_find_first(license_list,
-						_license_find_rec,
-						license_entry->name);
-		} else
-			match = NULL;
+		match = _license_find(license_entry->name);
 		if (!match) {
 			debug("License name requested (%s) does not exist",
 			      license_entry->name);
@@ -591,7 +641,7 @@ extern void license_job_merge(job_record_t *job_ptr)
  * IN reboot    - true if node reboot required to start job
  * RET: SLURM_SUCCESS, EAGAIN (not available now), SLURM_ERROR (never runnable)
  */
-extern int license_job_test(job_record_t *job_ptr, time_t when, bool reboot)
+static int _license_job_test(job_record_t *job_ptr, time_t when, bool reboot)
 {
 	ListIterator iter;
 	licenses_t *license_entry, *match;
@@ -603,8 +653,7 @@ extern int license_job_test(job_record_t *job_ptr, time_t when, bool reboot)
 	slurm_mutex_lock(&license_mutex);
 	iter = list_iterator_create(job_ptr->license_list);
 	while ((license_entry = list_next(iter))) {
-		match = list_find_first(license_list, _license_find_rec,
-			license_entry->name);
+		match = _license_find(license_entry->name);
 		if (!match) {
 			error("could not find license %s for job %u",
 			      license_entry->name, job_ptr->job_id);
@@ -637,6 +686,19 @@ extern int license_job_test(job_record_t *job_ptr, time_t when, bool reboot)
 	return rc;
 }
 
+/* license_job_test - see _license_job_test(), timed for sdiag */
+extern int license_job_test(job_record_t *job_ptr, time_t when, bool reboot)
+{
+	struct timeval tv;
+	int rc;
+
+	SCHED_PHASE_START(tv);
+	rc = _license_job_test(job_ptr, when, reboot);
+	SCHED_PHASE_END(tv, SCHED_PHASE_LICENSE_TEST);
+
+	return rc;
+}
+
 /*
  * license_job_copy - create a copy of a job's license list
  * IN license_list_src - job license list to be copied
@@ -682,8 +744,7 @@ extern int license_job_get(job_record_t *job_ptr)
 	slurm_mutex_lock(&license_mutex);
 	iter = list_iterator_create(job_ptr->license_list);
 	while ((license_entry = list_next(iter))) {
-		match = list_find_first(license_list, _license_find_rec,
-			license_entry->name);
+		match = _license_find(license_entry->name);
 		if (match) {
 			match->used += license_entry->total;
 			license_entry->used += license_entry->total;
@@ -718,8 +779,7 @@ extern int license_job_return(job_record_t *job_ptr)
 	slurm_mutex_lock(&license_mutex);
 	iter = list_iterator_create(job_ptr->license_list);
 	while ((license_entry = list_next(iter))) {
-		match = list_find_first(license_list, _license_find_rec,
-			license_entry->name);
+		match = _license_find(license_entry->name);
 		if (match) {
 			if (match->used >= license_entry->total)
 				match->used -= license_entry->total;
@@ -832,8 +892,7 @@ extern uint32_t get_total_license_cnt(char *name)
 
 	slurm_mutex_lock(&license_mutex);
 	if (license_list) {
-		lic = list_find_first(
-			license_list, _license_find_rec, name);
+		lic = _license_find(name);
 
 		if (lic)
 			count = lic->total;
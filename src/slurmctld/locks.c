@@ -49,6 +49,14 @@ static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static pthread_rwlock_t slurmctld_locks[ENTITY_COUNT];
 
+static const char *entity_names[ENTITY_COUNT] = {
+	"conf", "job", "node", "part", "fed"
+};
+
+lock_trace_t slurmctld_lock_trace =
+	LOCK_TRACE_INITIALIZER(LOCK_TRACE_SLURMCTLD, "slurmctld",
+			       entity_names, ENTITY_COUNT);
+
 #ifndef NDEBUG
 /*
  * Used to protect against double-locking within a single thread. Calling
@@ -102,10 +110,67 @@ extern bool verify_lock(lock_datatype_t datatype, lock_level_t level)
 }
 #endif
 
+/*
+ * Take one lock. The uncontended case is a plain trylock, only the time spent
+ * blocked on a contended lock is timed and charged to the scheduler phase
+ * statistics reported by sdiag.
+ * RET usec spent blocked
+ */
+static long _lock_entity(lock_datatype_t datatype, lock_level_t level,
+			 uint32_t *read_mask, uint32_t *write_mask)
+{
+	struct timeval tv;
+	long wait_usec;
+
+	if (level == READ_LOCK) {
+		*read_mask |= (1 << datatype);
+		if (!slurm_rwlock_tryrdlock(&slurmctld_locks[datatype]))
+			return 0;
+		SCHED_PHASE_START(tv);
+		slurm_rwlock_rdlock(&slurmctld_locks[datatype]);
+	} else if (level == WRITE_LOCK) {
+		*write_mask |= (1 << datatype);
+		if (!slurm_rwlock_trywrlock(&slurmctld_locks[datatype]))
+			return 0;
+		SCHED_PHASE_START(tv);
+		slurm_rwlock_wrlock(&slurmctld_locks[datatype]);
+	} else
+		return 0;
+
+	wait_usec = slurm_delta_tv(&tv);
+	/* lock_datatype_t and the SCHED_PHASE_LOCK_* values share an order */
+	sched_phase_record(SCHED_PHASE_LOCK_CONF + datatype, wait_usec);
+
+	return wait_usec;
+}
+
+static void _lock_mask_add(lock_datatype_t datatype, lock_level_t level,
+			   uint32_t *read_mask, uint32_t *write_mask)
+{
+	if (level == READ_LOCK)
+		*read_mask |= (1 << datatype);
+	else if (level == WRITE_LOCK)
+		*write_mask |= (1 << datatype);
+}
+
+/* Build the lock_trace_acquired() masks of a set of lock levels */
+static void _lock_masks(slurmctld_lock_t *lock_levels, uint32_t *read_mask,
+			uint32_t *write_mask)
+{
+	*read_mask = *write_mask = 0;
+	_lock_mask_add(CONF_LOCK, lock_levels->conf, read_mask, write_mask);
+	_lock_mask_add(JOB_LOCK, lock_levels->job, read_mask, write_mask);
+	_lock_mask_add(NODE_LOCK, lock_levels->node, read_mask, write_mask);
+	_lock_mask_add(PART_LOCK, lock_levels->part, read_mask, write_mask);
+	_lock_mask_add(FED_LOCK, lock_levels->fed, read_mask, write_mask);
+}
+
 /* lock_slurmctld - Issue the required lock requests in a well defined order */
-extern void lock_slurmctld(slurmctld_lock_t lock_levels)
+extern void lock_slurmctld_at(slurmctld_lock_t lock_levels, const char *site)
 {
 	static bool init_run = false;
+	uint32_t read_mask = 0, write_mask = 0;
+	long wait_usec = 0;
 	xassert(_store_locks(lock_levels));
 
 	if (!init_run) {
@@ -114,38 +179,31 @@ extern void lock_slurmctld(slurmctld_lock_t lock_levels)
 			slurm_rwlock_init(&slurmctld_locks[i]);
 	}
 
-	if (lock_levels.conf == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[CONF_LOCK]);
-	else if (lock_levels.conf == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[CONF_LOCK]);
-
-	if (lock_levels.job == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[JOB_LOCK]);
-	else if (lock_levels.job == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[JOB_LOCK]);
-
-	if (lock_levels.node == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[NODE_LOCK]);
-	else if (lock_levels.node == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[NODE_LOCK]);
-
-	if (lock_levels.part == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[PART_LOCK]);
-	else if (lock_levels.part == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[PART_LOCK]);
-
-	if (lock_levels.fed == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[FED_LOCK]);
-	else if (lock_levels.fed == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[FED_LOCK]);
+	wait_usec += _lock_entity(CONF_LOCK, lock_levels.conf,
+				  &read_mask, &write_mask);
+	wait_usec += _lock_entity(JOB_LOCK, lock_levels.job,
+				  &read_mask, &write_mask);
+	wait_usec += _lock_entity(NODE_LOCK, lock_levels.node,
+				  &read_mask, &write_mask);
+	wait_usec += _lock_entity(PART_LOCK, lock_levels.part,
+				  &read_mask, &write_mask);
+	wait_usec += _lock_entity(FED_LOCK, lock_levels.fed,
+				  &read_mask, &write_mask);
+
+	lock_trace_acquired(&slurmctld_lock_trace, site, wait_usec,
+			    read_mask, write_mask);
 }
 
 /* unlock_slurmctld - Issue the required unlock requests in a well
  *	defined order */
 extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
 {
+	uint32_t read_mask, write_mask;
 	xassert(_clear_locks(lock_levels));
 
+	_lock_masks(&lock_levels, &read_mask, &write_mask);
+	lock_trace_release(&slurmctld_lock_trace, read_mask, write_mask);
+
 	if (lock_levels.fed)
 		slurm_rwlock_unlock(&slurmctld_locks[FED_LOCK]);
 
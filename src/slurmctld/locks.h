@@ -93,6 +93,8 @@
 
 #include <stdbool.h>
 
+#include "src/common/timers.h"
+
 /* levels of locking required for each data structure */
 typedef enum {
 	NO_LOCK,
@@ -126,8 +128,16 @@ extern bool verify_lock(lock_datatype_t datatype, lock_level_t level);
  *	control */
 extern void init_locks ( void );
 
-/* lock_slurmctld - Issue the required lock requests in a well defined order */
-extern void lock_slurmctld (slurmctld_lock_t lock_levels);
+/* Contention statistics of the slurmctld locks, see lock_trace_t */
+extern lock_trace_t slurmctld_lock_trace;
+
+/*
+ * lock_slurmctld - Issue the required lock requests in a well defined order
+ * The calling function is recorded for lock contention tracing.
+ */
+#define lock_slurmctld(lock_levels) \
+	lock_slurmctld_at(lock_levels, __func__)
+extern void lock_slurmctld_at(slurmctld_lock_t lock_levels, const char *site);
 
 /* unlock_slurmctld - Issue the required unlock requests in a well
  *	defined order */
@@ -2034,6 +2034,9 @@ static int _update_node_gres(char *node_names, char *gres)
 				overlap1--;
 				if (rc == SLURM_SUCCESS)
 					rc = rc2;
+			} else {
+				/* Notify select plugin of new GRES counts */
+				select_g_update_node_config(i);
 			}
 			gres_node_state_log(node_ptr->gres_list,
 					    node_ptr->name);
@@ -272,6 +272,7 @@ extern void deallocate_nodes(job_record_t *job_ptr, bool timeout,
 	log_flag(TRACE_JOBS, "%s: %pJ", __func__, job_ptr);
 
 	acct_policy_job_fini(job_ptr);
+	slurm_preempt_cache_clear();
 	if (select_g_job_fini(job_ptr) != SLURM_SUCCESS)
 		error("select_g_job_fini(%pJ): %m", job_ptr);
 	epilog_slurmctld(job_ptr);
@@ -2134,6 +2135,8 @@ static void _end_null_job(job_record_t *job_ptr)
 	gres_ctld_job_clear(job_ptr->gres_list);
 	job_ptr->job_state = JOB_RUNNING;
 	job_ptr->bit_flags |= JOB_WAS_RUNNING;
+	depend_graph_job_changed(job_ptr);
+	priority_g_job_changed(job_ptr);
 	FREE_NULL_BITMAP(job_ptr->node_bitmap);
 	xfree(job_ptr->nodes);
 	xfree(job_ptr->sched_nodes);
@@ -2168,6 +2171,7 @@ static void _end_null_job(job_record_t *job_ptr)
 	job_ptr->job_state = JOB_COMPLETE;
 	job_completion_logger(job_ptr, false);
 	acct_policy_job_fini(job_ptr);
+	slurm_preempt_cache_clear();
 	if (select_g_job_fini(job_ptr) != SLURM_SUCCESS)
 		error("select_g_job_fini(%pJ): %m", job_ptr);
 	epilog_slurmctld(job_ptr);
@@ -2232,9 +2236,9 @@ static List _handle_exclusive_gres(job_record_t *job_ptr,
  *	   the request, (e.g. best-fit or other criterion)
  *	3) Call allocate_nodes() to perform the actual allocation
  */
-extern int select_nodes(job_record_t *job_ptr, bool test_only,
-			bitstr_t **select_node_bitmap, char **err_msg,
-			bool submission, uint32_t scheduler_type)
+static int _select_nodes(job_record_t *job_ptr, bool test_only,
+			 bitstr_t **select_node_bitmap, char **err_msg,
+			 bool submission, uint32_t scheduler_type)
 {
 	int bb, error_code = SLURM_SUCCESS, i, node_set_size = 0;
 	bitstr_t *select_bitmap = NULL;
@@ -2591,6 +2595,7 @@ extern int select_nodes(job_record_t *job_ptr, bool test_only,
 		last_job_update = now;
 		goto cleanup;
 	}
+	slurm_preempt_cache_clear();
 	if (select_g_job_begin(job_ptr) != SLURM_SUCCESS) {
 		/* Leave job queued, something is hosed */
 		error("select_g_job_begin(%pJ): %m", job_ptr);
@@ -2638,6 +2643,8 @@ extern int select_nodes(job_record_t *job_ptr, bool test_only,
 
 	job_ptr->job_state = JOB_RUNNING;
 	job_ptr->bit_flags |= JOB_WAS_RUNNING;
+	depend_graph_job_changed(job_ptr);
+	priority_g_job_changed(job_ptr);
 
 	if (select_g_select_nodeinfo_set(job_ptr) != SLURM_SUCCESS) {
 		error("select_g_select_nodeinfo_set(%pJ): %m", job_ptr);
@@ -2745,6 +2752,22 @@ cleanup:
 	return error_code;
 }
 
+/* select_nodes - see _select_nodes(), timed for sdiag */
+extern int select_nodes(job_record_t *job_ptr, bool test_only,
+			bitstr_t **select_node_bitmap, char **err_msg,
+			bool submission, uint32_t scheduler_type)
+{
+	struct timeval tv;
+	int rc;
+
+	SCHED_PHASE_START(tv);
+	rc = _select_nodes(job_ptr, test_only, select_node_bitmap, err_msg,
+			   submission, scheduler_type);
+	SCHED_PHASE_END(tv, SCHED_PHASE_SELECT_NODES);
+
+	return rc;
+}
+
 /*
  * get_node_cnts - determine the number of nodes for the requested job.
  * IN job_ptr - pointer to the job record.
@@ -59,6 +59,7 @@
 #include "src/common/pack.h"
 #include "src/common/slurm_resource_info.h"
 #include "src/common/uid.h"
+#include "src/common/xhash.h"
 #include "src/common/xstring.h"
 
 #include "src/slurmctld/burst_buffer.h"
@@ -81,6 +82,17 @@ List part_list = NULL;			/* partition list */
 char *default_part_name = NULL;		/* name of default partition */
 part_record_t *default_part_loc = NULL;	/* default partition location */
 time_t last_part_update = (time_t) 0;	/* time of last update to partition records */
+
+/*
+ * Name index of part_list for find_part_record(). Rebuilt on first use after
+ * a partition record is created or deleted or part_list is replaced. Records
+ * only change under the partition write lock, but lookups happen under the
+ * read lock so part_hash_mutex serializes the rebuild.
+ */
+static pthread_mutex_t part_hash_mutex = PTHREAD_MUTEX_INITIALIZER;
+static xhash_t *part_hash = NULL;
+static List part_hash_list = NULL;
+static bool part_hash_valid = false;
 uint16_t part_max_priority = DEF_PART_MAX_PRIORITY;
 
 static int    _delete_part_record(char *name);
@@ -377,6 +389,7 @@ part_record_t *create_part_record(const char *name)
 	part_ptr->bf_data = NULL;
 
 	(void) list_append(part_list, part_ptr);
+	part_hash_valid = false;
 
 	return part_ptr;
 }
@@ -796,6 +809,33 @@ unpack_error:
 	return EFAULT;
 }
 
+static void _part_hash_identity(void *item, const char **key,
+				uint32_t *key_len)
+{
+	part_record_t *part_ptr = (part_record_t *) item;
+
+	*key = part_ptr->name;
+	*key_len = strlen(part_ptr->name);
+}
+
+static void _part_hash_build(void)
+{
+	ListIterator part_iterator;
+	part_record_t *part_ptr;
+
+	xhash_free(part_hash);
+	part_hash = xhash_init(_part_hash_identity, NULL);
+	part_iterator = list_iterator_create(part_list);
+	while ((part_ptr = list_next(part_iterator))) {
+		/* Keep the first record of a name, as list_find_part() */
+		if (part_ptr->name && !xhash_get_str(part_hash, part_ptr->name))
+			xhash_add(part_hash, part_ptr);
+	}
+	list_iterator_destroy(part_iterator);
+	part_hash_list = part_list;
+	part_hash_valid = true;
+}
+
 /*
  * find_part_record - find a record for partition with specified name
  * IN name - name of the desired partition
@@ -803,11 +843,22 @@ unpack_error:
  */
 part_record_t *find_part_record(char *name)
 {
+	part_record_t *part_ptr;
+
 	if (!part_list) {
 		error("part_list is NULL");
 		return NULL;
 	}
-	return list_find_first(part_list, &list_find_part, name);
+	if (!name)
+		return NULL;
+
+	slurm_mutex_lock(&part_hash_mutex);
+	if (!part_hash_valid || (part_hash_list != part_list))
+		_part_hash_build();
+	part_ptr = xhash_get_str(part_hash, name);
+	slurm_mutex_unlock(&part_hash_mutex);
+
+	return part_ptr;
 }
 
 /*
@@ -975,6 +1026,7 @@ static void _list_delete_part(void *part_entry)
 	int i, j, k;
 
 	part_ptr = (part_record_t *) part_entry;
+	part_hash_valid = false;
 	node_ptr = &node_record_table_ptr[0];
 	for (i = 0; i < node_record_count; i++, node_ptr++) {
 		for (j=0; j<node_ptr->part_cnt; j++) {
@@ -1970,6 +2022,11 @@ void load_part_uid_allow_list(int force)
 void part_fini (void)
 {
 	FREE_NULL_LIST(part_list);
+	slurm_mutex_lock(&part_hash_mutex);
+	xhash_free(part_hash);
+	part_hash_list = NULL;
+	part_hash_valid = false;
+	slurm_mutex_unlock(&part_hash_mutex);
 	xfree(default_part_name);
 	xfree(default_part.name);
 	default_part_loc = NULL;
@@ -68,6 +68,16 @@ typedef struct {
 	List preemptee_job_list;
 } preempt_candidates_t;
 
+/*
+ * Running and suspended jobs on a partition's nodes in preemption order.
+ * This does not depend upon the preemptor, so the candidates of each pending
+ * job are a filtered copy of it rather than a scan of job_list and a sort.
+ */
+typedef struct {
+	part_record_t *part_ptr;
+	List job_list;
+} preempt_part_cache_t;
+
 /*
  * Must be synchronized with slurm_preempt_ops_t above.
  */
@@ -82,6 +92,12 @@ static plugin_context_t *g_context = NULL;
 static pthread_mutex_t	    g_context_lock = PTHREAD_MUTEX_INITIALIZER;
 static bool init_run = false;
 
+static List preempt_cache = NULL;	/* preempt_part_cache_t records */
+static uint64_t preempt_cache_gen = 1;	/* changed by job start/end, QOS */
+static uint64_t preempt_cache_built_gen = 0;
+static time_t preempt_cache_part_update = 0;
+static pthread_mutex_t preempt_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static int _is_job_preempt_exempt_internal(void *x, void *key)
 {
 	job_record_t *preemptee_ptr = (job_record_t *)x;
@@ -155,22 +171,12 @@ static int _add_preemptable_job(void *x, void *arg)
 	preempt_candidates_t *candidates = (preempt_candidates_t *) arg;
 	job_record_t *preemptor = candidates->preemptor;
 
-	/*
-	 * We only want to look at the master component of a hetjob.  Since all
-	 * components have to be preemptable it should be here at some point.
-	 */
-	if (candidate->het_job_id && !candidate->het_job_list)
+	/* Already known to be running on the preemptor's partition */
+	if (!IS_JOB_RUNNING(candidate) && !IS_JOB_SUSPENDED(candidate))
 		return 0;
 
 	if (_is_job_preempt_exempt(candidate, preemptor))
 		return 0;
-	/*
-	 * We have to check the entire bitmap space here before we can check
-	 * each part of a hetjob in _is_job_preempt_exempt()
-	 */
-	if (!job_overlap_and_running(preemptor->part_ptr->node_bitmap,
-				     candidate))
-		return 0;
 
 	/* This job is a preemption candidate */
 	if (!candidates->preemptee_job_list)
@@ -201,6 +207,45 @@ static int _sort_by_prio(void *x, void *y)
 	return rc;
 }
 
+static void _preempt_part_cache_free(void *x)
+{
+	preempt_part_cache_t *cache = (preempt_part_cache_t *) x;
+
+	FREE_NULL_LIST(cache->job_list);
+	xfree(cache);
+}
+
+static int _preempt_part_cache_find(void *x, void *key)
+{
+	preempt_part_cache_t *cache = (preempt_part_cache_t *) x;
+
+	return (cache->part_ptr == (part_record_t *) key);
+}
+
+static int _add_part_job(void *x, void *arg)
+{
+	job_record_t *candidate = (job_record_t *) x;
+	preempt_part_cache_t *cache = (preempt_part_cache_t *) arg;
+
+	/*
+	 * We only want to look at the master component of a hetjob.  Since all
+	 * components have to be preemptable it should be here at some point.
+	 */
+	if (candidate->het_job_id && !candidate->het_job_list)
+		return 0;
+
+	/*
+	 * We have to check the entire bitmap space here before we can check
+	 * each part of a hetjob in _is_job_preempt_exempt()
+	 */
+	if (!job_overlap_and_running(cache->part_ptr->node_bitmap, candidate))
+		return 0;
+
+	list_append(cache->job_list, candidate);
+
+	return 0;
+}
+
 static int _sort_by_youngest(void *x, void *y)
 {
 	int rc;
@@ -217,6 +262,41 @@ static int _sort_by_youngest(void *x, void *y)
 	return rc;
 }
 
+/*
+ * Return the running and suspended jobs on part_ptr's nodes in preemption
+ * order, building the list if jobs started or ended since the last call.
+ * Call with preempt_cache_lock held.
+ */
+static List _preempt_part_jobs(part_record_t *part_ptr)
+{
+	preempt_part_cache_t *cache;
+
+	if ((preempt_cache_built_gen != preempt_cache_gen) ||
+	    (preempt_cache_part_update != last_part_update)) {
+		FREE_NULL_LIST(preempt_cache);
+		preempt_cache_built_gen = preempt_cache_gen;
+		preempt_cache_part_update = last_part_update;
+	}
+	if (!preempt_cache)
+		preempt_cache = list_create(_preempt_part_cache_free);
+
+	if ((cache = list_find_first(preempt_cache, _preempt_part_cache_find,
+				     part_ptr)))
+		return cache->job_list;
+
+	cache = xmalloc(sizeof(*cache));
+	cache->part_ptr = part_ptr;
+	cache->job_list = list_create(NULL);
+	list_for_each(job_list, _add_part_job, cache);
+	if (youngest_order)
+		list_sort(cache->job_list, _sort_by_youngest);
+	else
+		list_sort(cache->job_list, _sort_by_prio);
+	list_append(preempt_cache, cache);
+
+	return cache->job_list;
+}
+
 extern int slurm_preempt_init(void)
 {
 	int retval = SLURM_SUCCESS;
@@ -264,6 +344,9 @@ extern int slurm_preempt_fini(void)
 		return SLURM_SUCCESS;
 
 	init_run = false;
+	slurm_mutex_lock(&preempt_cache_lock);
+	FREE_NULL_LIST(preempt_cache);
+	slurm_mutex_unlock(&preempt_cache_lock);
 	rc = plugin_context_destroy(g_context);
 	g_context = NULL;
 	return rc;
@@ -294,17 +377,23 @@ extern List slurm_find_preemptable_jobs(job_record_t *job_ptr)
 
 	/* Build an array of pointers to preemption candidates */
 	if (slurm_preemption_enabled() ||
-	    job_uses_max_start_delay_resv(job_ptr))
-		list_for_each(job_list, _add_preemptable_job, &candidates);
-
-	if (candidates.preemptee_job_list && youngest_order)
-		list_sort(candidates.preemptee_job_list, _sort_by_youngest);
-	else if (candidates.preemptee_job_list)
-		list_sort(candidates.preemptee_job_list, _sort_by_prio);
+	    job_uses_max_start_delay_resv(job_ptr)) {
+		slurm_mutex_lock(&preempt_cache_lock);
+		list_for_each(_preempt_part_jobs(job_ptr->part_ptr),
+			      _add_preemptable_job, &candidates);
+		slurm_mutex_unlock(&preempt_cache_lock);
+	}
 
 	return candidates.preemptee_job_list;
 }
 
+extern void slurm_preempt_cache_clear(void)
+{
+	slurm_mutex_lock(&preempt_cache_lock);
+	preempt_cache_gen++;
+	slurm_mutex_unlock(&preempt_cache_lock);
+}
+
 /*
  * Return the PreemptMode which should apply to stop this job
  */
@@ -74,6 +74,12 @@ extern int slurm_preempt_fini(void);
  */
 extern List slurm_find_preemptable_jobs(job_record_t *job_ptr);
 
+/*
+ * Discard the cached per partition lists of preemption candidates. Call when
+ * a job starts, ends, changes size or its record is purged, or a QOS changes.
+ */
+extern void slurm_preempt_cache_clear(void);
+
 /*
  * Return the PreemptMode which should apply to stop this job
  */
@@ -109,11 +109,59 @@ static pthread_mutex_t rpc_mutex = PTHREAD_MUTEX_INITIALIZER;
 static uint16_t rpc_type_id[RPC_TYPE_SIZE] = { 0 };
 static uint32_t rpc_type_cnt[RPC_TYPE_SIZE] = { 0 };
 static uint64_t rpc_type_time[RPC_TYPE_SIZE] = { 0 };
+static uint64_t rpc_type_time_max[RPC_TYPE_SIZE] = { 0 };
+static uint64_t rpc_type_lock_wait[RPC_TYPE_SIZE] = { 0 };
+static uint64_t rpc_type_bytes_in[RPC_TYPE_SIZE] = { 0 };
+static uint64_t rpc_type_bytes_out[RPC_TYPE_SIZE] = { 0 };
+/* Latency histogram, 4 buckets per power of 2 usec, see _rpc_hist_bucket() */
+#define RPC_HIST_SIZE 128
+static uint32_t rpc_type_hist[RPC_TYPE_SIZE][RPC_HIST_SIZE];
 #define RPC_USER_SIZE 200
 static uint32_t rpc_user_id[RPC_USER_SIZE] = { 0 };
 static uint32_t rpc_user_cnt[RPC_USER_SIZE] = { 0 };
 static uint64_t rpc_user_time[RPC_USER_SIZE] = { 0 };
 
+/*
+ * Rolling per user cost ledger covering the last
+ * RPC_LEDGER_SLOTS * RPC_LEDGER_SLOT_SECS seconds. Slots are recycled as
+ * time moves on, rpc_ledger_start[] records the period each slot holds.
+ */
+#define RPC_LEDGER_SLOTS 5
+#define RPC_LEDGER_SLOT_SECS 60
+typedef struct {
+	uint32_t cnt;
+	uint64_t time;
+	uint64_t lock_wait;
+	uint64_t bytes;
+	uint32_t limited;	/* RPCs rejected by the rate limit */
+} rpc_cost_t;
+static time_t rpc_ledger_start[RPC_LEDGER_SLOTS] = { 0 };
+static rpc_cost_t rpc_user_ledger[RPC_USER_SIZE][RPC_LEDGER_SLOTS];
+
+/*
+ * Per user token buckets, one per rpc_rate_class_t. Tokens are kept in
+ * thousandths so refills between closely spaced RPCs are not lost.
+ */
+#define RL_DEFAULT_QUERY_BUCKET_SIZE	50
+#define RL_DEFAULT_QUERY_REFILL_RATE	5	/* tokens per second */
+#define RL_DEFAULT_SUBMIT_BUCKET_SIZE	100
+#define RL_DEFAULT_SUBMIT_REFILL_RATE	10
+#define RL_DEFAULT_TABLE_SIZE		8192
+typedef struct {
+	bool used;
+	uid_t uid;
+	struct timeval last_refill;
+	int64_t tokens[RPC_RATE_CLASSES];
+} rate_bucket_t;
+static pthread_mutex_t rate_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool rate_enabled = false;
+static int64_t rate_bucket_size[RPC_RATE_CLASSES] = { 0 };
+static int64_t rate_refill_rate[RPC_RATE_CLASSES] = { 0 };
+static rate_bucket_t *rate_table = NULL;
+static uint32_t rate_table_size = 0;
+/* Shared by the users which do not fit in rate_table */
+static rate_bucket_t rate_overflow = { .used = true };
+
 static config_response_msg_t *config_for_slurmd = NULL;
 static config_response_msg_t *config_for_clients = NULL;
 
@@ -153,8 +201,311 @@ extern diag_stats_t slurmctld_diag_stats;
 static __thread bool drop_priv = false;
 #endif
 
+/* Map a duration in usec to its rpc_type_hist[] bucket */
+static int _rpc_hist_bucket(uint64_t usec)
+{
+	int bits = 2;
+
+	if (usec < 4)
+		return usec;
+	while ((usec >> bits) > 1)
+		bits++;
+	/* usec is now 4..7 << (bits - 2) */
+	return MIN((bits - 1) * 4 + (usec >> (bits - 2)) - 4,
+		   RPC_HIST_SIZE - 1);
+}
+
+/* Largest duration in usec which maps to rpc_type_hist[] bucket inx */
+static uint64_t _rpc_hist_limit(int inx)
+{
+	inx++;
+	if (inx < 4)
+		return inx - 1;
+	return (((uint64_t) (4 + (inx % 4))) << (inx / 4 - 1)) - 1;
+}
+
+/* Return the latency in usec below which pct percent of the RPCs completed */
+static uint64_t _rpc_hist_percentile(int type_inx, int pct)
+{
+	uint64_t target, sum = 0;
+
+	target = ((uint64_t) rpc_type_cnt[type_inx] * pct + 99) / 100;
+	for (int i = 0; i < RPC_HIST_SIZE; i++) {
+		sum += rpc_type_hist[type_inx][i];
+		if (sum >= target)
+			return MIN(_rpc_hist_limit(i),
+				   rpc_type_time_max[type_inx]);
+	}
+	return rpc_type_time_max[type_inx];
+}
+
+/* Return the rpc_user_ledger[] slot for now, recycling it if stale */
+static int _rpc_ledger_slot(time_t now)
+{
+	time_t start = now - (now % RPC_LEDGER_SLOT_SECS);
+	int slot = (now / RPC_LEDGER_SLOT_SECS) % RPC_LEDGER_SLOTS;
+
+	if (rpc_ledger_start[slot] != start) {
+		rpc_ledger_start[slot] = start;
+		for (int i = 0; i < RPC_USER_SIZE; i++)
+			memset(&rpc_user_ledger[i][slot], 0,
+			       sizeof(rpc_cost_t));
+	}
+
+	return slot;
+}
+
+/* Sum the ledger slots of user inx which are inside the window */
+static void _rpc_ledger_sum(int inx, time_t now, rpc_cost_t *cost)
+{
+	memset(cost, 0, sizeof(*cost));
+	for (int i = 0; i < RPC_LEDGER_SLOTS; i++) {
+		if ((now - rpc_ledger_start[i]) >=
+		    (RPC_LEDGER_SLOTS * RPC_LEDGER_SLOT_SECS))
+			continue;
+		cost->cnt += rpc_user_ledger[inx][i].cnt;
+		cost->limited += rpc_user_ledger[inx][i].limited;
+		cost->time += rpc_user_ledger[inx][i].time;
+		cost->lock_wait += rpc_user_ledger[inx][i].lock_wait;
+		cost->bytes += rpc_user_ledger[inx][i].bytes;
+	}
+}
+
+/* Count an RPC rejected by the rate limit in the user's ledger */
+static void _record_rpc_limited(uid_t uid)
+{
+	int slot;
+
+	slurm_mutex_lock(&rpc_mutex);
+	slot = _rpc_ledger_slot(time(NULL));
+	for (int i = 0; i < RPC_USER_SIZE; i++) {
+		if ((rpc_user_id[i] == 0) && (i != 0))
+			rpc_user_id[i] = uid;
+		else if (rpc_user_id[i] != uid)
+			continue;
+		rpc_user_ledger[i][slot].limited++;
+		break;
+	}
+	slurm_mutex_unlock(&rpc_mutex);
+}
+
+/* Return the positive integer value of SlurmctldParameters option name */
+static int64_t _rate_limit_param(const char *name, int64_t def)
+{
+	char *tmp_ptr;
+	long value;
+
+	if (!(tmp_ptr = xstrcasestr(slurm_conf.slurmctld_params, name)))
+		return def;
+	value = strtol(tmp_ptr + strlen(name), NULL, 10);
+	if (value <= 0) {
+		error("Invalid SlurmctldParameters %s%ld, using %"PRId64,
+		      name, value, def);
+		return def;
+	}
+	return value;
+}
+
+extern void rpc_rate_limit_config(void)
+{
+	uint32_t table_size;
+
+	slurm_mutex_lock(&rate_mutex);
+	rate_enabled = xstrcasestr(slurm_conf.slurmctld_params, "rl_enable");
+	rate_bucket_size[RPC_RATE_QUERY] =
+		_rate_limit_param("rl_query_bucket_size=",
+				  RL_DEFAULT_QUERY_BUCKET_SIZE);
+	rate_refill_rate[RPC_RATE_QUERY] =
+		_rate_limit_param("rl_query_refill_rate=",
+				  RL_DEFAULT_QUERY_REFILL_RATE);
+	rate_bucket_size[RPC_RATE_SUBMIT] =
+		_rate_limit_param("rl_submit_bucket_size=",
+				  RL_DEFAULT_SUBMIT_BUCKET_SIZE);
+	rate_refill_rate[RPC_RATE_SUBMIT] =
+		_rate_limit_param("rl_submit_refill_rate=",
+				  RL_DEFAULT_SUBMIT_REFILL_RATE);
+	table_size = _rate_limit_param("rl_table_size=",
+				       RL_DEFAULT_TABLE_SIZE);
+
+	/* Existing buckets are kept and capped on their next refill */
+	if (!rate_enabled || (table_size != rate_table_size)) {
+		xfree(rate_table);
+		rate_table_size = 0;
+	}
+	if (rate_enabled && !rate_table) {
+		rate_table = xcalloc(table_size, sizeof(rate_bucket_t));
+		rate_table_size = table_size;
+		gettimeofday(&rate_overflow.last_refill, NULL);
+		for (int i = 0; i < RPC_RATE_CLASSES; i++)
+			rate_overflow.tokens[i] = rate_bucket_size[i] * 1000;
+	}
+
+	if (rate_enabled) {
+		info("RPC rate limit per user: query bucket %"PRId64" refill %"PRId64"/s, submit bucket %"PRId64" refill %"PRId64"/s, %u users",
+		     rate_bucket_size[RPC_RATE_QUERY],
+		     rate_refill_rate[RPC_RATE_QUERY],
+		     rate_bucket_size[RPC_RATE_SUBMIT],
+		     rate_refill_rate[RPC_RATE_SUBMIT], rate_table_size);
+	}
+	slurm_mutex_unlock(&rate_mutex);
+}
+
+/* Add the tokens earned since the last refill, RET true if all are full */
+static bool _rate_refill(rate_bucket_t *bucket, struct timeval *now)
+{
+	int64_t msec;
+	bool full = true;
+
+	msec = (now->tv_sec - bucket->last_refill.tv_sec) * 1000 +
+	       (now->tv_usec - bucket->last_refill.tv_usec) / 1000;
+	if (msec > 0) {
+		for (int i = 0; i < RPC_RATE_CLASSES; i++) {
+			bucket->tokens[i] += msec * rate_refill_rate[i];
+			bucket->tokens[i] = MIN(bucket->tokens[i],
+						rate_bucket_size[i] * 1000);
+		}
+		bucket->last_refill = *now;
+	} else if (msec < 0) {	/* clock went backwards */
+		bucket->last_refill = *now;
+	}
+
+	for (int i = 0; i < RPC_RATE_CLASSES; i++) {
+		if (bucket->tokens[i] < (rate_bucket_size[i] * 1000))
+			full = false;
+	}
+	return full;
+}
+
+/*
+ * Find or add the bucket of uid. A full bucket is the same as a new one, so
+ * the bucket of a user idle long enough to refill is reused for a new user.
+ * Users which still do not fit share rate_overflow.
+ */
+static rate_bucket_t *_rate_bucket(uid_t uid, struct timeval *now)
+{
+	rate_bucket_t *bucket = NULL, *idle = NULL;
+	uint32_t i;
+
+	for (i = 0; i < rate_table_size; i++) {
+		bucket = &rate_table[(uid + i) % rate_table_size];
+		if (!bucket->used)
+			break;
+		if (bucket->uid == uid) {
+			(void) _rate_refill(bucket, now);
+			return bucket;
+		}
+		if (!idle && _rate_refill(bucket, now))
+			idle = bucket;
+	}
+	/* Reuse before using a free slot, keeping probe sequences short */
+	if (idle)
+		bucket = idle;
+	else if (i >= rate_table_size) {
+		(void) _rate_refill(&rate_overflow, now);
+		return &rate_overflow;
+	}
+
+	bucket->used = true;
+	bucket->uid = uid;
+	bucket->last_refill = *now;
+	for (int j = 0; j < RPC_RATE_CLASSES; j++)
+		bucket->tokens[j] = rate_bucket_size[j] * 1000;
+	return bucket;
+}
+
+/*
+ * Tokens taken by an RPC, one per job for the bulk job RPCs. Jobs matched
+ * by the filters of a job list update are not known yet, the filters take
+ * one token.
+ */
+static int64_t _rate_cost(slurm_msg_t *msg)
+{
+	job_update_list_msg_t *update_list;
+	int64_t cost = 1;
+
+	if (!msg->data)
+		return cost;
+
+	switch (msg->msg_type) {
+	case REQUEST_SUBMIT_BATCH_JOB_LIST:
+		cost = list_count((List) msg->data);
+		break;
+	case REQUEST_UPDATE_JOB_LIST:
+		update_list = msg->data;
+		cost = 0;
+		if (update_list->job_id_list)
+			cost = list_count(update_list->job_id_list);
+		if (update_list->partition ||
+		    (update_list->state != NO_VAL) ||
+		    (update_list->user_id != NO_VAL))
+			cost++;
+		break;
+	default:
+		break;
+	}
+
+	return MAX(cost, 1);
+}
+
+extern bool rpc_rate_limit_exceeded(slurm_msg_t *msg)
+{
+	rpc_rate_class_t rate_class = RPC_RATE_NONE;
+	rate_bucket_t *bucket;
+	struct timeval now;
+	int64_t cost;
+	bool limited = false;
+
+	for (int i = 0; slurmctld_rpcs[i].msg_type; i++) {
+		if (slurmctld_rpcs[i].msg_type == msg->msg_type) {
+			rate_class = slurmctld_rpcs[i].rate_class;
+			break;
+		}
+	}
+	if ((rate_class == RPC_RATE_NONE) || validate_slurm_user(msg->auth_uid))
+		return false;
+
+	gettimeofday(&now, NULL);
+	slurm_mutex_lock(&rate_mutex);
+	if (!rate_enabled || !rate_table) {
+		slurm_mutex_unlock(&rate_mutex);
+		return false;
+	}
+
+	/* A request larger than the bucket needs a full bucket */
+	cost = MIN(_rate_cost(msg), rate_bucket_size[rate_class]) * 1000;
+	bucket = _rate_bucket(msg->auth_uid, &now);
+	if (bucket->tokens[rate_class] >= cost)
+		bucket->tokens[rate_class] -= cost;
+	else
+		limited = true;
+	slurm_mutex_unlock(&rate_mutex);
+
+	if (limited) {
+		log_flag(PROTOCOL, "%s: rate limited %s from uid=%u",
+			 __func__, rpc_num2string(msg->msg_type),
+			 msg->auth_uid);
+		_record_rpc_limited(msg->auth_uid);
+	}
+
+	return limited;
+}
+
+/*
+ * Record the cost of a processed RPC. The lock wait and bytes sent are taken
+ * from the calling thread's counters, which are reset.
+ */
 extern void record_rpc_stats(slurm_msg_t *msg, long delta)
 {
+	uint64_t bytes_in = 0, bytes_out, lock_wait;
+	rpc_cost_t *cost;
+	int slot;
+
+	delta = MAX(delta, 0);
+	lock_wait = lock_trace_wait();
+	bytes_out = slurm_get_thread_bytes_sent();
+	if (msg->buffer)
+		bytes_in = size_buf(msg->buffer);
+
 	slurm_mutex_lock(&rpc_mutex);
 	for (int i = 0; i < RPC_TYPE_SIZE; i++) {
 		if (rpc_type_id[i] == 0)
@@ -163,8 +514,14 @@ extern void record_rpc_stats(slurm_msg_t *msg, long delta)
 			continue;
 		rpc_type_cnt[i]++;
 		rpc_type_time[i] += delta;
+		rpc_type_time_max[i] = MAX(rpc_type_time_max[i], delta);
+		rpc_type_hist[i][_rpc_hist_bucket(delta)]++;
+		rpc_type_lock_wait[i] += lock_wait;
+		rpc_type_bytes_in[i] += bytes_in;
+		rpc_type_bytes_out[i] += bytes_out;
 		break;
 	}
+	slot = _rpc_ledger_slot(time(NULL));
 	for (int i = 0; i < RPC_USER_SIZE; i++) {
 		if ((rpc_user_id[i] == 0) && (i != 0))
 			rpc_user_id[i] = msg->auth_uid;
@@ -172,6 +529,11 @@ extern void record_rpc_stats(slurm_msg_t *msg, long delta)
 			continue;
 		rpc_user_cnt[i]++;
 		rpc_user_time[i] += delta;
+		cost = &rpc_user_ledger[i][slot];
+		cost->cnt++;
+		cost->time += delta;
+		cost->lock_wait += lock_wait;
+		cost->bytes += bytes_in + bytes_out;
 		break;
 	}
 	slurm_mutex_unlock(&rpc_mutex);
@@ -1050,6 +1412,14 @@ static void _slurm_rpc_allocate_het_job(slurm_msg_t * msg)
 	 */
 	_exclude_het_job_nodes(job_req_list);
 
+	/* Reject oversized requests before taking any locks */
+	iter = list_iterator_create(job_req_list);
+	while (!error_code && (job_desc_msg = list_next(iter)))
+		error_code = validate_job_desc_strings(job_desc_msg);
+	list_iterator_destroy(iter);
+	if (error_code)
+		goto send_msg;
+
 	het_job_cnt = list_count(job_req_list);
 	job_submit_user_msg = xmalloc(sizeof(char *) * het_job_cnt);
 	submit_job_list = list_create(NULL);
@@ -1300,6 +1670,10 @@ static void _slurm_rpc_allocate_resources(slurm_msg_t * msg)
 		      msg->auth_uid);
 	}
 
+	/* Reject oversized requests before taking any locks */
+	if (error_code == SLURM_SUCCESS)
+		error_code = validate_job_desc_strings(job_desc_msg);
+
 	if (error_code == SLURM_SUCCESS) {
 		/* Locks are for job_submit plugin use */
 		lock_slurmctld(job_read_lock);
@@ -2557,6 +2931,10 @@ static void _slurm_rpc_job_will_run(slurm_msg_t * msg)
 		      msg->auth_uid);
 	}
 
+	/* Reject oversized requests before taking any locks */
+	if (error_code == SLURM_SUCCESS)
+		error_code = validate_job_desc_strings(job_desc_msg);
+
 	if (error_code == SLURM_SUCCESS) {
 		/* Locks are for job_submit plugin use */
 		lock_slurmctld(job_read_lock);
@@ -3560,6 +3938,10 @@ static void _slurm_rpc_submit_batch_job(slurm_msg_t *msg)
 
 	dump_job_desc(job_desc_msg);
 
+	/* Reject oversized requests before taking any locks */
+	if (error_code == SLURM_SUCCESS)
+		error_code = validate_job_desc_strings(job_desc_msg);
+
 	if (error_code == SLURM_SUCCESS) {
 		/* Locks are for job_submit plugin use */
 		if (!(msg->flags & CTLD_QUEUE_PROCESSING))
@@ -3737,6 +4119,16 @@ static void _slurm_rpc_submit_batch_het_job(slurm_msg_t *msg)
 	 */
 	_exclude_het_job_nodes(job_req_list);
 
+	/* Reject oversized requests before taking any locks */
+	iter = list_iterator_create(job_req_list);
+	while (!error_code && (job_desc_msg = list_next(iter)))
+		error_code = validate_job_desc_strings(job_desc_msg);
+	list_iterator_destroy(iter);
+	if (error_code) {
+		reject_job = true;
+		goto send_msg;
+	}
+
 	/* Validate the individual request */
 	lock_slurmctld(job_read_lock);     /* Locks for job_submit plugin use */
 	iter = list_iterator_create(job_req_list);
@@ -3963,6 +4355,200 @@ send_msg:
 	xfree(job_submit_user_msg);
 }
 
+static void _free_submit_response(void *x)
+{
+	slurm_free_submit_response_response_msg(x);
+}
+
+/*
+ * Jobs of a REQUEST_SUBMIT_BATCH_JOB_LIST handled per lock hold, so a large
+ * list does not keep other RPCs and the schedulers off the locks
+ */
+#define SUBMIT_LIST_LOCK_CHUNK 64
+
+/*
+ * _slurm_rpc_submit_batch_job_list - process RPC to submit several
+ *	independent batch jobs. Jobs are validated and created in chunks of
+ *	SUBMIT_LIST_LOCK_CHUNK per lock hold, and each job gets its own
+ *	response so a bad request does not reject the others.
+ */
+static void _slurm_rpc_submit_batch_job_list(slurm_msg_t *msg)
+{
+	static int active_rpc_cnt = 0;
+	ListIterator iter, resp_iter;
+	int error_code;
+	int submit_cnt = 0, reject_cnt = 0, chunk_cnt = 0;
+	bool reject_job;
+	DEF_TIMERS;
+	uint32_t job_id;
+	job_record_t *job_ptr;
+	slurm_msg_t response_msg;
+	submit_response_msg_t *submit_msg;
+	job_desc_msg_t *job_desc_msg;
+	/* Locks: Read config, read job, read node, read partition, read fed */
+	slurmctld_lock_t job_read_lock = {
+		READ_LOCK, READ_LOCK, READ_LOCK, READ_LOCK, READ_LOCK };
+	/* Locks: Read config, write job, write node, read partition, read fed */
+	slurmctld_lock_t job_write_lock = {
+		READ_LOCK, WRITE_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK };
+	List job_req_list = (List) msg->data;
+	List resp_list;
+	gid_t gid = auth_g_get_gid(msg->auth_cred);
+	char *err_msg;
+
+	START_TIMER;
+	if (slurmctld_config.submissions_disabled) {
+		info("Submissions disabled on system");
+		slurm_send_rc_msg(msg, ESLURM_SUBMISSIONS_DISABLED);
+		return;
+	}
+	if (!job_req_list || (list_count(job_req_list) == 0)) {
+		info("REQUEST_SUBMIT_BATCH_JOB_LIST from uid=%u with empty job list",
+		     msg->auth_uid);
+		slurm_send_rc_msg(msg, SLURM_ERROR);
+		return;
+	}
+	/*
+	 * Sibling submission forwards the original message buffer, which
+	 * only works for single job RPCs. Clients fall back to submitting
+	 * the jobs one at a time.
+	 */
+	if (fed_mgr_fed_rec) {
+		info("REQUEST_SUBMIT_BATCH_JOB_LIST from uid=%u rejected in a federation",
+		     msg->auth_uid);
+		slurm_send_rc_msg(msg, ESLURM_NOT_SUPPORTED);
+		return;
+	}
+
+	/* Checks that need no locks */
+	resp_list = list_create(_free_submit_response);
+	iter = list_iterator_create(job_req_list);
+	while ((job_desc_msg = list_next(iter))) {
+		submit_msg = xmalloc(sizeof(*submit_msg));
+		submit_msg->step_id = SLURM_BATCH_SCRIPT;
+		list_append(resp_list, submit_msg);
+
+		if ((submit_msg->error_code =
+		     _valid_id("REQUEST_SUBMIT_BATCH_JOB_LIST", job_desc_msg,
+			       msg->auth_uid, gid)))
+			continue;
+
+		_set_hostname(msg, &job_desc_msg->alloc_node);
+		if ((job_desc_msg->alloc_node == NULL) ||
+		    (job_desc_msg->alloc_node[0] == '\0')) {
+			error("REQUEST_SUBMIT_BATCH_JOB_LIST lacks alloc_node from uid=%u",
+			      msg->auth_uid);
+			submit_msg->error_code = ESLURM_INVALID_NODE_NAME;
+			continue;
+		}
+
+		dump_job_desc(job_desc_msg);
+		submit_msg->error_code =
+			validate_job_desc_strings(job_desc_msg);
+	}
+	list_iterator_reset(iter);
+	resp_iter = list_iterator_create(resp_list);
+
+	/* Locks are for job_submit plugin use */
+	lock_slurmctld(job_read_lock);
+	while ((job_desc_msg = list_next(iter)) &&
+	       (submit_msg = list_next(resp_iter))) {
+		if (submit_msg->error_code)
+			continue;
+		if (++chunk_cnt > SUBMIT_LIST_LOCK_CHUNK) {
+			unlock_slurmctld(job_read_lock);
+			chunk_cnt = 1;
+			lock_slurmctld(job_read_lock);
+		}
+		job_desc_msg->het_job_offset = NO_VAL;
+		err_msg = NULL;
+		submit_msg->error_code =
+			validate_job_create_req(job_desc_msg, msg->auth_uid,
+						&err_msg);
+		submit_msg->job_submit_user_msg = err_msg;
+	}
+	unlock_slurmctld(job_read_lock);
+	list_iterator_reset(iter);
+	list_iterator_reset(resp_iter);
+
+	_throttle_start(&active_rpc_cnt);
+	lock_slurmctld(job_write_lock);
+	chunk_cnt = 0;
+	while ((job_desc_msg = list_next(iter)) &&
+	       (submit_msg = list_next(resp_iter))) {
+		if (submit_msg->error_code) {
+			reject_cnt++;
+			continue;
+		}
+		if (++chunk_cnt > SUBMIT_LIST_LOCK_CHUNK) {
+			unlock_slurmctld(job_write_lock);
+			chunk_cnt = 1;
+			lock_slurmctld(job_write_lock);
+		}
+
+		job_ptr = NULL;
+		job_id = 0;
+		err_msg = NULL;
+		reject_job = false;
+		job_desc_msg->het_job_offset = NO_VAL;
+		error_code = job_allocate(job_desc_msg,
+					  job_desc_msg->immediate,
+					  false, NULL, 0, msg->auth_uid, false,
+					  &job_ptr, &err_msg,
+					  msg->protocol_version);
+		if (!job_ptr ||
+		    (error_code && job_ptr->job_state == JOB_FAILED))
+			reject_job = true;
+		else
+			job_id = job_ptr->job_id;
+
+		if (job_desc_msg->immediate &&
+		    (error_code != SLURM_SUCCESS)) {
+			error_code = ESLURM_CAN_NOT_START_IMMEDIATELY;
+			reject_job = true;
+		}
+
+		if (reject_job) {
+			/* Keep the job submit message with the error */
+			if (err_msg && submit_msg->job_submit_user_msg) {
+				xstrfmtcat(submit_msg->job_submit_user_msg,
+					   "\n%s", err_msg);
+				xfree(err_msg);
+			} else if (err_msg) {
+				submit_msg->job_submit_user_msg = err_msg;
+			}
+			submit_msg->error_code =
+				error_code ? error_code : SLURM_ERROR;
+			reject_cnt++;
+		} else {
+			xfree(err_msg);
+			submit_msg->job_id = job_id;
+			submit_msg->error_code = error_code;
+			submit_cnt++;
+		}
+	}
+	unlock_slurmctld(job_write_lock);
+	_throttle_fini(&active_rpc_cnt);
+	list_iterator_destroy(iter);
+	list_iterator_destroy(resp_iter);
+	END_TIMER2("_slurm_rpc_submit_batch_job_list");
+
+	info("%s: submitted %d jobs, rejected %d jobs %s",
+	     __func__, submit_cnt, reject_cnt, TIME_STR);
+
+	response_init(&response_msg, msg);
+	response_msg.msg_type = RESPONSE_SUBMIT_BATCH_JOB_LIST;
+	response_msg.data = resp_list;
+	slurm_send_node_msg(msg->conn_fd, &response_msg);
+	FREE_NULL_LIST(resp_list);
+
+	if (submit_cnt) {
+		schedule_job_save();	/* Has own locks */
+		schedule_node_save();	/* Has own locks */
+		queue_job_scheduler();
+	}
+}
+
 /* _slurm_rpc_update_job - process RPC to update the configuration of a
  * job (e.g. priority)
  */
@@ -4077,6 +4663,54 @@ static void _slurm_rpc_update_job(slurm_msg_t * msg)
 	}
 }
 
+/*
+ * _slurm_rpc_update_job_list - process RPC to apply one update to many jobs
+ */
+static void _slurm_rpc_update_job_list(slurm_msg_t *msg)
+{
+	int error_code = SLURM_SUCCESS;
+	DEF_TIMERS;
+	job_update_list_msg_t *req = (job_update_list_msg_t *) msg->data;
+	job_desc_msg_t *job_desc_msg = req->job_desc;
+	uid_t uid = msg->auth_uid;
+	static int active_rpc_cnt = 0;
+
+	START_TIMER;
+	/* Same uid override handling as REQUEST_UPDATE_JOB */
+	if (job_desc_msg->user_id != NO_VAL) {
+		if (!validate_super_user(uid)) {
+			error("Security violation, REQUEST_UPDATE_JOB_LIST RPC from uid=%d",
+			      uid);
+			slurm_send_rc_msg(msg, ESLURM_USER_ID_MISSING);
+			return;
+		}
+		uid = job_desc_msg->user_id;
+	}
+
+	dump_job_desc(job_desc_msg);
+	/* Ensure everything that may be written to database is lower case */
+	xstrtolower(job_desc_msg->account);
+	xstrtolower(job_desc_msg->wckey);
+
+	_throttle_start(&active_rpc_cnt);
+	/* Sets its own locks, yielding them periodically */
+	error_code = update_job_list(msg, uid);
+	_throttle_fini(&active_rpc_cnt);
+	END_TIMER2("_slurm_rpc_update_job_list");
+
+	if (error_code) {
+		info("%s: uid=%d: %s",
+		     __func__, uid, slurm_strerror(error_code));
+		slurm_send_rc_msg(msg, error_code);
+	} else {
+		info("%s: complete uid=%d %s", __func__, uid, TIME_STR);
+		/* Below functions provide their own locking */
+		schedule_job_save();
+		schedule_node_save();
+		queue_job_scheduler();
+	}
+}
+
 /*
  * slurm_drain_nodes - process a request to drain a list of nodes,
  *	no-op for nodes already drained or draining
@@ -5334,16 +5968,29 @@ static void _clear_rpc_stats(void)
 	memset(rpc_type_cnt, 0, sizeof(rpc_type_cnt));
 	memset(rpc_type_id, 0, sizeof(rpc_type_id));
 	memset(rpc_type_time, 0, sizeof(rpc_type_time));
+	memset(rpc_type_time_max, 0, sizeof(rpc_type_time_max));
+	memset(rpc_type_lock_wait, 0, sizeof(rpc_type_lock_wait));
+	memset(rpc_type_bytes_in, 0, sizeof(rpc_type_bytes_in));
+	memset(rpc_type_bytes_out, 0, sizeof(rpc_type_bytes_out));
+	memset(rpc_type_hist, 0, sizeof(rpc_type_hist));
 	memset(rpc_user_cnt, 0, sizeof(rpc_user_cnt));
 	memset(rpc_user_id, 0, sizeof(rpc_user_id));
 	memset(rpc_user_time, 0, sizeof(rpc_user_time));
+	memset(rpc_ledger_start, 0, sizeof(rpc_ledger_start));
+	memset(rpc_user_ledger, 0, sizeof(rpc_user_ledger));
 	slurm_mutex_unlock(&rpc_mutex);
 }
 
 static void _pack_rpc_stats(int resp, char **buffer_ptr, int *buffer_size,
 			    uint16_t protocol_version)
 {
-	uint32_t i;
+	uint32_t i, type_cnt, user_cnt;
+	uint64_t *p50, *p99;
+	uint32_t *recent_cnt;
+	uint64_t *recent_time, *recent_lock_wait, *recent_bytes;
+	uint32_t *recent_limited;
+	rpc_cost_t cost;
+	time_t now = time(NULL);
 	buf_t *buffer;
 
 	slurm_mutex_lock(&rpc_mutex);
@@ -5359,6 +6006,7 @@ static void _pack_rpc_stats(int resp, char **buffer_ptr, int *buffer_size,
 		pack16_array(rpc_type_id,   i, buffer);
 		pack32_array(rpc_type_cnt,  i, buffer);
 		pack64_array(rpc_type_time, i, buffer);
+		type_cnt = i;
 
 		for (i = 1; i < RPC_USER_SIZE; i++) {
 			if (rpc_user_id[i] == 0)
@@ -5368,11 +6016,56 @@ static void _pack_rpc_stats(int resp, char **buffer_ptr, int *buffer_size,
 		pack32_array(rpc_user_id,   i, buffer);
 		pack32_array(rpc_user_cnt,  i, buffer);
 		pack64_array(rpc_user_time, i, buffer);
+		user_cnt = i;
 
 		agent_pack_pending_rpc_stats(buffer);
 
+		if (protocol_version < SLURM_21_08_PROTOCOL_VERSION)
+			goto end_it;
+
+		p50 = xcalloc(type_cnt, sizeof(uint64_t));
+		p99 = xcalloc(type_cnt, sizeof(uint64_t));
+		for (i = 0; i < type_cnt; i++) {
+			p50[i] = _rpc_hist_percentile(i, 50);
+			p99[i] = _rpc_hist_percentile(i, 99);
+		}
+		pack64_array(p50, type_cnt, buffer);
+		pack64_array(p99, type_cnt, buffer);
+		pack64_array(rpc_type_time_max, type_cnt, buffer);
+		pack64_array(rpc_type_lock_wait, type_cnt, buffer);
+		pack64_array(rpc_type_bytes_in, type_cnt, buffer);
+		pack64_array(rpc_type_bytes_out, type_cnt, buffer);
+		xfree(p50);
+		xfree(p99);
+
+		recent_cnt = xcalloc(user_cnt, sizeof(uint32_t));
+		recent_time = xcalloc(user_cnt, sizeof(uint64_t));
+		recent_lock_wait = xcalloc(user_cnt, sizeof(uint64_t));
+		recent_bytes = xcalloc(user_cnt, sizeof(uint64_t));
+		recent_limited = xcalloc(user_cnt, sizeof(uint32_t));
+		for (i = 0; i < user_cnt; i++) {
+			_rpc_ledger_sum(i, now, &cost);
+			recent_cnt[i] = cost.cnt;
+			recent_time[i] = cost.time;
+			recent_lock_wait[i] = cost.lock_wait;
+			recent_bytes[i] = cost.bytes;
+			recent_limited[i] = cost.limited;
+		}
+		pack32(RPC_LEDGER_SLOTS * RPC_LEDGER_SLOT_SECS, buffer);
+		pack32_array(recent_cnt, user_cnt, buffer);
+		pack64_array(recent_time, user_cnt, buffer);
+		pack64_array(recent_lock_wait, user_cnt, buffer);
+		pack64_array(recent_bytes, user_cnt, buffer);
+		pack32_array(recent_limited, user_cnt, buffer);
+		xfree(recent_cnt);
+		xfree(recent_time);
+		xfree(recent_lock_wait);
+		xfree(recent_bytes);
+		xfree(recent_limited);
 	}
 
+end_it:
+
 	slurm_mutex_unlock(&rpc_mutex);
 
 	*buffer_size = get_buf_offset(buffer);
@@ -5427,11 +6120,15 @@ static void _slurm_rpc_dump_stats(slurm_msg_t *msg)
 		_clear_rpc_stats();
 		pack_all_stat(0, &dump, &dump_size, msg->protocol_version);
 		_pack_rpc_stats(0, &dump, &dump_size, msg->protocol_version);
+		pack_sched_phase_stat(&dump, &dump_size, msg->protocol_version);
+		pack_lock_trace_stat(&dump, &dump_size, msg->protocol_version);
 		response_msg.data = dump;
 		response_msg.data_size = dump_size;
 	} else {
 		pack_all_stat(1, &dump, &dump_size, msg->protocol_version);
 		_pack_rpc_stats(1, &dump, &dump_size, msg->protocol_version);
+		pack_sched_phase_stat(&dump, &dump_size, msg->protocol_version);
+		pack_lock_trace_stat(&dump, &dump_size, msg->protocol_version);
 		response_msg.data = dump;
 		response_msg.data_size = dump_size;
 	}
@@ -6086,15 +6783,19 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	{
 		.msg_type = REQUEST_RESOURCE_ALLOCATION,
 		.func = _slurm_rpc_allocate_resources,
+		.rate_class = RPC_RATE_SUBMIT,
 	},{
 		.msg_type = REQUEST_HET_JOB_ALLOCATION,
 		.func = _slurm_rpc_allocate_het_job,
+		.rate_class = RPC_RATE_SUBMIT,
 	},{
 		.msg_type = REQUEST_BUILD_INFO,
 		.func = _slurm_rpc_dump_conf,
+		.rate_class = RPC_RATE_QUERY,
 	},{
 		.msg_type = REQUEST_JOB_INFO,
 		.func = _slurm_rpc_dump_jobs,
+		.rate_class = RPC_RATE_QUERY,
 		.queue_enabled = true,
 		.locks = {
 			.conf = READ_LOCK,
@@ -6105,6 +6806,7 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_JOB_USER_INFO,
 		.func = _slurm_rpc_dump_jobs_user,
+		.rate_class = RPC_RATE_QUERY,
 		.queue_enabled = true,
 		.locks = {
 			.conf = READ_LOCK,
@@ -6115,6 +6817,7 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_JOB_INFO_SINGLE,
 		.func = _slurm_rpc_dump_job_single,
+		.rate_class = RPC_RATE_QUERY,
 		.queue_enabled = true,
 		.locks = {
 			.conf = READ_LOCK,
@@ -6125,18 +6828,23 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_BATCH_SCRIPT,
 		.func = _slurm_rpc_dump_batch_script,
+		.rate_class = RPC_RATE_QUERY,
 	},{
 		.msg_type = REQUEST_SHARE_INFO,
 		.func = _slurm_rpc_get_shares,
+		.rate_class = RPC_RATE_QUERY,
 	},{
 		.msg_type = REQUEST_PRIORITY_FACTORS,
 		.func = _slurm_rpc_get_priority_factors,
+		.rate_class = RPC_RATE_QUERY,
 	},{
 		.msg_type = REQUEST_JOB_END_TIME,
 		.func = _slurm_rpc_end_time,
+		.rate_class = RPC_RATE_QUERY,
 	},{
 		.msg_type = REQUEST_FED_INFO,
 		.func = _slurm_rpc_get_fed,
+		.rate_class = RPC_RATE_QUERY,
 		.queue_enabled = true,
 		.locks = {
 			.fed = READ_LOCK,
@@ -6144,9 +6852,11 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_FRONT_END_INFO,
 		.func = _slurm_rpc_dump_front_end,
+		.rate_class = RPC_RATE_QUERY,
 	},{
 		.msg_type = REQUEST_NODE_INFO,
 		.func = _slurm_rpc_dump_nodes,
+		.rate_class = RPC_RATE_QUERY,
 		.queue_enabled = true,
 		.locks = {
 			.conf = READ_LOCK,
@@ -6156,9 +6866,11 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_NODE_INFO_SINGLE,
 		.func = _slurm_rpc_dump_node_single,
+		.rate_class = RPC_RATE_QUERY,
 	},{
 		.msg_type = REQUEST_PARTITION_INFO,
 		.func = _slurm_rpc_dump_partitions,
+		.rate_class = RPC_RATE_QUERY,
 		.queue_enabled = true,
 		.locks = {
 			.conf = READ_LOCK,
@@ -6200,9 +6912,11 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_JOB_STEP_INFO,
 		.func = _slurm_rpc_job_step_get_info,
+		.rate_class = RPC_RATE_QUERY,
 	},{
 		.msg_type = REQUEST_JOB_WILL_RUN,
 		.func = _slurm_rpc_job_will_run,
+		.rate_class = RPC_RATE_SUBMIT,
 	},{
 		.msg_type = REQUEST_SIB_JOB_LOCK,
 		.func = _slurm_rpc_sib_job_lock,
@@ -6256,6 +6970,7 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_SUBMIT_BATCH_JOB,
 		.func = _slurm_rpc_submit_batch_job,
+		.rate_class = RPC_RATE_SUBMIT,
 		.queue_enabled = true,
 		.locks = {
 			.conf = READ_LOCK,
@@ -6267,12 +6982,22 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_SUBMIT_BATCH_HET_JOB,
 		.func = _slurm_rpc_submit_batch_het_job,
+		.rate_class = RPC_RATE_SUBMIT,
+	},{
+		.msg_type = REQUEST_SUBMIT_BATCH_JOB_LIST,
+		.func = _slurm_rpc_submit_batch_job_list,
+		.rate_class = RPC_RATE_SUBMIT,
 	},{
 		.msg_type = REQUEST_UPDATE_FRONT_END,
 		.func = _slurm_rpc_update_front_end,
 	},{
 		.msg_type = REQUEST_UPDATE_JOB,
 		.func = _slurm_rpc_update_job,
+		.rate_class = RPC_RATE_SUBMIT,
+	},{
+		.msg_type = REQUEST_UPDATE_JOB_LIST,
+		.func = _slurm_rpc_update_job_list,
+		.rate_class = RPC_RATE_SUBMIT,
 	},{
 		.msg_type = REQUEST_UPDATE_NODE,
 		.func = _slurm_rpc_update_node,
@@ -6297,6 +7022,7 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_RESERVATION_INFO,
 		.func = _slurm_rpc_resv_show,
+		.rate_class = RPC_RATE_QUERY,
 	},{
 		.msg_type = REQUEST_NODE_REGISTRATION_STATUS,
 		.func = _slurm_rpc_node_registration_status,
@@ -6306,18 +7032,21 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_TOP_JOB,
 		.func = _slurm_rpc_top_job,
+		.rate_class = RPC_RATE_SUBMIT,
 	},{
 		.msg_type = REQUEST_AUTH_TOKEN,
 		.func = _slurm_rpc_auth_token,
 	},{
 		.msg_type = REQUEST_JOB_REQUEUE,
 		.func = _slurm_rpc_requeue,
+		.rate_class = RPC_RATE_SUBMIT,
 	},{
 		.msg_type = REQUEST_JOB_READY,
 		.func = _slurm_rpc_job_ready,
 	},{
 		.msg_type = REQUEST_BURST_BUFFER_INFO,
 		.func = _slurm_rpc_burst_buffer_info,
+		.rate_class = RPC_RATE_QUERY,
 	},{
 		.msg_type = REQUEST_STEP_COMPLETE,
 		.func = _slurm_rpc_step_complete,
@@ -6342,6 +7071,7 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_TRIGGER_GET,
 		.func = _slurm_rpc_trigger_get,
+		.rate_class = RPC_RATE_QUERY,
 	},{
 		.msg_type = REQUEST_TRIGGER_CLEAR,
 		.func = _slurm_rpc_trigger_clear,
@@ -6372,21 +7102,26 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_TOPO_INFO,
 		.func = _slurm_rpc_get_topo,
+		.rate_class = RPC_RATE_QUERY,
 	},{
 		.msg_type = REQUEST_REBOOT_NODES,
 		.func = _slurm_rpc_reboot_nodes,
 	},{
 		.msg_type = REQUEST_STATS_INFO,
 		.func = _slurm_rpc_dump_stats,
+		.rate_class = RPC_RATE_QUERY,
 	},{
 		.msg_type = REQUEST_LICENSE_INFO,
 		.func = _slurm_rpc_dump_licenses,
+		.rate_class = RPC_RATE_QUERY,
 	},{
+		/* Not limited, cancelling jobs only reduces load */
 		.msg_type = REQUEST_KILL_JOB,
 		.func = _slurm_rpc_kill_job,
 	},{
 		.msg_type = REQUEST_ASSOC_MGR_INFO,
 		.func = _slurm_rpc_assoc_mgr_info,
+		.rate_class = RPC_RATE_QUERY,
 	},{
 		.msg_type = REQUEST_PERSIST_INIT,
 		.func = _slurm_rpc_persist_init,
@@ -6399,6 +7134,7 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_BURST_BUFFER_STATUS,
 		.func = _slurm_rpc_burst_buffer_status,
+		.rate_class = RPC_RATE_QUERY,
 	},{
 		.msg_type = REQUEST_CRONTAB,
 		.func = _slurm_rpc_request_crontab,
@@ -6462,9 +7198,13 @@ void slurmctld_req(slurm_msg_t *msg)
 	}
 
 	if (this_rpc) {
+		/* Discard counters left by earlier work of this thread */
+		(void) lock_trace_wait();
+		(void) slurm_get_thread_bytes_sent();
 		(*(this_rpc->func))(msg);
 		END_TIMER;
 		record_rpc_stats(msg, DELTA_TIMER);
+		sched_phase_flush();
 	} else {
 		error("invalid RPC msg_type=%u", msg->msg_type);
 		slurm_send_rc_msg(msg, EINVAL);
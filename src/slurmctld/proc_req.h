@@ -45,10 +45,19 @@
 
 #include "src/slurmctld/locks.h"
 
+/* Token bucket a user's RPC draws from, see SlurmctldParameters=rl_* */
+typedef enum {
+	RPC_RATE_NONE,		/* not rate limited */
+	RPC_RATE_QUERY,		/* information requests */
+	RPC_RATE_SUBMIT,	/* job submission and modification */
+	RPC_RATE_CLASSES
+} rpc_rate_class_t;
+
 typedef struct {
 	uint16_t msg_type;
 	void (*func)(slurm_msg_t *msg);
 	slurmctld_lock_t locks;
+	rpc_rate_class_t rate_class;
 
 	/* Queue structual elements */
 	char *msg_name; /* automatically derived from msg_type */
@@ -76,6 +85,16 @@ void slurmctld_req(slurm_msg_t *msg);
  */
 extern void record_rpc_stats(slurm_msg_t *msg, long delta);
 
+/* (Re)load the RPC rate limits from SlurmctldParameters */
+extern void rpc_rate_limit_config(void);
+
+/*
+ * Take a token from the bucket of the sending user for this RPC type
+ * RET true if the bucket is empty and the RPC must be rejected with
+ *	SLURMCTLD_COMMUNICATIONS_BACKOFF
+ */
+extern bool rpc_rate_limit_exceeded(slurm_msg_t *msg);
+
 /*
  * Initialize a response slurm_msg_t to an inbound msg,
  * first by calling slurm_msg_t_init(), then by copying
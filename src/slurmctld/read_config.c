@@ -1320,6 +1320,7 @@ int read_slurm_conf(int recover, bool reconfig)
 
 	_sync_part_prio();
 	_build_bitmaps_pre_select();
+	slurm_preempt_cache_clear();
 	if ((select_g_node_init(node_record_table_ptr, node_record_count)
 	     != SLURM_SUCCESS)						||
 	    (select_g_state_restore(state_save_dir) != SLURM_SUCCESS)	||
@@ -1505,6 +1506,9 @@ int read_slurm_conf(int recover, bool reconfig)
 		fatal("Failed to reconfigure mcs plugin");
 
 	_set_response_cluster_rec();
+	rpc_rate_limit_config();
+	lock_trace_set_enabled(xstrcasestr(slurm_conf.slurmctld_params,
+					   "lock_trace"));
 
 	slurm_conf.last_update = time(NULL);
 end_it:
@@ -68,6 +68,7 @@
 #include "src/common/slurm_time.h"
 #include "src/common/uid.h"
 #include "src/common/xassert.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
@@ -123,6 +124,37 @@ List      resv_list = (List) NULL;
 static List magnetic_resv_list = NULL;
 uint32_t  top_suffix = 0;
 
+/*
+ * Time index of resv_list used by job_test_resv() to find the reservations
+ * overlapping a job's time window without testing every reservation.
+ * Floating reservations move with the current time and are always tested.
+ */
+typedef struct resv_index {
+	slurmctld_resv_t *resv_ptr;
+	time_t start_relative;
+	time_t end_relative;
+	int pos;		/* position in resv_list */
+} resv_index_t;
+
+static slurmctld_resv_t **resv_index_list = NULL; /* by resv_list position */
+static resv_index_t *resv_index = NULL;	/* not floating, by start time */
+static int *resv_index_float = NULL;	/* positions of floating resv */
+static int *resv_index_match = NULL;	/* scratch for query results */
+static int resv_index_list_cnt = 0, resv_index_cnt = 0;
+static int resv_index_float_cnt = 0;
+static uint32_t resv_index_max_boot = 0;
+static time_t resv_index_expire = 0;	/* rebuild when a resv ends */
+static bool resv_index_valid = false;
+
+/*
+ * Name index of resv_list for find_resv_name(), rebuilt on first use after a
+ * reservation is added or freed. Lookups may happen under a read lock, so
+ * resv_hash_mutex serializes the rebuild.
+ */
+static pthread_mutex_t resv_hash_mutex = PTHREAD_MUTEX_INITIALIZER;
+static xhash_t *resv_hash = NULL;
+static bool resv_hash_valid = false;
+
 /*
  * the two following structs enable to build a
  * planning of a constraint evolution over time
@@ -152,6 +184,7 @@ static uint32_t _max_constraint_planning(constraint_planning_t* sched,
 
 
 static int _advance_resv_time(slurmctld_resv_t *resv_ptr);
+static void _resv_index_free(void);
 static void _advance_time(time_t *res_time, int day_cnt);
 static int  _build_account_list(char *accounts, int *account_cnt,
 				char ***account_list, bool *account_not);
@@ -163,7 +196,6 @@ static void _del_resv_rec(void *x);
 static void _dump_resv_req(resv_desc_msg_t *resv_ptr, char *mode);
 static int  _find_resv_id(void *x, void *key);
 static int _find_resv_ptr(void *x, void *key);
-static int  _find_resv_name(void *x, void *key);
 static void *_fork_script(void *x);
 static void _free_script_arg(resv_thread_args_t *args);
 static int  _generate_resv_id(void);
@@ -361,6 +393,9 @@ static void _restore_resv(slurmctld_resv_t *dest_resv,
 {
 	int i;
 
+	/* Times and flags change, rebuild the time index */
+	resv_index_valid = false;
+
 	xfree(dest_resv->accounts);
 	dest_resv->accounts = src_resv->accounts;
 	src_resv->accounts = NULL;
@@ -470,6 +505,8 @@ static void _del_resv_rec(void *x)
 	slurmctld_resv_t *resv_ptr = (slurmctld_resv_t *) x;
 
 	if (resv_ptr) {
+		resv_index_valid = false;
+		resv_hash_valid = false;
 		/*
 		 * If shutting down magnetic_resv_list is already freed, meaning
 		 * we don't need to remove anything from it.
@@ -524,6 +561,8 @@ static void _add_resv_to_lists(slurmctld_resv_t *resv_ptr)
 	xassert(resv_list);
 	xassert(magnetic_resv_list);
 
+	resv_index_valid = false;
+	resv_hash_valid = false;
 	list_append(resv_list, resv_ptr);
 	if (resv_ptr->flags & RESERVE_FLAG_MAGNETIC)
 		list_append(magnetic_resv_list, resv_ptr);
@@ -594,18 +633,6 @@ static int _find_resv_ptr(void *x, void *key)
 		return 1;	/* match */
 }
 
-static int _find_resv_name(void *x, void *key)
-{
-	slurmctld_resv_t *resv_ptr = (slurmctld_resv_t *) x;
-
-	xassert(resv_ptr->magic == RESV_MAGIC);
-
-	if (xstrcmp(resv_ptr->name, (char *) key))
-		return 0;
-	else
-		return 1;	/* match */
-}
-
 static int _foreach_clear_job_resv(void *x, void *key)
 {
 	job_record_t *job_ptr = (job_record_t *) x;
@@ -1093,6 +1120,7 @@ static int _post_resv_update(slurmctld_resv_t *resv_ptr,
 	if ((resv_ptr->start_time < now) && change) {
 		resv_ptr->start_time_prev = resv_ptr->start_time;
 		resv_ptr->start_time = now;
+		resv_index_valid = false;
 	}
 
 	/* now set the (maybe new) start_times */
@@ -2869,6 +2897,11 @@ extern void resv_fini(void)
 {
 	FREE_NULL_LIST(magnetic_resv_list);
 	FREE_NULL_LIST(resv_list);
+	_resv_index_free();
+	slurm_mutex_lock(&resv_hash_mutex);
+	xhash_free(resv_hash);
+	resv_hash_valid = false;
+	slurm_mutex_unlock(&resv_hash_mutex);
 }
 
 /* Update an exiting resource reservation */
@@ -2903,6 +2936,12 @@ extern int update_resv(resv_desc_msg_t *resv_desc_ptr)
 	/* Make backup to restore state in case of failure */
 	resv_backup = _copy_resv(resv_ptr);
 
+	/*
+	 * The times, duration and flags (e.g. TIME_FLOAT) the time index is
+	 * built from are changed in place below
+	 */
+	resv_index_valid = false;
+
 	/* Process the request */
 	if (resv_desc_ptr->flags != NO_VAL64) {
 		if (resv_desc_ptr->flags & RESERVE_FLAG_FLEX)
@@ -3460,12 +3499,46 @@ extern int delete_resv(reservation_name_msg_t *resv_desc_ptr)
 	return rc;
 }
 
+static void _resv_hash_identity(void *item, const char **key,
+				uint32_t *key_len)
+{
+	slurmctld_resv_t *resv_ptr = (slurmctld_resv_t *) item;
+
+	*key = resv_ptr->name;
+	*key_len = strlen(resv_ptr->name);
+}
+
+static void _resv_hash_build(void)
+{
+	ListIterator iter;
+	slurmctld_resv_t *resv_ptr;
+
+	xhash_free(resv_hash);
+	resv_hash = xhash_init(_resv_hash_identity, NULL);
+	iter = list_iterator_create(resv_list);
+	while ((resv_ptr = list_next(iter))) {
+		/* Keep the first record of a name, as a list scan would */
+		if (resv_ptr->name && !xhash_get_str(resv_hash, resv_ptr->name))
+			xhash_add(resv_hash, resv_ptr);
+	}
+	list_iterator_destroy(iter);
+	resv_hash_valid = true;
+}
+
 /* Return pointer to the named reservation or NULL if not found */
 extern slurmctld_resv_t *find_resv_name(char *resv_name)
 {
 	slurmctld_resv_t *resv_ptr;
-	resv_ptr = (slurmctld_resv_t *) list_find_first (resv_list,
-			_find_resv_name, resv_name);
+
+	if (!resv_list || !resv_name)
+		return NULL;
+
+	slurm_mutex_lock(&resv_hash_mutex);
+	if (!resv_hash_valid)
+		_resv_hash_build();
+	resv_ptr = xhash_get_str(resv_hash, resv_name);
+	slurm_mutex_unlock(&resv_hash_mutex);
+
 	return resv_ptr;
 }
 
@@ -6044,6 +6117,122 @@ static void _get_rel_start_end(slurmctld_resv_t *resv_ptr, time_t now,
 	}
 }
 
+static void _resv_index_free(void)
+{
+	xfree(resv_index_list);
+	xfree(resv_index);
+	xfree(resv_index_float);
+	xfree(resv_index_match);
+	resv_index_list_cnt = resv_index_cnt = resv_index_float_cnt = 0;
+	resv_index_valid = false;
+}
+
+static int _resv_index_start_sort(const void *x, const void *y)
+{
+	const resv_index_t *r1 = x, *r2 = y;
+
+	if (r1->start_relative < r2->start_relative)
+		return -1;
+	if (r1->start_relative > r2->start_relative)
+		return 1;
+	return 0;
+}
+
+static int _resv_index_pos_sort(const void *x, const void *y)
+{
+	return *(const int *) x - *(const int *) y;
+}
+
+/*
+ * Rebuild the reservation time index. Expired reservations are advanced here
+ * (by _get_rel_start_end()) rather than on every job test, so the index is
+ * rebuilt whenever a reservation in it reaches its end time.
+ */
+static void _resv_index_build(time_t now)
+{
+	ListIterator iter;
+	slurmctld_resv_t *resv_ptr;
+	resv_index_t *index;
+	int cnt, pos = 0;
+
+	_resv_index_free();
+	resv_index_max_boot = 0;
+	resv_index_expire = 0;
+
+	cnt = list_count(resv_list);
+	resv_index_list = xcalloc(cnt + 1, sizeof(slurmctld_resv_t *));
+	resv_index = xcalloc(cnt + 1, sizeof(resv_index_t));
+	resv_index_float = xcalloc(cnt + 1, sizeof(int));
+	resv_index_match = xcalloc(cnt + 1, sizeof(int));
+
+	iter = list_iterator_create(resv_list);
+	while ((resv_ptr = list_next(iter))) {
+		resv_index_list[pos] = resv_ptr;
+		resv_index_max_boot = MAX(resv_index_max_boot,
+					  resv_ptr->boot_time);
+		if (resv_ptr->flags & RESERVE_FLAG_TIME_FLOAT) {
+			resv_index_float[resv_index_float_cnt++] = pos++;
+			continue;
+		}
+		index = &resv_index[resv_index_cnt++];
+		index->resv_ptr = resv_ptr;
+		index->pos = pos++;
+		_get_rel_start_end(resv_ptr, now, &index->start_relative,
+				   &index->end_relative);
+		if ((index->end_relative > now) &&
+		    (!resv_index_expire ||
+		     (index->end_relative < resv_index_expire)))
+			resv_index_expire = index->end_relative;
+	}
+	list_iterator_destroy(iter);
+	resv_index_list_cnt = pos;
+
+	qsort(resv_index, resv_index_cnt, sizeof(resv_index_t),
+	      _resv_index_start_sort);
+	resv_index_valid = true;
+}
+
+/*
+ * Find the reservations which may overlap the time window from start_time to
+ * end_time (extended by the longest reservation boot time if reboot is set).
+ * Results are a superset; callers still test each reservation's times.
+ * RET count of positions in resv_list put into resv_index_match, in list order
+ */
+static int _resv_index_overlap(time_t now, time_t start_time, time_t end_time,
+			       bool reboot)
+{
+	int lo = 0, hi, mid, i, match_cnt = 0;
+
+	if (!resv_index_valid ||
+	    (resv_index_expire && (now >= resv_index_expire)))
+		_resv_index_build(now);
+
+	if (reboot)
+		end_time += resv_index_max_boot;
+
+	/* First reservation starting at or after end_time */
+	hi = resv_index_cnt;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (resv_index[mid].start_relative < end_time)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (i = 0; i < lo; i++) {
+		if (resv_index[i].end_relative > start_time)
+			resv_index_match[match_cnt++] = resv_index[i].pos;
+	}
+	for (i = 0; i < resv_index_float_cnt; i++)
+		resv_index_match[match_cnt++] = resv_index_float[i];
+
+	/* Preserve resv_list order, the first matching reservation wins */
+	qsort(resv_index_match, match_cnt, sizeof(int), _resv_index_pos_sort);
+
+	return match_cnt;
+}
+
 /*
  * Determine how many watts the specified job is prevented from using
  * due to reservations
@@ -6133,17 +6322,16 @@ extern uint32_t job_test_watts_resv(job_record_t *job_ptr, time_t when,
  *	ESLURM_RESERVATION_MAINT job has no reservation, but required nodes are
  *				 in maintenance reservation
  */
-extern int job_test_resv(job_record_t *job_ptr, time_t *when,
-			 bool move_time, bitstr_t **node_bitmap,
-			 bitstr_t **exc_core_bitmap, bool *resv_overlap,
-			 bool reboot)
+static int _job_test_resv(job_record_t *job_ptr, time_t *when,
+			  bool move_time, bitstr_t **node_bitmap,
+			  bitstr_t **exc_core_bitmap, bool *resv_overlap,
+			  bool reboot)
 {
 	slurmctld_resv_t *resv_ptr = NULL, *res2_ptr;
 	time_t job_start_time, job_end_time, job_end_time_use, lic_resv_time;
 	time_t start_relative, end_relative;
 	time_t now = time(NULL);
-	ListIterator iter;
-	int i, rc = SLURM_SUCCESS, rc2;
+	int i, j, match_cnt, rc = SLURM_SUCCESS, rc2;
 
 	*resv_overlap = false;	/* initialize to false */
 	job_start_time = *when;
@@ -6228,8 +6416,10 @@ extern int job_test_resv(job_record_t *job_ptr, time_t *when,
 		 * if there are any overlapping reservations, we need to
 		 * prevent the job from using those nodes (e.g. MAINT nodes)
 		 */
-		iter = list_iterator_create(resv_list);
-		while ((res2_ptr = list_next(iter))) {
+		match_cnt = _resv_index_overlap(now, job_start_time,
+						job_end_time, reboot);
+		for (j = 0; j < match_cnt; j++) {
+			res2_ptr = resv_index_list[resv_index_match[j]];
 			if (reboot)
 				job_end_time_use =
 					job_end_time + res2_ptr->boot_time;
@@ -6259,7 +6449,6 @@ extern int job_test_resv(job_record_t *job_ptr, time_t *when,
 				bit_and_not(*node_bitmap,res2_ptr->node_bitmap);
 			}
 		}
-		list_iterator_destroy(iter);
 
 		if (slurm_conf.debug_flags & DEBUG_FLAG_RESERVATION) {
 			char *nodes = bitmap2node_name(*node_bitmap);
@@ -6294,8 +6483,10 @@ extern int job_test_resv(job_record_t *job_ptr, time_t *when,
 	for (i = 0; ; i++) {
 		lic_resv_time = (time_t) 0;
 
-		iter = list_iterator_create(resv_list);
-		while ((resv_ptr = list_next(iter))) {
+		match_cnt = _resv_index_overlap(now, job_start_time,
+						job_end_time, reboot);
+		for (j = 0; j < match_cnt; j++) {
+			resv_ptr = resv_index_list[resv_index_match[j]];
 			_get_rel_start_end(
 				resv_ptr, now, &start_relative, &end_relative);
 
@@ -6384,7 +6575,6 @@ extern int job_test_resv(job_record_t *job_ptr, time_t *when,
 				continue;
 			}
 		}
-		list_iterator_destroy(iter);
 
 		if ((rc == SLURM_SUCCESS) && move_time) {
 			if (license_job_test(job_ptr, job_start_time, reboot)
@@ -6419,6 +6609,23 @@ extern int job_test_resv(job_record_t *job_ptr, time_t *when,
 	return rc;
 }
 
+/* job_test_resv - see _job_test_resv(), timed for sdiag */
+extern int job_test_resv(job_record_t *job_ptr, time_t *when,
+			 bool move_time, bitstr_t **node_bitmap,
+			 bitstr_t **exc_core_bitmap, bool *resv_overlap,
+			 bool reboot)
+{
+	struct timeval tv;
+	int rc;
+
+	SCHED_PHASE_START(tv);
+	rc = _job_test_resv(job_ptr, when, move_time, node_bitmap,
+			    exc_core_bitmap, resv_overlap, reboot);
+	SCHED_PHASE_END(tv, SCHED_PHASE_JOB_TEST_RESV);
+
+	return rc;
+}
+
 static int _update_resv_group_uid_access_list(void *x, void *arg)
 {
 	slurmctld_resv_t *resv_ptr = (slurmctld_resv_t *)x;
@@ -6628,6 +6835,7 @@ static int _advance_resv_time(slurmctld_resv_t *resv_ptr)
 			__func__, resv_ptr->name, day_cnt,
 			(day_cnt > 1 ? "s" : ""));
 
+		resv_index_valid = false;
 		resv_ptr->start_time = resv_ptr->start_time_first;
 		_advance_time(&resv_ptr->start_time, day_cnt);
 		resv_ptr->start_time_prev = resv_ptr->start_time;
@@ -152,6 +152,7 @@ typedef struct slurmctld_config {
 	pthread_t thread_id_power;
 	pthread_t thread_id_purge_files;
 	pthread_t thread_id_rpc;
+	pthread_t thread_id_script_write;
 } slurmctld_config_t;
 
 /* Job scheduling statistics */
@@ -197,6 +198,38 @@ typedef struct diag_stats {
 	uint32_t latency;
 } diag_stats_t;
 
+/*
+ * Scheduler phases timed for sdiag. Phases nest, so select_nodes time
+ * includes the job_test_resv, license_job_test and gres_select time spent
+ * underneath it. Lock waits are only recorded when the lock is contended.
+ */
+typedef enum {
+	SCHED_PHASE_BUILD_JOB_QUEUE,
+	SCHED_PHASE_ACCT_POLICY,
+	SCHED_PHASE_SELECT_NODES,
+	SCHED_PHASE_JOB_TEST_RESV,
+	SCHED_PHASE_LICENSE_TEST,
+	SCHED_PHASE_GRES_SELECT,
+	SCHED_PHASE_LOCK_CONF,
+	SCHED_PHASE_LOCK_JOB,
+	SCHED_PHASE_LOCK_NODE,
+	SCHED_PHASE_LOCK_PART,
+	SCHED_PHASE_LOCK_FED,
+	SCHED_PHASE_COUNT
+} sched_phase_t;
+
+/* Thread the scheduler phase time is charged to */
+typedef enum {
+	SCHED_CTX_OTHER,	/* RPC and agent threads */
+	SCHED_CTX_MAIN,		/* main scheduling loop, _schedule() */
+	SCHED_CTX_BACKFILL,	/* backfill scheduler thread */
+	SCHED_CTX_COUNT
+} sched_ctx_t;
+
+#define SCHED_PHASE_START(tv)	gettimeofday(&(tv), NULL)
+#define SCHED_PHASE_END(tv, phase) \
+	sched_phase_record(phase, slurm_delta_tv(&(tv)))
+
 typedef struct {
 	int index;
 	bool shutdown;
@@ -710,6 +743,11 @@ struct job_record {
 	uint64_t db_index;              /* used only for database plugins */
 	time_t deadline;		/* deadline */
 	uint32_t delay_boot;		/* Delay boot for desired node mode */
+	time_t depend_test_time;	/* time test_job_dependency() last
+					 * cached a LOCAL_DEPEND result, zero
+					 * when a depended upon job changed
+					 * state (Internal use only, don't
+					 * save) */
 	uint32_t derived_ec;		/* highest exit code of all job steps */
 	struct job_details *details;	/* job details */
 	uint16_t direct_set_prio;	/* Priority set directly if
@@ -824,6 +862,9 @@ struct job_record {
 	uint32_t requid;	    	/* requester user ID */
 	char *resp_host;		/* host for srun communications */
 	char *sched_nodes;		/* list of nodes scheduled for job */
+	uint64_t script_write_seq;	/* queued batch script write, zero once
+					 * written (Internal use only, don't
+					 * save) */
 	dynamic_plugin_data_t *select_jobinfo;/* opaque data, BlueGene */
 	uint32_t site_factor;		/* factor to consider in priority */
 	char **spank_job_env;		/* environment variables for job prolog
@@ -1983,6 +2024,20 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 			  uint16_t protocol_version);
 
+/*
+ * Append the scheduler phase timers and histograms to a buffer built by
+ * pack_all_stat()
+ */
+extern void pack_sched_phase_stat(char **buffer_ptr, int *buffer_size,
+				  uint16_t protocol_version);
+
+/*
+ * Append the slurmctld and assoc_mgr lock contention statistics and current
+ * lock holders to a buffer built by pack_all_stat()
+ */
+extern void pack_lock_trace_stat(char **buffer_ptr, int *buffer_size,
+				 uint16_t protocol_version);
+
 /*
  * pack_ctld_job_step_info_response_msg - packs job step info
  * IN job_id - specific id or NO_VAL for all
@@ -2221,6 +2276,25 @@ extern void reset_node_free_mem(char *node_name, uint64_t free_mem);
  * level IN - clear backfilled_jobs count if set */
 extern void reset_stats(int level);
 
+/*
+ * Charge usec of scheduler phase to the calling thread's context.
+ * Use through SCHED_PHASE_START() and SCHED_PHASE_END(). The time is kept
+ * per thread until sched_phase_flush() is called.
+ */
+extern void sched_phase_record(sched_phase_t phase, long usec);
+
+/*
+ * Publish the scheduler phase times gathered by the calling thread.
+ * Call at the end of each scheduling pass or RPC.
+ */
+extern void sched_phase_flush(void);
+
+/*
+ * Set the context the calling thread's scheduler phases are charged to
+ * RET previous context of this thread
+ */
+extern sched_ctx_t sched_phase_set_ctx(sched_ctx_t ctx);
+
 /*
  * restore_node_features - Make node and config (from slurm.conf) fields
  *	consistent for Features, Gres and Weight
@@ -2249,6 +2323,17 @@ extern void run_health_check(void);
 /* save_all_state - save entire slurmctld state for later recovery */
 extern void save_all_state(void);
 
+/* Tell script_write_thread() to write any queued job files and exit */
+extern void script_write_fini(void);
+
+/*
+ * Run as pthread to write batch job scripts and environments queued by
+ * job_allocate() with SchedulerParameters=async_script_write.
+ * no_data IN - unused
+ * RET - NULL
+ */
+extern void *script_write_thread(void *no_data);
+
 /* make sure the assoc_mgr lists are up and running and state is
  * restored */
 extern void ctld_assoc_mgr_init(void);
@@ -2461,6 +2546,19 @@ extern int update_job(slurm_msg_t *msg, uid_t uid, bool send_msg);
  */
 extern int update_job_str(slurm_msg_t *msg, uid_t uid);
 
+/*
+ * update_job_list - apply one job update to every job named in a
+ *	job_update_list_msg_t plus every job matching its filters, and send
+ *	the per job results
+ * IN msg - RPC with a job_update_list_msg_t
+ * IN uid - uid of user issuing RPC
+ * RET SLURM_SUCCESS or an error code if the request itself is invalid, in
+ *	which case no reply was sent
+ * global: job_list - global list of job entries
+ * NOTE: Sets its own locks, releasing them periodically for large requests
+ */
+extern int update_job_list(slurm_msg_t *msg, uid_t uid);
+
 /*
  * Modify the wckey associated with a pending job
  * IN module - where this is called from
@@ -2541,8 +2639,9 @@ extern int validate_alloc_node(part_record_t *part_ptr, char *alloc_node);
  */
 extern int validate_group(part_record_t *part_ptr, uid_t run_uid);
 
-/* Perform some size checks on strings we store to prevent
- * malicious user filling slurmctld's memory
+/* Validate a job create request and run the job_submit plugins on it.
+ * The caller must have checked string sizes with validate_job_desc_strings()
+ * first, job_submit_plugin_submit() repeats that if a plugin ran.
  * IN job_desc   - user job submit request
  * IN submit_uid - UID making job submit request
  * OUT err_msg   - custom error message to return
@@ -2550,6 +2649,15 @@ extern int validate_group(part_record_t *part_ptr, uid_t run_uid);
 extern int validate_job_create_req(job_desc_msg_t * job_desc, uid_t submit_uid,
 				   char **err_msg);
 
+/*
+ * Perform some size checks on strings we store to prevent a malicious user
+ * filling slurmctld's memory. Needs no locks, so RPC handlers can reject
+ * oversized requests before locking anything.
+ * IN job_desc - user job submit request
+ * RET 0 or error code
+ */
+extern int validate_job_desc_strings(job_desc_msg_t *job_desc);
+
 /*
  * validate_jobs_on_node - validate that any jobs that should be on the node
  *	are actually running, if not clean up the job records and/or node
@@ -39,12 +39,43 @@
 #include <stdio.h>
 
 #include "src/slurmctld/agent.h"
+#include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
+#include "src/common/assoc_mgr.h"
 #include "src/common/list.h"
 #include "src/common/pack.h"
 #include "src/common/xstring.h"
 #include "src/common/slurmdbd_defs.h"
 
+typedef struct {
+	uint32_t count;
+	uint64_t time_sum;
+	uint64_t time_max;
+	uint32_t hist[TIMER_HIST_SIZE];
+} sched_phase_stat_t;
+
+static const char *sched_ctx_names[SCHED_CTX_COUNT] = {
+	"other", "main", "backfill"
+};
+
+static const char *sched_phase_names[SCHED_PHASE_COUNT] = {
+	"build_job_queue", "acct_policy", "select_nodes", "job_test_resv",
+	"license_job_test", "gres_select", "lock_wait_conf", "lock_wait_job",
+	"lock_wait_node", "lock_wait_part", "lock_wait_fed"
+};
+
+static pthread_mutex_t sched_phase_mutex = PTHREAD_MUTEX_INITIALIZER;
+static sched_phase_stat_t sched_phase_stats[SCHED_CTX_COUNT][SCHED_PHASE_COUNT];
+static __thread sched_ctx_t sched_phase_ctx = SCHED_CTX_OTHER;
+/*
+ * Phase times are gathered per thread and only merged into
+ * sched_phase_stats by sched_phase_flush(), so the per job calls made by
+ * the schedulers do not take sched_phase_mutex.
+ */
+static __thread sched_phase_stat_t sched_phase_local[SCHED_PHASE_COUNT];
+static __thread bool sched_phase_pending = false;
+static __thread time_t sched_phase_flush_time = 0;
+
 extern int retry_list_size(void);
 
 /* Pack all scheduling statistics */
@@ -147,6 +178,168 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 	buffer_ptr[0] = xfer_buf_data(buffer);
 }
 
+/*
+ * Append the scheduler phase timers and histograms to a buffer built by
+ * pack_all_stat()
+ */
+extern void pack_sched_phase_stat(char **buffer_ptr, int *buffer_size,
+				  uint16_t protocol_version)
+{
+	buf_t *buffer;
+	sched_phase_stat_t *stat;
+	char **names;
+	uint32_t *counts, *hist;
+	uint64_t *times, *times_max;
+	uint32_t i, j, cnt = 0;
+
+	if (protocol_version < SLURM_21_08_PROTOCOL_VERSION)
+		return;
+
+	names = xcalloc(SCHED_CTX_COUNT * SCHED_PHASE_COUNT, sizeof(char *));
+	counts = xcalloc(SCHED_CTX_COUNT * SCHED_PHASE_COUNT,
+			 sizeof(uint32_t));
+	times = xcalloc(SCHED_CTX_COUNT * SCHED_PHASE_COUNT, sizeof(uint64_t));
+	times_max = xcalloc(SCHED_CTX_COUNT * SCHED_PHASE_COUNT,
+			    sizeof(uint64_t));
+	hist = xcalloc(SCHED_CTX_COUNT * SCHED_PHASE_COUNT *
+		       TIMER_HIST_SIZE, sizeof(uint32_t));
+
+	/* Only report phases which have been hit since the last reset */
+	slurm_mutex_lock(&sched_phase_mutex);
+	for (i = 0; i < SCHED_CTX_COUNT; i++) {
+		for (j = 0; j < SCHED_PHASE_COUNT; j++) {
+			stat = &sched_phase_stats[i][j];
+			if (!stat->count)
+				continue;
+			names[cnt] = xstrdup_printf("%s/%s",
+						    sched_ctx_names[i],
+						    sched_phase_names[j]);
+			counts[cnt] = stat->count;
+			times[cnt] = stat->time_sum;
+			times_max[cnt] = stat->time_max;
+			memcpy(&hist[cnt * TIMER_HIST_SIZE], stat->hist,
+			       sizeof(stat->hist));
+			cnt++;
+		}
+	}
+	slurm_mutex_unlock(&sched_phase_mutex);
+
+	buffer = create_buf(*buffer_ptr, *buffer_size);
+	set_buf_offset(buffer, *buffer_size);
+
+	pack64_array((uint64_t *) timer_hist_limit, TIMER_HIST_SIZE, buffer);
+	packstr_array(names, cnt, buffer);
+	pack32_array(counts, cnt, buffer);
+	pack64_array(times, cnt, buffer);
+	pack64_array(times_max, cnt, buffer);
+	pack32_array(hist, cnt * TIMER_HIST_SIZE, buffer);
+
+	*buffer_size = get_buf_offset(buffer);
+	buffer_ptr[0] = xfer_buf_data(buffer);
+
+	for (i = 0; i < cnt; i++)
+		xfree(names[i]);
+	xfree(names);
+	xfree(counts);
+	xfree(times);
+	xfree(times_max);
+	xfree(hist);
+}
+
+/*
+ * Append the slurmctld and assoc_mgr lock contention statistics and current
+ * lock holders to a buffer built by pack_all_stat()
+ */
+extern void pack_lock_trace_stat(char **buffer_ptr, int *buffer_size,
+				 uint16_t protocol_version)
+{
+	lock_trace_t *traces[] = {
+		&slurmctld_lock_trace, &assoc_mgr_lock_trace
+	};
+	lock_trace_site_t *sites[2];
+	char **holders[2];
+	int site_cnt[2], holder_cnt[2];
+	char **names = NULL, **all_holders = NULL;
+	uint32_t *counts, *wait_hist, *hold_hist;
+	uint64_t *wait_time, *wait_max, *hold_time, *hold_max;
+	uint32_t i, j, cnt = 0, all_holder_cnt = 0;
+	lock_trace_site_t *site;
+	buf_t *buffer;
+
+	if (protocol_version < SLURM_21_08_PROTOCOL_VERSION)
+		return;
+
+	for (i = 0; i < 2; i++) {
+		site_cnt[i] = lock_trace_get_sites(traces[i], &sites[i]);
+		holder_cnt[i] = lock_trace_get_holders(traces[i], &holders[i]);
+		cnt += site_cnt[i];
+		all_holder_cnt += holder_cnt[i];
+	}
+
+	names = xcalloc(cnt, sizeof(char *));
+	counts = xcalloc(cnt, sizeof(uint32_t));
+	wait_time = xcalloc(cnt, sizeof(uint64_t));
+	wait_max = xcalloc(cnt, sizeof(uint64_t));
+	hold_time = xcalloc(cnt, sizeof(uint64_t));
+	hold_max = xcalloc(cnt, sizeof(uint64_t));
+	wait_hist = xcalloc(cnt * TIMER_HIST_SIZE, sizeof(uint32_t));
+	hold_hist = xcalloc(cnt * TIMER_HIST_SIZE, sizeof(uint32_t));
+	all_holders = xcalloc(all_holder_cnt, sizeof(char *));
+
+	cnt = 0;
+	all_holder_cnt = 0;
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < site_cnt[i]; j++, cnt++) {
+			site = &sites[i][j];
+			names[cnt] = xstrdup_printf("%s/%s", traces[i]->name,
+						    site->site);
+			counts[cnt] = site->count;
+			wait_time[cnt] = site->wait_time;
+			wait_max[cnt] = site->wait_max;
+			hold_time[cnt] = site->hold_time;
+			hold_max[cnt] = site->hold_max;
+			memcpy(&wait_hist[cnt * TIMER_HIST_SIZE],
+			       site->wait_hist, sizeof(site->wait_hist));
+			memcpy(&hold_hist[cnt * TIMER_HIST_SIZE],
+			       site->hold_hist, sizeof(site->hold_hist));
+		}
+		for (j = 0; j < holder_cnt[i]; j++)
+			all_holders[all_holder_cnt++] = holders[i][j];
+		xfree(sites[i]);
+		xfree(holders[i]);
+	}
+
+	buffer = create_buf(*buffer_ptr, *buffer_size);
+	set_buf_offset(buffer, *buffer_size);
+
+	packstr_array(names, cnt, buffer);
+	pack32_array(counts, cnt, buffer);
+	pack64_array(wait_time, cnt, buffer);
+	pack64_array(wait_max, cnt, buffer);
+	pack64_array(hold_time, cnt, buffer);
+	pack64_array(hold_max, cnt, buffer);
+	pack32_array(wait_hist, cnt * TIMER_HIST_SIZE, buffer);
+	pack32_array(hold_hist, cnt * TIMER_HIST_SIZE, buffer);
+	packstr_array(all_holders, all_holder_cnt, buffer);
+
+	*buffer_size = get_buf_offset(buffer);
+	buffer_ptr[0] = xfer_buf_data(buffer);
+
+	for (i = 0; i < cnt; i++)
+		xfree(names[i]);
+	xfree(names);
+	for (i = 0; i < all_holder_cnt; i++)
+		xfree(all_holders[i]);
+	xfree(all_holders);
+	xfree(counts);
+	xfree(wait_time);
+	xfree(wait_max);
+	xfree(hold_time);
+	xfree(hold_max);
+	xfree(wait_hist);
+	xfree(hold_hist);
+}
+
 /* Reset all scheduling statistics
  * level IN - clear backfilled_jobs count if set */
 extern void reset_stats(int level)
@@ -181,5 +374,87 @@ extern void reset_stats(int level)
 	slurmctld_diag_stats.bf_last_depth = 0;
 	slurmctld_diag_stats.bf_last_depth_try = 0;
 
+	slurm_mutex_lock(&sched_phase_mutex);
+	memset(sched_phase_stats, 0, sizeof(sched_phase_stats));
+	slurm_mutex_unlock(&sched_phase_mutex);
+	lock_trace_reset(&slurmctld_lock_trace);
+	lock_trace_reset(&assoc_mgr_lock_trace);
+
 	last_proc_req_start = time(NULL);
 }
+
+/*
+ * Charge usec of scheduler phase to the calling thread's context.
+ * Use through SCHED_PHASE_START() and SCHED_PHASE_END().
+ */
+extern void sched_phase_record(sched_phase_t phase, long usec)
+{
+	sched_phase_stat_t *stat;
+	time_t now;
+
+	xassert(phase < SCHED_PHASE_COUNT);
+
+	if (usec < 0)	/* clock stepped backwards */
+		usec = 0;
+
+	stat = &sched_phase_local[phase];
+	stat->count++;
+	stat->time_sum += usec;
+	stat->time_max = MAX(stat->time_max, usec);
+	stat->hist[timer_hist_bucket(usec)]++;
+	sched_phase_pending = true;
+
+	/* Long lived threads without a flush point publish once a second */
+	now = time(NULL);
+	if (sched_phase_flush_time != now) {
+		if (sched_phase_flush_time)
+			sched_phase_flush();
+		sched_phase_flush_time = now;
+	}
+}
+
+/*
+ * Merge the phase times gathered by the calling thread into the totals
+ * reported by sdiag
+ */
+extern void sched_phase_flush(void)
+{
+	sched_phase_stat_t *stat, *local;
+	int i, j;
+
+	if (!sched_phase_pending)
+		return;
+
+	slurm_mutex_lock(&sched_phase_mutex);
+	for (i = 0; i < SCHED_PHASE_COUNT; i++) {
+		local = &sched_phase_local[i];
+		if (!local->count)
+			continue;
+		stat = &sched_phase_stats[sched_phase_ctx][i];
+		stat->count += local->count;
+		stat->time_sum += local->time_sum;
+		stat->time_max = MAX(stat->time_max, local->time_max);
+		for (j = 0; j < TIMER_HIST_SIZE; j++)
+			stat->hist[j] += local->hist[j];
+	}
+	slurm_mutex_unlock(&sched_phase_mutex);
+
+	memset(sched_phase_local, 0, sizeof(sched_phase_local));
+	sched_phase_pending = false;
+}
+
+/*
+ * Set the context the calling thread's scheduler phases are charged to
+ * RET previous context of this thread
+ */
+extern sched_ctx_t sched_phase_set_ctx(sched_ctx_t ctx)
+{
+	sched_ctx_t old_ctx = sched_phase_ctx;
+
+	xassert(ctx < SCHED_CTX_COUNT);
+	/* Charge what was gathered so far to the old context */
+	sched_phase_flush();
+	sched_phase_ctx = ctx;
+
+	return old_ctx;
+}
@@ -44,6 +44,8 @@
 #include "src/common/log.h"
 #include "src/common/read_config.h"
 #include "src/common/ref.h"
+#include "src/common/slurm_protocol_defs.h"
+#include "src/common/uid.h"
 #include "src/common/xassert.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
@@ -59,6 +61,20 @@ typedef enum {
 	URL_TAG_PING,
 } url_tag_t;
 
+/* Set dst to a list of {limit, count} histogram buckets */
+static void _set_histogram(data_t *dst, uint64_t *limit, uint32_t *hist,
+			   uint32_t hist_size)
+{
+	data_set_list(dst);
+	for (int i = 0; i < hist_size; i++) {
+		data_t *bucket = data_set_dict(data_list_append(dst));
+
+		if (limit[i] != INFINITE64)
+			data_set_int(data_key_set(bucket, "limit"), limit[i]);
+		data_set_int(data_key_set(bucket, "count"), hist[i]);
+	}
+}
+
 static int _op_handler_diag(const char *context_id,
 			    http_request_method_t method, data_t *parameters,
 			    data_t *query, int tag, data_t *p,
@@ -71,6 +87,7 @@ static int _op_handler_diag(const char *context_id,
 
 	data_t *errors = populate_response_format(p);
 	data_t *d = data_set_dict(data_key_set(p, "statistics"));
+	data_t *rpcs, *users, *phases, *sites, *holders;
 	debug4("%s:[%s] diag handler called", __func__, context_id);
 
 	if ((rc = slurm_get_statistics(&resp, req)))
@@ -145,6 +162,122 @@ static int _op_handler_diag(const char *context_id,
 		     resp->bf_when_last_cycle);
 	data_set_bool(data_key_set(d, "bf_active"), (resp->bf_active != 0));
 
+	rpcs = data_set_list(data_key_set(d, "rpcs_by_message_type"));
+	for (int i = 0; i < resp->rpc_type_size; i++) {
+		data_t *rpc = data_set_dict(data_list_append(rpcs));
+		uint32_t cnt = resp->rpc_type_cnt[i];
+
+		data_set_string(data_key_set(rpc, "message_type"),
+				rpc_num2string(resp->rpc_type_id[i]));
+		data_set_int(data_key_set(rpc, "type_id"),
+			     resp->rpc_type_id[i]);
+		data_set_int(data_key_set(rpc, "count"), cnt);
+		data_set_int(data_key_set(rpc, "time_total"),
+			     resp->rpc_type_time[i]);
+		data_set_int(data_key_set(rpc, "time_mean"),
+			     (cnt ? (resp->rpc_type_time[i] / cnt) : 0));
+		if (!resp->rpc_type_time_p50)
+			continue;
+		data_set_int(data_key_set(rpc, "time_p50"),
+			     resp->rpc_type_time_p50[i]);
+		data_set_int(data_key_set(rpc, "time_p99"),
+			     resp->rpc_type_time_p99[i]);
+		data_set_int(data_key_set(rpc, "time_max"),
+			     resp->rpc_type_time_max[i]);
+		data_set_int(data_key_set(rpc, "lock_wait_total"),
+			     resp->rpc_type_lock_wait[i]);
+		data_set_int(data_key_set(rpc, "bytes_in"),
+			     resp->rpc_type_bytes_in[i]);
+		data_set_int(data_key_set(rpc, "bytes_out"),
+			     resp->rpc_type_bytes_out[i]);
+	}
+
+	data_set_int(data_key_set(d, "rpc_user_window"),
+		     resp->rpc_user_window);
+	users = data_set_list(data_key_set(d, "rpcs_by_user"));
+	for (int i = 0; i < resp->rpc_user_size; i++) {
+		data_t *u = data_set_dict(data_list_append(users));
+		uint32_t cnt = resp->rpc_user_cnt[i];
+		char *user = uid_to_string_or_null(resp->rpc_user_id[i]);
+
+		if (user)
+			data_set_string_own(data_key_set(u, "user"), user);
+		data_set_int(data_key_set(u, "user_id"),
+			     resp->rpc_user_id[i]);
+		data_set_int(data_key_set(u, "count"), cnt);
+		data_set_int(data_key_set(u, "time_total"),
+			     resp->rpc_user_time[i]);
+		data_set_int(data_key_set(u, "time_mean"),
+			     (cnt ? (resp->rpc_user_time[i] / cnt) : 0));
+		if (!resp->rpc_user_recent_cnt)
+			continue;
+		data_set_int(data_key_set(u, "recent_count"),
+			     resp->rpc_user_recent_cnt[i]);
+		data_set_int(data_key_set(u, "recent_time_total"),
+			     resp->rpc_user_recent_time[i]);
+		data_set_int(data_key_set(u, "recent_lock_wait_total"),
+			     resp->rpc_user_recent_lock_wait[i]);
+		data_set_int(data_key_set(u, "recent_bytes"),
+			     resp->rpc_user_recent_bytes[i]);
+		data_set_int(data_key_set(u, "recent_rate_limited"),
+			     resp->rpc_user_recent_limited[i]);
+	}
+
+	phases = data_set_list(data_key_set(d, "scheduler_phases"));
+	for (int i = 0; i < resp->sched_phase_count; i++) {
+		uint32_t hist_size = resp->sched_phase_hist_size;
+		uint32_t *hist = &resp->sched_phase_hist[i * hist_size];
+		data_t *phase = data_set_dict(data_list_append(phases));
+
+		data_set_string(data_key_set(phase, "name"),
+				resp->sched_phase_name[i]);
+		data_set_int(data_key_set(phase, "count"),
+			     resp->sched_phase_cnt[i]);
+		data_set_int(data_key_set(phase, "time_total"),
+			     resp->sched_phase_time[i]);
+		data_set_int(data_key_set(phase, "time_mean"),
+			     (resp->sched_phase_cnt[i] ?
+			      (resp->sched_phase_time[i] /
+			       resp->sched_phase_cnt[i]) : 0));
+		data_set_int(data_key_set(phase, "time_max"),
+			     resp->sched_phase_time_max[i]);
+
+		_set_histogram(data_key_set(phase, "histogram"),
+			       resp->sched_phase_hist_limit, hist, hist_size);
+	}
+
+	sites = data_set_list(data_key_set(d, "lock_sites"));
+	for (int i = 0; i < resp->lock_site_count; i++) {
+		uint32_t hist_size = resp->sched_phase_hist_size;
+		data_t *site = data_set_dict(data_list_append(sites));
+
+		data_set_string(data_key_set(site, "name"),
+				resp->lock_site_name[i]);
+		data_set_int(data_key_set(site, "count"),
+			     resp->lock_site_cnt[i]);
+		data_set_int(data_key_set(site, "wait_total"),
+			     resp->lock_site_wait_time[i]);
+		data_set_int(data_key_set(site, "wait_max"),
+			     resp->lock_site_wait_max[i]);
+		data_set_int(data_key_set(site, "hold_total"),
+			     resp->lock_site_hold_time[i]);
+		data_set_int(data_key_set(site, "hold_max"),
+			     resp->lock_site_hold_max[i]);
+		_set_histogram(data_key_set(site, "wait_histogram"),
+			       resp->sched_phase_hist_limit,
+			       &resp->lock_site_wait_hist[i * hist_size],
+			       hist_size);
+		_set_histogram(data_key_set(site, "hold_histogram"),
+			       resp->sched_phase_hist_limit,
+			       &resp->lock_site_hold_hist[i * hist_size],
+			       hist_size);
+	}
+
+	holders = data_set_list(data_key_set(d, "lock_holders"));
+	for (int i = 0; i < resp->lock_holder_count; i++)
+		data_set_string(data_list_append(holders),
+				resp->lock_holder[i]);
+
 cleanup:
 	if (rc) {
 		data_t *e = data_set_dict(data_list_append(errors));
@@ -253,6 +253,7 @@ typedef enum {
 	URL_TAG_JOBS,
 	URL_TAG_JOB,
 	URL_TAG_JOB_SUBMIT,
+	URL_TAG_JOBS_UPDATE,
 } url_tag_t;
 
 typedef struct {
@@ -1388,6 +1389,136 @@ static int _op_handler_job(const char *context_id, http_request_method_t method,
 	return rc;
 }
 
+typedef struct {
+	List job_id_list;
+	bool failed;
+} _parse_job_ids_t;
+
+static data_for_each_cmd_t _parse_job_id(const data_t *data, void *arg)
+{
+	_parse_job_ids_t *args = arg;
+	char *job_id = NULL;
+
+	if (data_get_string_converted(data, &job_id) || !job_id) {
+		xfree(job_id);
+		args->failed = true;
+		return DATA_FOR_EACH_FAIL;
+	}
+
+	list_append(args->job_id_list, job_id);
+	return DATA_FOR_EACH_CONT;
+}
+
+static int _op_handler_jobs_update(const char *context_id,
+				   http_request_method_t method,
+				   data_t *parameters, data_t *query, int tag,
+				   data_t *resp, rest_auth_context_t *auth)
+{
+	int rc = SLURM_SUCCESS;
+	data_t *errors = populate_response_format(resp);
+	data_t *jobs = data_set_list(data_key_set(resp, "jobs"));
+	data_t *data;
+	job_parse_list_t jobs_rc = { 0 };
+	job_update_list_msg_t req = {
+		.state = NO_VAL,
+		.user_id = NO_VAL,
+	};
+	job_array_resp_msg_t *update_resp = NULL;
+	char *state = NULL;
+	int64_t user_id;
+
+	debug4("%s: jobs update handler %s called by %s with tag %d",
+	       __func__, get_http_method_string(method), context_id, tag);
+
+	if (method != HTTP_REQUEST_POST) {
+		_job_error("%s: [%s] unexpected HTTP method",
+			   __func__, context_id);
+		goto done;
+	}
+	if (!query) {
+		_job_error("%s: [%s] unexpected empty query for jobs update",
+			   __func__, context_id);
+		goto done;
+	}
+
+	jobs_rc = _parse_job_list(data_key_get(query, "job"), NULL, errors,
+				  true);
+	if (jobs_rc.rc) {
+		_job_error("%s: job parsing failed for %s",
+			   __func__, context_id);
+		goto done;
+	}
+	if (jobs_rc.het_job) {
+		_job_error("%s: [%s] a single job update is required",
+			   __func__, context_id);
+		goto done;
+	}
+	req.job_desc = jobs_rc.job;
+
+	if ((data = data_key_get(query, "job_ids"))) {
+		_parse_job_ids_t args = {
+			.job_id_list = list_create(xfree_ptr),
+		};
+
+		req.job_id_list = args.job_id_list;
+		if ((data_get_type(data) != DATA_TYPE_LIST) ||
+		    (data_list_for_each_const(data, _parse_job_id, &args) < 0) ||
+		    args.failed) {
+			_job_error("%s: [%s] invalid job_ids",
+				   __func__, context_id);
+			goto done;
+		}
+	}
+	if ((data = data_key_get(query, "partition")) &&
+	    data_get_string_converted(data, &req.partition)) {
+		_job_error("%s: [%s] invalid partition", __func__, context_id);
+		goto done;
+	}
+	if ((data = data_key_get(query, "state")) &&
+	    (data_get_string_converted(data, &state) ||
+	     ((req.state = job_state_num(state)) >= JOB_END))) {
+		_job_error("%s: [%s] invalid state", __func__, context_id);
+		goto done;
+	}
+	if ((data = data_key_get(query, "user_id"))) {
+		if (data_get_int_converted(data, &user_id) || (user_id < 0) ||
+		    (user_id >= NO_VAL)) {
+			_job_error("%s: [%s] invalid user_id",
+				   __func__, context_id);
+			goto done;
+		}
+		req.user_id = user_id;
+	}
+
+	errno = 0;
+	if (slurm_update_job_list(&req, &update_resp)) {
+		_job_error("%s: jobs update from %s failed: %s",
+			   __func__, context_id, slurm_strerror(errno));
+	} else if (update_resp) {
+		for (uint32_t i = 0; i < update_resp->job_array_count; i++) {
+			data_t *job = data_set_dict(data_list_append(jobs));
+
+			data_set_string(data_key_set(job, "job_id"),
+					update_resp->job_array_id[i]);
+			data_set_int(data_key_set(job, "error_code"),
+				     update_resp->error_code[i]);
+			data_set_string(data_key_set(job, "error"),
+					slurm_strerror(
+						update_resp->error_code[i]));
+		}
+	}
+
+done:
+	slurm_free_job_array_resp(update_resp);
+	FREE_NULL_LIST(jobs_rc.jobs);
+	slurm_free_job_desc_msg(jobs_rc.job);
+	FREE_NULL_LIST(req.job_id_list);
+	xfree(req.partition);
+	xfree(state);
+
+	return rc;
+}
+
 static int _op_handler_submit_job_post(const char *context_id,
 				       http_request_method_t method,
 				       data_t *parameters, data_t *query,
@@ -1581,6 +1712,8 @@ extern void init_op_jobs(void)
 			       URL_TAG_JOB);
 	bind_operation_handler("/slurm/v0.0.37/job/submit",
 			       _op_handler_submit_job, URL_TAG_JOB_SUBMIT);
+	bind_operation_handler("/slurm/v0.0.37/jobs/update",
+			       _op_handler_jobs_update, URL_TAG_JOBS_UPDATE);
 }
 
 extern void destroy_op_jobs(void)
@@ -1590,6 +1723,7 @@ extern void destroy_op_jobs(void)
 		xfree(lower_param_names[i]);
 	xfree(lower_param_names);
 
+	unbind_operation_handler(_op_handler_jobs_update);
 	unbind_operation_handler(_op_handler_submit_job);
 	unbind_operation_handler(_op_handler_job);
 	unbind_operation_handler(_op_handler_jobs);
@@ -102,6 +102,8 @@ parse_command_line( int argc, char* *argv )
 	bool override_format_env = false;
 
 	static struct option long_options[] = {
+		{"account",    required_argument, 0, 'A'},
+		{"accounts",   required_argument, 0, 'A'},
 		{"noheader",   no_argument,       0, 'h'},
 		{"jobs",       optional_argument, 0, 'j'},
 		{"long",       no_argument,       0, 'l'},
@@ -128,13 +130,17 @@ parse_command_line( int argc, char* *argv )
 	/* get defaults from environment */
 	_opt_env();
 
-	while ((opt_char = getopt_long(argc, argv, "hj::lM:no:S:p:u:vVw",
+	while ((opt_char = getopt_long(argc, argv, "A:hj::lM:no:S:p:u:vVw",
 				       long_options, &option_index)) != -1) {
 		switch (opt_char) {
 		case (int)'?':
 			fprintf(stderr, "Try \"sprio --help\" "
 				"for more information\n");
 			exit(1);
+		case (int)'A':
+			xfree(params.accounts);
+			params.accounts = xstrdup(optarg);
+			break;
 		case (int)'h':
 			params.no_header = true;
 			break;
@@ -453,6 +459,7 @@ _print_options(void)
 	uint32_t *user;
 
 	printf( "-----------------------------\n" );
+	printf( "accounts   = %s\n", params.accounts );
 	printf( "format     = %s\n", params.format );
 	printf( "job_flag   = %d\n", params.job_flag );
 	printf( "jobs       = %s\n", params.jobs );
@@ -552,6 +559,7 @@ _build_user_list(char* str)
 static void _usage(void)
 {
 	printf("Usage: sprio [-j jid[s]] [-u user_name[s]] [-o format] [-p partitions]\n");
+	printf("   [-A accounts]\n");
 	printf("   [--federation] [--local] [--sibling] [--usage] [-hlnvVw]\n");
 }
 
@@ -559,6 +567,7 @@ static void _help(void)
 {
 	printf("\
 Usage: sprio [OPTIONS]\n\
+  -A, --account=account_name      comma separated list of accounts to view\n\
       --federation                display jobs in federation if a member of one\n\
   -h, --noheader                  no headers on output\n\
   -j, --jobs                      comma separated list of jobs\n\
@@ -125,8 +125,8 @@ int main (int argc, char **argv)
 	if (params.sibling)
 		show_flags |= SHOW_FEDERATION | SHOW_SIBLING;
 	error_code = slurm_load_job_prio(&resp_msg, params.job_list,
-					 params.parts, params.user_list,
-					 show_flags);
+					 params.parts, params.accounts,
+					 params.user_list, show_flags);
 	if (error_code) {
 		slurm_perror("Couldn't get priority factors from controller");
 		exit(error_code);
@@ -71,6 +71,7 @@ struct sprio_parameters {
 
 	List clusters;
 
+	char* accounts;
 	char* format;
 	char* jobs;
 	char* parts;